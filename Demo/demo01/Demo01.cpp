@@ -850,6 +850,10 @@ void DemoApplication::OnBackendAttached(AppBackend *backend, int width, int heig
 	void register_tbbf_font_renderer();
 	register_tbbf_font_renderer();
 #endif
+#ifdef TB_FONT_RENDERER_BAKED
+	void register_baked_font_renderer();
+	register_baked_font_renderer();
+#endif
 #ifdef TB_FONT_RENDERER_STB
 	void register_stb_font_renderer();
 	register_stb_font_renderer();
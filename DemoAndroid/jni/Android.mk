@@ -11,7 +11,9 @@ LOCAL_SRC_FILES := jni_glue.cpp \
                    ../../src/tb/tb_color.cpp \
                    ../../src/tb/tb_dimension.cpp \
                    ../../src/tb/tb_editfield.cpp \
+                   ../../src/tb/tb_font_baker.cpp \
                    ../../src/tb/tb_font_renderer.cpp \
+                   ../../src/tb/tb_font_renderer_baked.cpp \
                    ../../src/tb/tb_font_renderer_tbbf.cpp \
                    ../../src/tb/tb_geometry.cpp \
                    ../../src/tb/tb_hash.cpp \
@@ -33,16 +35,22 @@ LOCAL_SRC_FILES := jni_glue.cpp \
                    ../../src/tb/tb_scroll_container.cpp \
                    ../../src/tb/tb_select.cpp \
                    ../../src/tb/tb_select_item.cpp \
+                   ../../src/tb/tb_select_item_async.cpp \
                    ../../src/tb/tb_skin.cpp \
                    ../../src/tb/tb_skin_util.cpp \
                    ../../src/tb/tb_style_edit.cpp \
                    ../../src/tb/tb_style_edit_content.cpp \
                    ../../src/tb/tb_system_android.cpp \
                    ../../src/tb/tb_tab_container.cpp \
+                   ../../src/tb/tb_table_view.cpp \
                    ../../src/tb/tb_tempbuffer.cpp \
+                   ../../src/tb/tb_thread_posix.cpp \
                    ../../src/tb/tb_toggle_container.cpp \
+                   ../../src/tb/tb_tree_view.cpp \
                    ../../src/tb/tb_value.cpp \
+                   ../../src/tb/tb_widget_arena.cpp \
                    ../../src/tb/tb_widget_skin_condition_context.cpp \
+                   ../../src/tb/tb_widget_spatial_index.cpp \
                    ../../src/tb/tb_widget_value.cpp \
                    ../../src/tb/tb_widgets.cpp \
                    ../../src/tb/tb_widgets_common.cpp \
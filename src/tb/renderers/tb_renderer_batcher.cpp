@@ -195,6 +195,93 @@ void TBRendererBatcher::DrawBitmapTile(const TBRect &dst_rect, TBBitmap *bitmap)
 					VER_COL_OPACITY(m_opacity), bitmap, nullptr);
 }
 
+void TBRendererBatcher::DrawGlyphRun(const GlyphRunItem *glyphs, int num_glyphs, const TBColor &color)
+{
+	if (!num_glyphs)
+		return;
+	TBBitmapFragment *first_fragment = glyphs[0].fragment;
+	TBBitmap *bitmap = first_fragment->GetBitmap(TB_VALIDATE_FIRST_TIME);
+	if (!bitmap)
+		return;
+
+	// All glyphs must share the bitmap so they can go into the same batch.
+	for (int i = 1; i < num_glyphs; i++)
+		if (glyphs[i].fragment->m_map != first_fragment->m_map)
+		{
+			TBRenderer::DrawGlyphRun(glyphs, num_glyphs, color);
+			return;
+		}
+
+	if (batch.bitmap != bitmap)
+	{
+		batch.Flush(this);
+		batch.bitmap = bitmap;
+	}
+	batch.fragment = first_fragment;
+
+	const uint32 a = (color.a * m_opacity) / 255;
+	const uint32 col = VER_COL(color.r, color.g, color.b, a);
+	const float inv_w = 1.f / bitmap->Width();
+	const float inv_h = 1.f / bitmap->Height();
+	const int max_glyphs_per_reserve = VERTEX_BATCH_SIZE / 6 - 1;
+
+	while (num_glyphs > 0)
+	{
+		const int count = Min(num_glyphs, max_glyphs_per_reserve);
+		Vertex *ver = batch.Reserve(this, count * 6);
+		const uint32 batch_id = batch.batch_id;
+		for (int i = 0; i < count; i++, ver += 6)
+		{
+			TBBitmapFragment *fragment = glyphs[i].fragment;
+			const TBRect &src_rect = fragment->m_rect;
+			const float x = (float) (glyphs[i].x + m_translation_x);
+			const float y = (float) (glyphs[i].y + m_translation_y);
+			const float xx = x + src_rect.w;
+			const float yy = y + src_rect.h;
+			const float u = src_rect.x * inv_w;
+			const float v = src_rect.y * inv_h;
+			const float uu = (src_rect.x + src_rect.w) * inv_w;
+			const float vv = (src_rect.y + src_rect.h) * inv_h;
+			ver[0].x = x;
+			ver[0].y = yy;
+			ver[0].u = u;
+			ver[0].v = vv;
+			ver[0].col = col;
+			ver[1].x = xx;
+			ver[1].y = yy;
+			ver[1].u = uu;
+			ver[1].v = vv;
+			ver[1].col = col;
+			ver[2].x = x;
+			ver[2].y = y;
+			ver[2].u = u;
+			ver[2].v = v;
+			ver[2].col = col;
+
+			ver[3].x = x;
+			ver[3].y = y;
+			ver[3].u = u;
+			ver[3].v = v;
+			ver[3].col = col;
+			ver[4].x = xx;
+			ver[4].y = yy;
+			ver[4].u = uu;
+			ver[4].v = vv;
+			ver[4].col = col;
+			ver[5].x = xx;
+			ver[5].y = y;
+			ver[5].u = uu;
+			ver[5].v = v;
+			ver[5].col = col;
+
+			// Update fragments batch id (See FlushBitmapFragment)
+			fragment->m_batch_id = batch_id;
+		}
+		glyphs += count;
+		num_glyphs -= count;
+	}
+}
+
 void TBRendererBatcher::AddQuadInternal(const TBRect &dst_rect, const TBRect &src_rect, uint32 color, TBBitmap *bitmap, TBBitmapFragment *fragment)
 {
 	if (batch.bitmap != bitmap)
@@ -67,6 +67,7 @@ public:
 	virtual void DrawBitmapColored(const TBRect &dst_rect, const TBRect &src_rect, const TBColor &color, TBBitmapFragment *bitmap_fragment);
 	virtual void DrawBitmapColored(const TBRect &dst_rect, const TBRect &src_rect, const TBColor &color, TBBitmap *bitmap);
 	virtual void DrawBitmapTile(const TBRect &dst_rect, TBBitmap *bitmap);
+	virtual void DrawGlyphRun(const GlyphRunItem *glyphs, int num_glyphs, const TBColor &color);
 	virtual void FlushBitmap(TBBitmap *bitmap);
 	virtual void FlushBitmapFragment(TBBitmapFragment *bitmap_fragment);
 
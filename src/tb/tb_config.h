@@ -34,6 +34,10 @@
 /** Enable to support TBBF fonts (Turbo Badger Bitmap Fonts) */
 #define TB_FONT_RENDERER_TBBF
 
+/** Enable to support baked fonts (pre rasterized binary fonts, see tb_font_baker.h).
+	Also enables TBFontBaker which can create baked fonts from other font formats. */
+#define TB_FONT_RENDERER_BAKED
+
 /** Enable to support truetype fonts using freetype. */
 //#define TB_FONT_RENDERER_FREETYPE
 
@@ -73,6 +77,11 @@
 /** Enable support for TBImage, TBImageManager, TBImageWidget. */
 #define TB_IMAGE
 
+/** Enable support for TBAsyncPagedItemSource. It needs an implementation of TBThread,
+	TBMutex and TBSemaphore, so by default it's enabled if TB_THREAD_POSIX or
+	TB_THREAD_WINDOWS is defined. */
+//#define TB_ASYNC_ITEM_SOURCE
+
 // == Additional configuration of platform implementations ========================
 
 /** Define for posix implementation of TBFile. */
@@ -83,6 +92,10 @@
 //#define TB_CLIPBOARD_GLFW // Cross platform using glfw API.
 //#define TB_CLIPBOARD_WINDOWS
 
+/** Defines for implementations of TBThread, TBMutex and TBSemaphore. */
+//#define TB_THREAD_POSIX
+//#define TB_THREAD_WINDOWS
+
 /** Defines for implementations of TBSystem. */
 //#define TB_SYSTEM_LINUX
 //#define TB_SYSTEM_WINDOWS
@@ -98,21 +111,29 @@
 #if defined(ANDROID) || defined(__ANDROID__)
 #define TB_SYSTEM_ANDROID
 #define TB_CLIPBOARD_DUMMY
+#define TB_THREAD_POSIX
 #elif defined(__linux) || defined(__linux__)
 #define TB_FILE_POSIX
 #define TB_TARGET_LINUX
 #define TB_SYSTEM_LINUX
 #define TB_CLIPBOARD_GLFW
+#define TB_THREAD_POSIX
 #elif MACOSX
 #define TB_FILE_POSIX
 #define TB_TARGET_MACOSX
 #define TB_SYSTEM_LINUX
 #define TB_CLIPBOARD_GLFW
+#define TB_THREAD_POSIX
 #elif defined(_WIN32) || defined(__WIN32__) || defined(__WINDOWS__)
 #define TB_FILE_POSIX
 #define TB_TARGET_WINDOWS
 #define TB_CLIPBOARD_WINDOWS
 #define TB_SYSTEM_WINDOWS
+#define TB_THREAD_WINDOWS
+#endif
+
+#if defined(TB_THREAD_POSIX) || defined(TB_THREAD_WINDOWS)
+#define TB_ASYNC_ITEM_SOURCE
 #endif
 
 #endif // TB_CONFIG_H
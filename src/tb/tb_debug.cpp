@@ -18,6 +18,8 @@ namespace tb {
 TBDebugInfo g_tb_debug;
 
 TBDebugInfo::TBDebugInfo()
+	: num_ps_cache_hits(0)
+	, num_ps_cache_misses(0)
 {
 	memset(settings, 0, sizeof(int) * NUM_SETTINGS);
 }
@@ -97,6 +99,15 @@ public:
 		if (TB_DEBUG_SETTING(RENDER_SKIN_BITMAP_FRAGMENTS))
 			g_tb_skin->Debug();
 
+		// Draw the preferred size cache statistics
+		if (TB_DEBUG_SETTING(LAYOUT_PS_DEBUGGING))
+		{
+			TBStr str;
+			str.SetFormatted("Preferred size cache hits: %d, misses: %d",
+							g_tb_debug.num_ps_cache_hits, g_tb_debug.num_ps_cache_misses);
+			GetFont()->DrawString(0, GetRect().h - GetFont()->GetHeight(), paint_props.text_color, str);
+		}
+
 		// Draw font glyph fragments (the font of the hovered widget)
 		if (TB_DEBUG_SETTING(RENDER_FONT_BITMAP_FRAGMENTS))
 		{
@@ -43,6 +43,11 @@ public:
 		NUM_SETTINGS
 	};
 	int settings[NUM_SETTINGS];
+
+	/** The number of TBWidget::GetPreferredSize calls that were answered from the cache,
+		and that had to calculate it, while LAYOUT_PS_DEBUGGING is enabled. */
+	int num_ps_cache_hits;
+	int num_ps_cache_misses;
 };
 
 extern TBDebugInfo g_tb_debug;
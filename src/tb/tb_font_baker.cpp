@@ -0,0 +1,253 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#include "tb_font_baker.h"
+#include "tb_font_renderer.h"
+#include "tb_system.h"
+#include <stdio.h>
+
+#ifdef TB_FONT_RENDERER_BAKED
+
+namespace tb {
+
+/** Width of the baked glyph bitmap (unless a glyph is wider). */
+#define BAKED_BITMAP_WIDTH 512
+
+/** Rasterize result for one glyph during baking. */
+struct BakeGlyph
+{
+	TBBakedFontGlyph baked;
+	bool rendered;
+};
+
+static inline uint8 GetAlpha(uint32 color)
+{
+	return (color & 0xff000000) >> 24;
+}
+
+/** Decode the glyph string into a sorted array of unique code points. Returns the count. */
+static int DecodeSortedCodePoints(const char *glyph_str, TBTempBuffer &cp_buffer)
+{
+	int glyph_str_len = strlen(glyph_str);
+	if (!cp_buffer.Reserve(sizeof(UCS4) * (glyph_str_len + 1)))
+		return 0;
+	UCS4 *cps = (UCS4 *) cp_buffer.GetData();
+	int num_cps = 0;
+	int i = 0;
+	while (i < glyph_str_len)
+	{
+		UCS4 cp = utf8::decode_next(glyph_str, &i, glyph_str_len);
+		if (cp == 0xFFFF)
+			continue;
+		// Insert sorted, skip duplicates. The glyph string is usually sorted already.
+		int pos = num_cps;
+		while (pos > 0 && cps[pos - 1] > cp)
+			pos--;
+		if (pos > 0 && cps[pos - 1] == cp)
+			continue;
+		memmove(&cps[pos + 1], &cps[pos], sizeof(UCS4) * (num_cps - pos));
+		cps[pos] = cp;
+		num_cps++;
+	}
+	return num_cps;
+}
+
+// == TBFontBaker =================================================================================
+
+bool TBFontBaker::AddSize(int size)
+{
+	if (m_num_sizes == TB_FONT_BAKER_MAX_SIZES)
+		return false;
+	m_sizes[m_num_sizes++] = size;
+	return true;
+}
+
+bool TBFontBaker::Bake(const TBID &font_id, const char *dst_filename)
+{
+	TBTempBuffer data;
+	if (!Bake(font_id, data))
+		return false;
+
+	FILE *f = fopen(dst_filename, "wb");
+	if (!f)
+		return false;
+	bool success = fwrite(data.GetData(), 1, data.GetAppendPos(), f) == (size_t) data.GetAppendPos();
+	fclose(f);
+	return success;
+}
+
+bool TBFontBaker::Bake(const TBID &font_id, TBTempBuffer &dst)
+{
+	if (!m_num_sizes || !g_font_manager->GetFontInfo(font_id))
+		return false;
+
+	TBTempBuffer cp_buffer;
+	int num_cps = DecodeSortedCodePoints(m_glyph_str.CStr(), cp_buffer);
+	UCS4 *cps = (UCS4 *) cp_buffer.GetData();
+	if (!num_cps)
+		return false;
+
+	TBTempBuffer glyph_buffer;
+	if (!glyph_buffer.Reserve(sizeof(BakeGlyph) * num_cps))
+		return false;
+	BakeGlyph *glyphs = (BakeGlyph *) glyph_buffer.GetData();
+
+	// Header and size table. The size table is filled in as each size is baked.
+	const int file_start = dst.GetAppendPos();
+	TBBakedFontHeader header;
+	memcpy(header.magic, TB_BAKED_FONT_MAGIC, 4);
+	header.version = TB_BAKED_FONT_VERSION;
+	header.num_sizes = m_num_sizes;
+	header.rgb = 0;
+	const int header_pos = dst.GetAppendPos();
+	if (!dst.Append((const char *) &header, sizeof(header)))
+		return false;
+	const int size_table_pos = dst.GetAppendPos();
+	if (!dst.AppendSpace(sizeof(TBBakedFontSize) * m_num_sizes))
+		return false;
+
+	for (int s = 0; s < m_num_sizes; s++)
+	{
+		TBFontDescription fd;
+		fd.SetID(font_id);
+		fd.SetSize(m_sizes[s]);
+		TBFontFace *font = g_font_manager->HasFontFace(fd) ? g_font_manager->GetFontFace(fd) : g_font_manager->CreateFontFace(fd);
+		TBFontRenderer *renderer = font ? font->GetFontRenderer() : nullptr;
+		if (!renderer)
+			return false;
+
+		// Skip glyphs missing in the font, so they can be found in a fallback font
+		// instead of baking the replacement glyph. The coverage is the same for all sizes.
+		if (s == 0)
+		{
+			int num_covered = 0;
+			for (int i = 0; i < num_cps; i++)
+				if (renderer->HasGlyph(cps[i]))
+					cps[num_covered++] = cps[i];
+			num_cps = num_covered;
+			if (!num_cps)
+				return false;
+		}
+
+		// First pass: Get metrics and rasterize to find the bitmap layout and pixel format.
+		int bytes_per_pixel = 1;
+		int bitmap_w = BAKED_BITMAP_WIDTH;
+		for (int i = 0; i < num_cps; i++)
+		{
+			TBFontGlyphData glyph_data;
+			if (renderer->RenderGlyph(&glyph_data, cps[i]))
+			{
+				bitmap_w = Max(bitmap_w, glyph_data.w);
+				if (glyph_data.data32)
+					bytes_per_pixel = 4;
+				if (glyph_data.rgb)
+					header.rgb = 1;
+			}
+		}
+		if (bitmap_w > TB_BAKED_FONT_MAX_BITMAP_SIZE)
+			return false;
+		int x = 0, y = 0, row_h = 0;
+		for (int i = 0; i < num_cps; i++)
+		{
+			BakeGlyph &g = glyphs[i];
+			memset(&g.baked, 0, sizeof(g.baked));
+			g.baked.cp = cps[i];
+			TBGlyphMetrics metrics;
+			renderer->GetGlyphMetrics(&metrics, cps[i]);
+			g.baked.advance = metrics.advance;
+			g.baked.ofs_x = metrics.x;
+			g.baked.ofs_y = metrics.y;
+
+			TBFontGlyphData glyph_data;
+			g.rendered = renderer->RenderGlyph(&glyph_data, cps[i]) &&
+						(glyph_data.data8 || glyph_data.data32) && glyph_data.w > 0 && glyph_data.h > 0;
+			if (!g.rendered)
+				continue;
+			if (x + glyph_data.w > bitmap_w)
+			{
+				x = 0;
+				y += row_h + 1;
+				row_h = 0;
+			}
+			// Fail if the bitmap gets too large for the glyph rects to fit in TBBakedFontGlyph.
+			if (y + glyph_data.h > TB_BAKED_FONT_MAX_BITMAP_SIZE)
+				return false;
+			g.baked.x = x;
+			g.baked.y = y;
+			g.baked.w = glyph_data.w;
+			g.baked.h = glyph_data.h;
+			x += glyph_data.w + 1;
+			row_h = Max(row_h, glyph_data.h);
+		}
+		// The bitmap is never empty, even if all glyphs are (f.ex only space).
+		const int bitmap_h = Max(y + row_h, 1);
+
+		// Glyph table
+		TBBakedFontSize size;
+		size.size = m_sizes[s];
+		TBFontMetrics font_metrics = renderer->GetMetrics();
+		size.ascent = font_metrics.ascent;
+		size.descent = font_metrics.descent;
+		size.height = font_metrics.height;
+		size.reserved = 0;
+		size.num_glyphs = num_cps;
+		size.glyphs_offset = dst.GetAppendPos() - file_start;
+		size.bitmap_w = bitmap_w;
+		size.bitmap_h = bitmap_h;
+		size.bytes_per_pixel = bytes_per_pixel;
+		for (int i = 0; i < num_cps; i++)
+			if (!dst.Append((const char *) &glyphs[i].baked, sizeof(TBBakedFontGlyph)))
+				return false;
+
+		// Second pass: Rasterize again and copy the pixels into the bitmap.
+		size.pixels_offset = dst.GetAppendPos() - file_start;
+		const int pixels_size = bitmap_w * bitmap_h * bytes_per_pixel;
+		if (!dst.AppendSpace((pixels_size + 3) & ~3))
+			return false;
+		uint8 *pixels = (uint8 *) dst.GetData() + file_start + size.pixels_offset;
+		memset(pixels, 0, pixels_size);
+		for (int i = 0; i < num_cps; i++)
+		{
+			const TBBakedFontGlyph &g = glyphs[i].baked;
+			TBFontGlyphData glyph_data;
+			if (!glyphs[i].rendered || !renderer->RenderGlyph(&glyph_data, g.cp))
+				continue;
+			for (int row = 0; row < g.h; row++)
+			{
+				uint8 *dst_row = pixels + ((g.y + row) * bitmap_w + g.x) * bytes_per_pixel;
+				if (bytes_per_pixel == 1 && glyph_data.data8)
+					memcpy(dst_row, glyph_data.data8 + row * glyph_data.stride, g.w);
+				else if (bytes_per_pixel == 1)
+				{
+					const uint32 *src_row = glyph_data.data32 + row * glyph_data.stride;
+					for (int col = 0; col < g.w; col++)
+						dst_row[col] = GetAlpha(src_row[col]);
+				}
+				else if (glyph_data.data32)
+					memcpy(dst_row, glyph_data.data32 + row * glyph_data.stride, g.w * sizeof(uint32));
+				else
+				{
+					const uint8 *src_row = glyph_data.data8 + row * glyph_data.stride;
+					uint32 *dst_row32 = (uint32 *) dst_row;
+					for (int col = 0; col < g.w; col++)
+					{
+#ifdef TB_PREMULTIPLIED_ALPHA
+						dst_row32[col] = TBColor(src_row[col], src_row[col], src_row[col], src_row[col]);
+#else
+						dst_row32[col] = TBColor(255, 255, 255, src_row[col]);
+#endif
+					}
+				}
+			}
+		}
+		memcpy(dst.GetData() + size_table_pos + s * sizeof(TBBakedFontSize), &size, sizeof(size));
+	}
+	memcpy(dst.GetData() + header_pos, &header, sizeof(header));
+	return true;
+}
+
+} // namespace tb
+
+#endif // TB_FONT_RENDERER_BAKED
@@ -0,0 +1,128 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#ifndef TB_FONT_BAKER_H
+#define TB_FONT_BAKER_H
+
+#include "tb_core.h"
+#include "tb_id.h"
+#include "tb_str.h"
+#include "tb_tempbuffer.h"
+
+#ifdef TB_FONT_RENDERER_BAKED
+
+namespace tb {
+
+class TBFontFace;
+class TBFontManager;
+class TBFontDescription;
+
+/** Baked font file format (read by the baked font renderer, written by TBFontBaker).
+
+	A baked font contains pre rasterized glyphs for one or more sizes. Everything
+	needed to render a glyph is precomputed, so loading is a single file read and
+	glyph lookup is a binary search in a table sorted by code point. No image
+	decoding or glyph discovery is done at load time.
+
+	All values are stored in the native byte order of the machine baking the font,
+	and all structs are 4 byte aligned so they can be used directly from the loaded
+	file data. Fonts must be baked on a machine with the same byte order as the target.
+	A font baked with the other byte order is rejected, since its version won't match.
+
+	The bitmap of a size can be at most TB_BAKED_FONT_MAX_BITMAP_SIZE pixels wide and
+	high, so the glyph rects fit in TBBakedFontGlyph.
+
+	Layout:
+		TBBakedFontHeader
+		TBBakedFontSize[header.num_sizes]
+		For each size:
+			TBBakedFontGlyph[size.num_glyphs] (at size.glyphs_offset)
+			Pixel data (at size.pixels_offset), bitmap_w * bitmap_h * bytes_per_pixel.
+			bytes_per_pixel is 1 for alpha only glyphs, or 4 for 32bit BGRA glyphs.
+*/
+
+#define TB_BAKED_FONT_MAGIC			"TBFB"
+#define TB_BAKED_FONT_VERSION		1
+#define TB_BAKED_FONT_MAX_BITMAP_SIZE	16384
+
+struct TBBakedFontHeader
+{
+	char magic[4];			///< Always TB_BAKED_FONT_MAGIC.
+	uint32 version;			///< Always TB_BAKED_FONT_VERSION.
+	uint32 num_sizes;		///< Number of TBBakedFontSize following the header.
+	uint32 rgb;				///< 1 if glyphs should ignore the text color when drawing.
+};
+
+struct TBBakedFontSize
+{
+	int32 size;				///< The font size (in pixels) this was baked for.
+	int16 ascent, descent, height, reserved;
+	uint32 num_glyphs;		///< Number of TBBakedFontGlyph.
+	uint32 glyphs_offset;	///< File offset to the glyph table, sorted by code point.
+	uint32 bitmap_w;		///< Width of the glyph bitmap.
+	uint32 bitmap_h;		///< Height of the glyph bitmap.
+	uint32 bytes_per_pixel;	///< 1 (alpha) or 4 (BGRA32)
+	uint32 pixels_offset;	///< File offset to the glyph bitmap.
+};
+
+struct TBBakedFontGlyph
+{
+	uint32 cp;				///< The code point.
+	uint16 x, y, w, h;		///< The glyph rect in the bitmap. w or h is 0 for empty glyphs.
+	int16 advance, ofs_x, ofs_y, reserved;
+};
+
+/** TBFontBaker rasterizes a font through the registered font renderers (f.ex FreeType,
+	stb_truetype or TBBF) for a list of sizes and glyphs, and writes the result as a
+	baked font file that can be loaded instantly by the baked font renderer.
+
+	The font must have been added to g_font_manager with TBFontManager::AddFontInfo,
+	and a renderer capable of loading it must be registered.
+
+	Example:
+
+	TBFontBaker baker;
+	baker.AddSize(14);
+	baker.AddSize(28);
+	baker.SetGlyphs(" !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~");
+	baker.Bake(TBIDC("Vera"), "vera.tbfont");
+*/
+class TBFontBaker
+{
+public:
+	TBFontBaker() : m_num_sizes(0) {}
+
+	/** Add a font size (in pixels) to bake. Returns false if there are already TB_FONT_BAKER_MAX_SIZES. */
+	bool AddSize(int size);
+
+	/** Set the glyphs to bake as a UTF-8 string. */
+	bool SetGlyphs(const char *glyph_str) { return m_glyph_str.Set(glyph_str); }
+
+	/** Rasterize the font with the given font id and write the baked font to dst_filename.
+		Returns true on success. */
+	bool Bake(const TBID &font_id, const char *dst_filename);
+
+	/** Rasterize the font with the given font id and append the baked font data to dst.
+		Returns true on success, or false if the font couldn't be rendered, or the glyphs
+		don't fit in a bitmap of TB_BAKED_FONT_MAX_BITMAP_SIZE. */
+	bool Bake(const TBID &font_id, TBTempBuffer &dst);
+private:
+	enum { TB_FONT_BAKER_MAX_SIZES = 16 };
+	int m_sizes[TB_FONT_BAKER_MAX_SIZES];
+	int m_num_sizes;
+	TBStr m_glyph_str;
+};
+
+/** Create a font face from baked font data in memory (f.ex baked with TBFontBaker).
+	The data is copied. The font face is not added to the font manager, so it must be
+	deleted by the caller. Returns nullptr if the data isn't a valid baked font, or on OOM. */
+TBFontFace *CreateBakedFontFace(TBFontManager *font_manager, const char *data, int data_len,
+								const TBFontDescription &font_desc);
+
+} // namespace tb
+
+#endif // TB_FONT_RENDERER_BAKED
+
+#endif // TB_FONT_BAKER_H
@@ -25,6 +25,9 @@ public:
 		Example:
 		If a font was added to the font manager with the name "Vera", you can
 		do font_description.SetID(TBIDC("Vera")).
+
+		Glyphs missing in the font are taken from its fallback chain, if it has
+		one (See TBFontManager::AddFallbackFont).
 		*/
 	void SetID(const TBID &id)											{ m_id = id; }
 
@@ -115,7 +115,9 @@ TBFontGlyph::TBFontGlyph(const TBID &hash_id, UCS4 cp)
 	: hash_id(hash_id)
 	, cp(cp)
 	, frag(nullptr)
+	, face(nullptr)
 	, has_rgb(false)
+	, render_failed(false)
 {
 }
 
@@ -140,17 +142,22 @@ TBFontGlyph *TBFontGlyphCache::GetGlyph(const TBID &hash_id, UCS4 cp)
 {
 	if (TBFontGlyph *glyph = m_glyphs.Get(hash_id))
 	{
-		// Move the glyph to the end of m_all_rendered_glyphs so we maintain LRU (oldest first)
-		if (m_all_rendered_glyphs.ContainsLink(glyph))
-		{
-			m_all_rendered_glyphs.Remove(glyph);
-			m_all_rendered_glyphs.AddLast(glyph);
-		}
+		TouchGlyph(glyph);
 		return glyph;
 	}
 	return nullptr;
 }
 
+void TBFontGlyphCache::TouchGlyph(TBFontGlyph *glyph)
+{
+	// Move the glyph to the end of m_all_rendered_glyphs so we maintain LRU (oldest first)
+	if (m_all_rendered_glyphs.ContainsLink(glyph) && glyph->GetNext())
+	{
+		m_all_rendered_glyphs.Remove(glyph);
+		m_all_rendered_glyphs.AddLast(glyph);
+	}
+}
+
 TBFontGlyph *TBFontGlyphCache::CreateAndCacheGlyph(const TBID &hash_id, UCS4 cp)
 {
 	assert(!GetGlyph(hash_id, cp));
@@ -234,11 +241,119 @@ void TBFontGlyphCache::OnContextRestored()
 	// No need to do anything. The bitmaps will be created when drawing.
 }
 
+// == TBFontFallbackChain =========================================================================
+
+TBFontFallbackChain::TBFontFallbackChain(const TBID &font_id)
+	: m_num_fonts(1)
+	, m_last_block(nullptr)
+	, m_last_block_index(0)
+{
+	m_font_ids[0] = font_id;
+}
+
+bool TBFontFallbackChain::AddFont(const TBID &font_id)
+{
+	if (m_num_fonts == MAX_FONTS)
+		return false;
+	m_font_ids[m_num_fonts++] = font_id;
+	// The coverage map doesn't include the new font, so it has to be built again.
+	m_blocks.DeleteAll();
+	m_last_block = nullptr;
+	return true;
+}
+
+int TBFontFallbackChain::GetFontIndex(TBFontFace *face, UCS4 cp)
+{
+	const uint32 block_index = cp / BLOCK_SIZE;
+	Block *block = m_last_block;
+	if (!block || m_last_block_index != block_index)
+	{
+		block = m_blocks.Get(block_index);
+		if (!block && !(block = CreateBlock(face, block_index)))
+			return 0;
+		m_last_block = block;
+		m_last_block_index = block_index;
+	}
+	const uint32 word = (cp % BLOCK_SIZE) / 32;
+	const uint32 bit = 1u << (cp % 32);
+	for (int i = 0; i < m_num_fonts; i++)
+		if (block->coverage[i][word] & bit)
+			return i;
+	return 0;
+}
+
+TBFontFallbackChain::Block *TBFontFallbackChain::CreateBlock(TBFontFace *face, uint32 block_index)
+{
+	Block *block = new Block;
+	if (!block)
+		return nullptr;
+	memset(block, 0, sizeof(Block));
+	const UCS4 first_cp = block_index * BLOCK_SIZE;
+	for (int i = 0; i < m_num_fonts; i++)
+	{
+		// A font that can't be created covers nothing. The test font (without renderer) covers everything.
+		TBFontFace *chain_face = face->GetChainFace(this, i);
+		if (!chain_face)
+			continue;
+		TBFontRenderer *renderer = chain_face->GetFontRenderer();
+		for (UCS4 cp = 0; cp < BLOCK_SIZE; cp++)
+			if (!renderer || renderer->HasGlyph(first_cp + cp))
+				block->coverage[i][cp / 32] |= 1u << (cp % 32);
+	}
+	if (m_blocks.Add(block_index, block))
+		return block;
+	delete block;
+	return nullptr;
+}
+
+// == TBFontStringLayout ==========================================================================
+
+TBFontStringLayout::TBFontStringLayout()
+	: m_font(nullptr)
+	, m_glyphs(nullptr)
+	, m_num_glyphs(0)
+	, m_capacity(0)
+	, m_width(0)
+	, m_bg_layout(nullptr)
+{
+}
+
+TBFontStringLayout::~TBFontStringLayout()
+{
+	delete [] m_glyphs;
+	delete m_bg_layout;
+}
+
+void TBFontStringLayout::Reset()
+{
+	m_font = nullptr;
+	m_num_glyphs = 0;
+	m_width = 0;
+	if (m_bg_layout)
+		m_bg_layout->Reset();
+}
+
+bool TBFontStringLayout::Reserve(int num_glyphs)
+{
+	if (num_glyphs <= m_capacity)
+		return true;
+	LayoutGlyph *new_glyphs = new LayoutGlyph[num_glyphs];
+	if (!new_glyphs)
+		return false;
+	delete [] m_glyphs;
+	m_glyphs = new_glyphs;
+	m_capacity = num_glyphs;
+	return true;
+}
+
 // ================================================================================================
 
 TBFontFace::TBFontFace(TBFontGlyphCache *glyph_cache, TBFontRenderer *renderer, const TBFontDescription &font_desc)
-	: m_glyph_cache(glyph_cache), m_font_renderer(renderer), m_font_desc(font_desc), m_bgFont(nullptr), m_bgX(0), m_bgY(0)
+	: m_glyph_cache(glyph_cache), m_font_renderer(renderer), m_font_desc(font_desc)
+	, m_bgFont(nullptr), m_bgX(0), m_bgY(0)
 {
+	for (int i = 0; i < TBFontFallbackChain::MAX_FONTS; i++)
+		m_chain_faces[i] = nullptr;
 	if (m_font_renderer)
 		m_metrics = m_font_renderer->GetMetrics();
 	else
@@ -276,10 +391,10 @@ bool TBFontFace::RenderGlyphs(const char *glyph_str, int glyph_str_len)
 		glyph_str_len = strlen(glyph_str);
 
 	bool has_all_glyphs = true;
-	int i = 0;
-	while (glyph_str[i] && i < glyph_str_len)
+	utf8::span_decoder decoder(glyph_str, glyph_str_len);
+	UCS4 cp;
+	while (decoder.next(cp))
 	{
-		UCS4 cp = utf8::decode_next(glyph_str, &i, glyph_str_len);
 		if (!GetGlyph(cp, true))
 			has_all_glyphs = false;
 	}
@@ -294,7 +409,10 @@ TBFontGlyph *TBFontFace::CreateAndCacheGlyph(const TBID &hash_id, UCS4 cp)
 	// Create the new glyph
 	TBFontGlyph *glyph = m_glyph_cache->CreateAndCacheGlyph(hash_id, cp);
 	if (glyph)
+	{
+		glyph->face = this;
 		m_font_renderer->GetGlyphMetrics(&glyph->metrics, cp);
+	}
 	return glyph;
 }
 
@@ -302,7 +420,12 @@ void TBFontFace::RenderGlyph(TBFontGlyph *glyph)
 {
 	assert(!glyph->frag);
 	TBFontGlyphData glyph_data;
-	if (m_font_renderer->RenderGlyph(&glyph_data, glyph->cp))
+	if (!m_font_renderer->RenderGlyph(&glyph_data, glyph->cp))
+	{
+		// There's nothing to render for this glyph (f.ex space), so don't try again.
+		glyph->render_failed = true;
+	}
+	else
 	{
 		TBFontGlyphData *effect_glyph_data = m_effect.Render(&glyph->metrics, &glyph_data);
 		TBFontGlyphData *result_glyph_data = effect_glyph_data ? effect_glyph_data : &glyph_data;
@@ -358,12 +481,49 @@ TBFontGlyph *TBFontFace::GetGlyph(UCS4 cp, bool render_if_needed)
 	const TBID &hash_id = GetHashId(cp);
 	TBFontGlyph *glyph = m_glyph_cache->GetGlyph(hash_id, cp);
 	if (!glyph)
-		glyph = CreateAndCacheGlyph(hash_id, cp);
-	if (glyph && !glyph->frag && render_if_needed)
-		RenderGlyph(glyph);
+	{
+		// Take the glyph from the fallback chain if this font doesn't have it. It's cached
+		// with the hash of this face, so the chain is only searched the first time.
+		glyph = GetFallbackFace(cp)->CreateAndCacheGlyph(hash_id, cp);
+	}
+	if (glyph && !glyph->frag && !glyph->render_failed && render_if_needed)
+		glyph->face->RenderGlyph(glyph);
 	return glyph;
 }
 
+TBFontFace *TBFontFace::GetFallbackFace(UCS4 cp)
+{
+	TBFontFallbackChain *chain = g_font_manager->GetFallbackChain(m_font_desc.GetID());
+	if (!chain || !m_font_renderer)
+		return this;
+	int index = chain->GetFontIndex(this, cp);
+	TBFontFace *face = index ? GetChainFace(chain, index) : nullptr;
+	return face ? face : this;
+}
+
+TBFontFace *TBFontFace::GetChainFace(TBFontFallbackChain *chain, int index)
+{
+	return index == 0 ? this : m_chain_faces[index];
+}
+
+void TBFontFace::ResolveChainFaces(TBFontManager *font_manager)
+{
+	TBFontFallbackChain *chain = m_font_renderer ? font_manager->GetFallbackChain(m_font_desc.GetID()) : nullptr;
+	if (!chain)
+		return;
+	// Use font faces with the same description except for the font id. Creating them
+	// here instead of when drawing means the face generation doesn't change mid-frame.
+	for (int i = 1; i < chain->GetNumFonts(); i++)
+	{
+		TBFontDescription fd = m_font_desc;
+		fd.SetID(chain->GetFontID(i));
+		if (font_manager->HasFontFace(fd))
+			m_chain_faces[i] = font_manager->GetFontFace(fd);
+		else
+			m_chain_faces[i] = font_manager->CreateFontFace(fd);
+	}
+}
+
 void TBFontFace::DrawString(int x, int y, const TBColor &color, const char *str, int len)
 {
 	if (m_bgFont)
@@ -372,23 +532,21 @@ void TBFontFace::DrawString(int x, int y, const TBColor &color, const char *str,
 	if (m_font_renderer)
 		g_renderer->BeginBatchHint(TBRenderer::BATCH_HINT_DRAW_BITMAP_FRAGMENT);
 
-	int i = 0;
-	while (str[i] && i < len)
+	// Glyphs are collected into runs that are drawn with one DrawGlyphRun call.
+	// The pending run must be drawn before rendering a new glyph, since that may
+	// drop other glyphs (and their fragments) from the glyph cache.
+	TBRenderer::GlyphRunItem run[GLYPH_RUN_SIZE];
+	int run_len = 0;
+
+	utf8::span_decoder decoder(str, len);
+	UCS4 cp;
+	while (decoder.next(cp))
 	{
-		UCS4 cp = utf8::decode_next(str, &i, len);
 		if (cp == 0xFFFF)
 			continue;
-		if (TBFontGlyph *glyph = GetGlyph(cp, true))
+		if (TBFontGlyph *glyph = GetGlyph(cp, false))
 		{
-			if (glyph->frag)
-			{
-				TBRect dst_rect(x + glyph->metrics.x, y + glyph->metrics.y + GetAscent(), glyph->frag->Width(), glyph->frag->Height());
-				TBRect src_rect(0, 0, glyph->frag->Width(), glyph->frag->Height());
-				if (glyph->has_rgb)
-					g_renderer->DrawBitmap(dst_rect, src_rect, glyph->frag);
-				else
-					g_renderer->DrawBitmapColored(dst_rect, src_rect, color, glyph->frag);
-			}
+			DrawGlyph(glyph, x, y, color, run, run_len);
 			x += glyph->metrics.advance;
 		}
 		else if (!m_font_renderer) // This is the test font. Use same glyph width as height and draw square.
@@ -398,17 +556,56 @@ void TBFontFace::DrawString(int x, int y, const TBColor &color, const char *str,
 		}
 	}
 
+	DrawGlyphRun(run, run_len, color);
+
 	if (m_font_renderer)
 		g_renderer->EndBatchHint();
 }
 
+void TBFontFace::DrawGlyph(TBFontGlyph *glyph, int x, int y, const TBColor &color, TBRenderer::GlyphRunItem *run, int &run_len)
+{
+	if (!glyph->frag && !glyph->render_failed)
+	{
+		DrawGlyphRun(run, run_len, color);
+		glyph->face->RenderGlyph(glyph);
+	}
+	if (!glyph->frag)
+		return;
+	const int glyph_x = x + glyph->metrics.x;
+	const int glyph_y = y + glyph->metrics.y + GetAscent();
+	if (glyph->has_rgb)
+	{
+		DrawGlyphRun(run, run_len, color);
+		TBRect dst_rect(glyph_x, glyph_y, glyph->frag->Width(), glyph->frag->Height());
+		TBRect src_rect(0, 0, glyph->frag->Width(), glyph->frag->Height());
+		g_renderer->DrawBitmap(dst_rect, src_rect, glyph->frag);
+	}
+	else
+	{
+		if (run_len == GLYPH_RUN_SIZE)
+			DrawGlyphRun(run, run_len, color);
+		run[run_len].fragment = glyph->frag;
+		run[run_len].x = glyph_x;
+		run[run_len].y = glyph_y;
+		run_len++;
+	}
+}
+
+void TBFontFace::DrawGlyphRun(TBRenderer::GlyphRunItem *run, int &run_len, const TBColor &color)
+{
+	if (!run_len)
+		return;
+	g_renderer->DrawGlyphRun(run, run_len, color);
+	run_len = 0;
+}
+
 int TBFontFace::GetStringWidth(const char *str, int len)
 {
 	int width = 0;
-	int i = 0;
-	while (str[i] && i < len)
+	utf8::span_decoder decoder(str, len);
+	UCS4 cp;
+	while (decoder.next(cp))
 	{
-		UCS4 cp = utf8::decode_next(str, &i, len);
 		if (cp == 0xFFFF)
 			continue;
 		if (!m_font_renderer) // This is the test font. Use same glyph width as height.
@@ -419,6 +616,76 @@ int TBFontFace::GetStringWidth(const char *str, int len)
 	return width;
 }
 
+bool TBFontFace::LayoutString(TBFontStringLayout &layout, const char *str, int len)
+{
+	layout.Reset();
+	if (len == TB_ALL_TO_TERMINATION)
+		len = strlen(str);
+	// The number of bytes is the upper bound of the number of glyphs.
+	if (!layout.Reserve(len))
+		return false;
+	if (m_bgFont)
+	{
+		if (!layout.m_bg_layout)
+			layout.m_bg_layout = new TBFontStringLayout;
+		if (!layout.m_bg_layout || !m_bgFont->LayoutString(*layout.m_bg_layout, str, len))
+			return false;
+	}
+
+	int x = 0;
+	utf8::span_decoder decoder(str, len);
+	UCS4 cp;
+	while (decoder.next(cp))
+	{
+		if (cp == 0xFFFF)
+			continue;
+		TBFontStringLayout::LayoutGlyph &lg = layout.m_glyphs[layout.m_num_glyphs++];
+		lg.x = x;
+		lg.glyph = m_font_renderer ? GetGlyph(cp, false) : nullptr;
+		if (!m_font_renderer) // This is the test font. Use same glyph width as height.
+			x += m_metrics.height / 3 + 1;
+		else if (lg.glyph)
+			x += lg.glyph->metrics.advance;
+	}
+	layout.m_width = x;
+	layout.m_font = this;
+	return true;
+}
+
+void TBFontFace::DrawLayout(int x, int y, const TBColor &color, const TBFontStringLayout &layout, int num_glyphs)
+{
+	assert(layout.m_font == this);
+	if (num_glyphs == -1 || num_glyphs > layout.m_num_glyphs)
+		num_glyphs = layout.m_num_glyphs;
+
+	if (m_bgFont && layout.m_bg_layout)
+		m_bgFont->DrawLayout(x + m_bgX, y + m_bgY, m_bgColor, *layout.m_bg_layout, num_glyphs);
+
+	if (!m_font_renderer)
+	{
+		// This is the test font. Draw squares.
+		for (int i = 0; i < num_glyphs; i++)
+			g_tb_skin->PaintRect(TBRect(x + layout.m_glyphs[i].x, y, m_metrics.height / 3, m_metrics.height), color, 1);
+		return;
+	}
+
+	g_renderer->BeginBatchHint(TBRenderer::BATCH_HINT_DRAW_BITMAP_FRAGMENT);
+
+	TBRenderer::GlyphRunItem run[GLYPH_RUN_SIZE];
+	int run_len = 0;
+	for (int i = 0; i < num_glyphs; i++)
+	{
+		if (TBFontGlyph *glyph = layout.m_glyphs[i].glyph)
+		{
+			m_glyph_cache->TouchGlyph(glyph);
+			DrawGlyph(glyph, x + layout.m_glyphs[i].x, y, color, run, run_len);
+		}
+	}
+	DrawGlyphRun(run, run_len, color);
+
+	g_renderer->EndBatchHint();
+}
+
 #ifdef TB_RUNTIME_DEBUG_INFO
 void TBFontFace::Debug()
 {
@@ -429,6 +696,7 @@ void TBFontFace::Debug()
 // == TBFontManager ===============================================================================
 
 TBFontManager::TBFontManager()
+	: m_face_generation(1)
 {
 	// Add the test dummy font with empty name (Equals to ID 0)
 	AddFontInfo("-test-font-dummy-", "");
@@ -473,6 +741,47 @@ TBFontFace *TBFontManager::GetFontFace(const TBFontDescription &font_desc)
 	return m_fonts.Get(m_test_font_desc.GetFontFaceID());
 }
 
+void TBFontManager::SetDefaultFontDescription(const TBFontDescription &font_desc)
+{
+	m_default_font_desc = font_desc;
+	InvalidateFaceGeneration();
+}
+
+void TBFontManager::InvalidateFaceGeneration()
+{
+	if (++m_face_generation == 0)
+		m_face_generation = 1;
+}
+
+bool TBFontManager::AddFallbackFont(const TBID &font_id, const TBID &fallback_font_id)
+{
+	TBFontFallbackChain *chain = m_fallback_chains.Get(font_id);
+	if (!chain)
+	{
+		chain = new TBFontFallbackChain(font_id);
+		if (!chain)
+			return false;
+		if (!m_fallback_chains.Add(font_id, chain))
+		{
+			delete chain;
+			return false;
+		}
+	}
+	if (!chain->AddFont(fallback_font_id))
+		return false;
+
+	// Create the fallback font faces for the existing font faces of the font. Creating
+	// font faces adds to m_fonts, so find the font faces first.
+	TBListOf<TBFontFace> faces;
+	TBHashTableIteratorOf<TBFontFace> it(&m_fonts);
+	while (TBFontFace *font = it.GetNextContent())
+		if (font->GetFontDescription().GetID() == font_id && !faces.Add(font))
+			return false;
+	for (int i = 0; i < faces.GetNumItems(); i++)
+		faces.Get(i)->ResolveChainFaces(this);
+	return true;
+}
+
 TBFontFace *TBFontManager::CreateFontFace(const TBFontDescription &font_desc)
 {
 	assert(!HasFontFace(font_desc)); // There is already a font added with this description!
@@ -486,7 +795,10 @@ TBFontFace *TBFontManager::CreateFontFace(const TBFontDescription &font_desc)
 		if (TBFontFace *font = new TBFontFace(&m_glyph_cache, nullptr, font_desc))
 		{
 			if (m_fonts.Add(font_desc.GetFontFaceID(), font))
+			{
+				InvalidateFaceGeneration();
 				return font;
+			}
 			delete font;
 		}
 		return nullptr;
@@ -498,7 +810,11 @@ TBFontFace *TBFontManager::CreateFontFace(const TBFontDescription &font_desc)
 		if (TBFontFace *font = fr->Create(this, fi->GetFilename(), font_desc))
 		{
 			if (m_fonts.Add(font_desc.GetFontFaceID(), font))
+			{
+				InvalidateFaceGeneration();
+				font->ResolveChainFaces(this);
 				return font;
+			}
 			delete font;
 		}
 	}
@@ -65,6 +65,11 @@ public:
 	virtual bool RenderGlyph(TBFontGlyphData *data, UCS4 cp) = 0;
 	virtual void GetGlyphMetrics(TBGlyphMetrics *metrics, UCS4 cp) = 0;
 	virtual TBFontMetrics GetMetrics() = 0;
+
+	/** Return true if the font file has a glyph for the given code point (and won't just
+		render a replacement glyph). This is used to pick a font from a fallback chain
+		(See TBFontManager::AddFallbackFont), and should be fast. */
+	virtual bool HasGlyph(UCS4 cp) { return true; }
 	//virtual int GetKernAdvance(UCS4 cp1, UCS4 cp2) = 0;
 };
 
@@ -79,7 +84,9 @@ public:
 	UCS4 cp;
 	TBGlyphMetrics metrics;		///< The glyph metrics.
 	TBBitmapFragment *frag;		///< The bitmap fragment, or nullptr if missing.
+	TBFontFace *face;			///< The font face that renders this glyph.
 	bool has_rgb;				///< if true, drawing should ignore text color.
+	bool render_failed;			///< if true, the renderer had nothing to render for this glyph.
 };
 
 /** TBFontGlyphCache caches glyphs for font faces.
@@ -93,6 +100,9 @@ public:
 	/** Get the glyph or nullptr if it is not in the cache. */
 	TBFontGlyph *GetGlyph(const TBID &hash_id, UCS4 cp);
 
+	/** Mark the glyph as recently used so its fragment is dropped after older glyphs. */
+	void TouchGlyph(TBFontGlyph *glyph);
+
 	/** Create the glyph and put it in the cache. Returns the glyph, or nullptr on fail. */
 	TBFontGlyph *CreateAndCacheGlyph(const TBID &hash_id, UCS4 cp);
 
@@ -138,6 +148,94 @@ private:
 	TBTempBuffer m_data_dst;
 };
 
+/** TBFontFallbackChain is a list of fonts that are searched, in order, for glyphs that are
+	missing in the first font. See TBFontManager::AddFallbackFont.
+
+	Which font to use for a code point is looked up in a map that is built lazily from the
+	glyph coverage of the fonts, one unicode block at a time. Each block has a dense bitset
+	per font, so finding the font for a code point is one lookup instead of probing the
+	renderer of each font. */
+class TBFontFallbackChain
+{
+public:
+	/** The max number of fonts in a chain (including the first font). */
+	enum { MAX_FONTS = 8 };
+
+	TBFontFallbackChain(const TBID &font_id);
+
+	/** Add a font to the end of the chain. Returns false if the chain is full. */
+	bool AddFont(const TBID &font_id);
+
+	/** Get the number of fonts in the chain (including the first font). */
+	int GetNumFonts() const { return m_num_fonts; }
+
+	/** Get the font id of the font at the given index. Index 0 is the first font. */
+	TBID GetFontID(int index) const { return m_font_ids[index]; }
+
+	/** Get the index of the first font in the chain that has a glyph for cp, or 0 if
+		no font has it (so the first font renders its replacement glyph).
+		face is a font face (of any size) with the first font of the chain. It provides
+		the glyph coverage of the fonts in the chain if the map needs to be built. */
+	int GetFontIndex(TBFontFace *face, UCS4 cp);
+private:
+	enum { BLOCK_SIZE = 256, BLOCK_WORDS = BLOCK_SIZE / 32 };
+	/** The glyph coverage for all fonts in one block of code points. */
+	struct Block
+	{
+		uint32 coverage[MAX_FONTS][BLOCK_WORDS];
+	};
+	Block *CreateBlock(TBFontFace *face, uint32 block_index);
+	TBID m_font_ids[MAX_FONTS];
+	int m_num_fonts;
+	TBHashTableAutoDeleteOf<Block> m_blocks;
+	Block *m_last_block;
+	uint32 m_last_block_index;
+};
+
+/** TBFontStringLayout holds the glyphs and positions of a string laid out by
+	TBFontFace::LayoutString, so it can be measured and drawn repeatedly without
+	decoding the string or looking up glyphs again.
+
+	The glyphs are owned by the glyph cache and stay alive even if their bitmap
+	fragment is dropped from it, so a layout stays valid until the text or font
+	changes. Dropped fragments are rendered again when drawing. */
+class TBFontStringLayout
+{
+public:
+	TBFontStringLayout();
+	~TBFontStringLayout();
+
+	/** Forget the layout. Call when the text has changed. */
+	void Reset();
+
+	/** Get the font face this layout was made with, or nullptr if it's reset. */
+	TBFontFace *GetFont() const { return m_font; }
+
+	/** Get the total width of the string. */
+	int GetWidth() const { return m_width; }
+
+	/** Get the number of glyphs in the string. */
+	int GetNumGlyphs() const { return m_num_glyphs; }
+
+	/** Get the x position of the glyph at the given index, relative to the string start.
+		The index may be GetNumGlyphs(), which returns the width of the string. */
+	int GetGlyphX(int index) const { return index < m_num_glyphs ? m_glyphs[index].x : m_width; }
+private:
+	friend class TBFontFace;
+	struct LayoutGlyph
+	{
+		TBFontGlyph *glyph;	///< The glyph, or nullptr if it couldn't be created.
+		int x;
+	};
+	bool Reserve(int num_glyphs);
+	TBFontFace *m_font;
+	LayoutGlyph *m_glyphs;
+	int m_num_glyphs;
+	int m_capacity;
+	int m_width;
+	TBFontStringLayout *m_bg_layout; ///< Layout for the background font, if any.
+};
+
 /** TBFontFace represents a loaded font that can measure and render strings. */
 class TBFontFace
 {
@@ -162,6 +260,9 @@ public:
 	/** Get the font description that was used to create this font. */
 	TBFontDescription GetFontDescription() const { return m_font_desc; }
 
+	/** Get the font renderer used by this font face, or nullptr for the test dummy font. */
+	TBFontRenderer *GetFontRenderer() const { return m_font_renderer; }
+
 	/** Get the effect object, so the effect can be changed.
 		Note: No glyphs are re-rendered. Only new glyphs are affected. */
 	TBFontEffect *GetEffect() { return &m_effect; }
@@ -173,6 +274,14 @@ public:
 		termination (whatever comes first). */
 	int GetStringWidth(const char *str, int len = TB_ALL_TO_TERMINATION);
 
+	/** Lay out the given string into layout, so it can be measured and drawn with DrawLayout
+		without decoding and glyph lookup each time. Returns false on OOM. */
+	bool LayoutString(TBFontStringLayout &layout, const char *str, int len = TB_ALL_TO_TERMINATION);
+
+	/** Draw a string laid out by LayoutString with this font at position x, y (marks the upper
+		left corner of the text). If num_glyphs is not -1, only that many glyphs are drawn. */
+	void DrawLayout(int x, int y, const TBColor &color, const TBFontStringLayout &layout, int num_glyphs = -1);
+
 #ifdef TB_RUNTIME_DEBUG_INFO
 	/** Render the glyph bitmaps on screen, to analyze fragment positioning. */
 	void Debug();
@@ -182,10 +291,18 @@ public:
 	    when calling DrawString. Very usefull to add a shadow effect to a font. */
 	void SetBackgroundFont(TBFontFace *font, const TBColor &col, int xofs, int yofs);
 private:
+	friend class TBFontFallbackChain;
+	friend class TBFontManager;
 	TBID GetHashId(UCS4 cp) const;
 	TBFontGlyph *GetGlyph(UCS4 cp, bool render_if_needed);
+	TBFontFace *GetFallbackFace(UCS4 cp);
+	TBFontFace *GetChainFace(TBFontFallbackChain *chain, int index);
+	void ResolveChainFaces(TBFontManager *font_manager);
 	TBFontGlyph *CreateAndCacheGlyph(const TBID &hash_id, UCS4 cp);
 	void RenderGlyph(TBFontGlyph *glyph);
+	void DrawGlyph(TBFontGlyph *glyph, int x, int y, const TBColor &color, TBRenderer::GlyphRunItem *run, int &run_len);
+	void DrawGlyphRun(TBRenderer::GlyphRunItem *run, int &run_len, const TBColor &color);
+	enum { GLYPH_RUN_SIZE = 64 };
 	TBFontGlyphCache *m_glyph_cache;
 	TBFontRenderer *m_font_renderer;
 	TBFontDescription m_font_desc;
@@ -193,6 +310,8 @@ private:
 	TBFontEffect m_effect;
 	TBTempBuffer m_temp_buffer;
 
+	TBFontFace *m_chain_faces[TBFontFallbackChain::MAX_FONTS];	///< Faces of the fallback chain, with this size, or nullptr.
+
 	TBFontFace *m_bgFont;
 	int m_bgX;
 	int m_bgY;
@@ -264,20 +383,41 @@ public:
 		GetFontFace using the same TBFontDescription. */
 	TBFontFace *CreateFontFace(const TBFontDescription &font_desc);
 
+	/** Add a font to the end of the fallback chain of the font with the given id.
+		When a glyph is missing in a font, it is taken from the first font in its chain
+		that has it. Font faces of the fallback font are created with the same sizes as
+		the font faces of the font, when the fallback font is added and when more font
+		faces of the font are created (never while drawing).
+		Fallback fonts should be added before any text is drawn, since glyphs that are
+		already cached are not affected.
+		Returns false on OOM or if the chain is full (See TBFontFallbackChain::MAX_FONTS). */
+	bool AddFallbackFont(const TBID &font_id, const TBID &fallback_font_id);
+
+	/** Get the fallback chain for the given font id, or nullptr if it has none. */
+	TBFontFallbackChain *GetFallbackChain(const TBID &font_id) const { return m_fallback_chains.Get(font_id); }
+
 	/** Set the default font description. This is the font description that will be used by default
 		for widgets. By default, the default description is using the test dummy font. */
-	void SetDefaultFontDescription(const TBFontDescription &font_desc) { m_default_font_desc = font_desc; }
+	void SetDefaultFontDescription(const TBFontDescription &font_desc);
 	TBFontDescription GetDefaultFontDescription() const { return m_default_font_desc; }
 
+	/** Get a number that changes whenever GetFontFace may return a different font face for
+		the same description (when a font face is created or the default font description
+		changes). This can be used to detect if a cached font face is outdated. It's never 0. */
+	uint32 GetFaceGeneration() const { return m_face_generation; }
+
 	/** Return the glyph cache used for fonts created by this font manager. */
 	TBFontGlyphCache *GetGlyphCache() { return &m_glyph_cache; }
 private:
 	TBHashTableAutoDeleteOf<TBFontInfo> m_font_info;
 	TBHashTableAutoDeleteOf<TBFontFace> m_fonts;
+	TBHashTableAutoDeleteOf<TBFontFallbackChain> m_fallback_chains;
 	TBLinkListAutoDeleteOf<TBFontRenderer> m_font_renderers;
 	TBFontGlyphCache m_glyph_cache;
 	TBFontDescription m_default_font_desc;
 	TBFontDescription m_test_font_desc;
+	uint32 m_face_generation;
+	void InvalidateFaceGeneration();
 };
 
 } // namespace tb
@@ -0,0 +1,214 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#include "tb_font_renderer.h"
+#include "tb_font_baker.h"
+#include "tb_tempbuffer.h"
+#include "tb_system.h"
+
+#ifdef TB_FONT_RENDERER_BAKED
+
+using namespace tb;
+
+/** TBBakedFontRenderer renders a baked font (See tb_font_baker.h for the file format).
+
+	The whole file is read once, and glyphs are rendered directly from the loaded
+	data. Glyph lookup is a binary search in the precomputed glyph table. */
+class TBBakedFontRenderer : public TBFontRenderer
+{
+public:
+	TBBakedFontRenderer();
+	~TBBakedFontRenderer();
+
+	bool Load(const char *filename, int size);
+	bool Load(const char *data, int data_len, int size);
+
+	virtual TBFontFace *Create(TBFontManager *font_manager, const char *filename,
+								const TBFontDescription &font_desc);
+
+	virtual TBFontMetrics GetMetrics();
+	virtual bool RenderGlyph(TBFontGlyphData *dst_bitmap, UCS4 cp);
+	virtual void GetGlyphMetrics(TBGlyphMetrics *metrics, UCS4 cp);
+	virtual bool HasGlyph(UCS4 cp);
+private:
+	bool Validate(int size);
+	const TBBakedFontGlyph *FindGlyph(UCS4 cp) const;
+	const TBBakedFontGlyph *FindGlyphOrFallback(UCS4 cp) const;
+	TBTempBuffer m_data;
+	TBFontMetrics m_metrics;
+	const TBBakedFontSize *m_size;
+	const TBBakedFontGlyph *m_glyphs;
+	const uint8 *m_pixels;
+	bool m_rgb;
+};
+
+TBBakedFontRenderer::TBBakedFontRenderer()
+	: m_size(nullptr)
+	, m_glyphs(nullptr)
+	, m_pixels(nullptr)
+	, m_rgb(false)
+{
+}
+
+TBBakedFontRenderer::~TBBakedFontRenderer()
+{
+}
+
+TBFontMetrics TBBakedFontRenderer::GetMetrics()
+{
+	return m_metrics;
+}
+
+const TBBakedFontGlyph *TBBakedFontRenderer::FindGlyph(UCS4 cp) const
+{
+	int lo = 0;
+	int hi = (int) m_size->num_glyphs - 1;
+	while (lo <= hi)
+	{
+		int mid = (lo + hi) >> 1;
+		if (m_glyphs[mid].cp < cp)
+			lo = mid + 1;
+		else if (m_glyphs[mid].cp > cp)
+			hi = mid - 1;
+		else
+			return &m_glyphs[mid];
+	}
+	return nullptr;
+}
+
+const TBBakedFontGlyph *TBBakedFontRenderer::FindGlyphOrFallback(UCS4 cp) const
+{
+	if (const TBBakedFontGlyph *glyph = FindGlyph(cp))
+		return glyph;
+	return FindGlyph('?');
+}
+
+bool TBBakedFontRenderer::RenderGlyph(TBFontGlyphData *data, UCS4 cp)
+{
+	const TBBakedFontGlyph *glyph = FindGlyphOrFallback(cp);
+	if (!glyph || !glyph->w || !glyph->h)
+		return false;
+	data->w = glyph->w;
+	data->h = glyph->h;
+	data->stride = m_size->bitmap_w;
+	if (m_size->bytes_per_pixel == 4)
+		data->data32 = (uint32 *) m_pixels + glyph->y * m_size->bitmap_w + glyph->x;
+	else
+		data->data8 = (uint8 *) m_pixels + glyph->y * m_size->bitmap_w + glyph->x;
+	data->rgb = m_rgb;
+	return true;
+}
+
+void TBBakedFontRenderer::GetGlyphMetrics(TBGlyphMetrics *metrics, UCS4 cp)
+{
+	if (const TBBakedFontGlyph *glyph = FindGlyphOrFallback(cp))
+	{
+		metrics->advance = glyph->advance;
+		metrics->x = glyph->ofs_x;
+		metrics->y = glyph->ofs_y;
+	}
+}
+
+bool TBBakedFontRenderer::HasGlyph(UCS4 cp)
+{
+	return FindGlyph(cp) != nullptr;
+}
+
+bool TBBakedFontRenderer::Load(const char *filename, int size)
+{
+	if (!m_data.AppendFile(filename))
+		return false;
+	return Validate(size);
+}
+
+bool TBBakedFontRenderer::Load(const char *data, int data_len, int size)
+{
+	if (!m_data.Append(data, data_len))
+		return false;
+	return Validate(size);
+}
+
+bool TBBakedFontRenderer::Validate(int size)
+{
+	const uint32 file_size = m_data.GetAppendPos();
+	const char *data = m_data.GetData();
+
+	// All sizes are checked with division or subtraction so they can't overflow.
+	const TBBakedFontHeader *header = (const TBBakedFontHeader *) data;
+	if (file_size < sizeof(TBBakedFontHeader) ||
+		memcmp(header->magic, TB_BAKED_FONT_MAGIC, 4) != 0 ||
+		header->version != TB_BAKED_FONT_VERSION ||
+		!header->num_sizes ||
+		header->num_sizes > (file_size - sizeof(TBBakedFontHeader)) / sizeof(TBBakedFontSize))
+		return false;
+
+	// Get the size closest to the size we want.
+	const TBBakedFontSize *sizes = (const TBBakedFontSize *) (data + sizeof(TBBakedFontHeader));
+	m_size = &sizes[0];
+	for (uint32 i = 1; i < header->num_sizes; i++)
+		if (ABS(size - sizes[i].size) < ABS(size - m_size->size))
+			m_size = &sizes[i];
+
+	// Validate the tables so we can trust them during rendering. The bitmap is at most
+	// TB_BAKED_FONT_MAX_BITMAP_SIZE wide and high, so its size fits in uint32.
+	if ((m_size->bytes_per_pixel != 1 && m_size->bytes_per_pixel != 4) ||
+		!m_size->bitmap_w || m_size->bitmap_w > TB_BAKED_FONT_MAX_BITMAP_SIZE ||
+		!m_size->bitmap_h || m_size->bitmap_h > TB_BAKED_FONT_MAX_BITMAP_SIZE ||
+		(m_size->glyphs_offset & 3) || (m_size->pixels_offset & 3) ||
+		m_size->glyphs_offset > file_size ||
+		m_size->num_glyphs > (file_size - m_size->glyphs_offset) / sizeof(TBBakedFontGlyph) ||
+		m_size->pixels_offset > file_size ||
+		m_size->bitmap_w * m_size->bitmap_h * m_size->bytes_per_pixel > file_size - m_size->pixels_offset)
+		return false;
+	m_glyphs = (const TBBakedFontGlyph *) (data + m_size->glyphs_offset);
+	m_pixels = (const uint8 *) (data + m_size->pixels_offset);
+	for (uint32 i = 0; i < m_size->num_glyphs; i++)
+	{
+		const TBBakedFontGlyph &g = m_glyphs[i];
+		if ((uint32) g.x + g.w > m_size->bitmap_w || (uint32) g.y + g.h > m_size->bitmap_h)
+			return false;
+	}
+
+	m_metrics.ascent = m_size->ascent;
+	m_metrics.descent = m_size->descent;
+	m_metrics.height = m_size->height;
+	m_rgb = header->rgb ? true : false;
+	return true;
+}
+
+TBFontFace *TBBakedFontRenderer::Create(TBFontManager *font_manager, const char *filename, const TBFontDescription &font_desc)
+{
+	if (!strstr(filename, ".tbfont"))
+		return nullptr;
+	if (TBBakedFontRenderer *fr = new TBBakedFontRenderer())
+	{
+		if (fr->Load(filename, (int) font_desc.GetSize()))
+			if (TBFontFace *font = new TBFontFace(font_manager->GetGlyphCache(), fr, font_desc))
+				return font;
+		delete fr;
+	}
+	return nullptr;
+}
+
+TBFontFace *tb::CreateBakedFontFace(TBFontManager *font_manager, const char *data, int data_len,
+									const TBFontDescription &font_desc)
+{
+	if (TBBakedFontRenderer *fr = new TBBakedFontRenderer())
+	{
+		if (fr->Load(data, data_len, (int) font_desc.GetSize()))
+			if (TBFontFace *font = new TBFontFace(font_manager->GetGlyphCache(), fr, font_desc))
+				return font;
+		delete fr;
+	}
+	return nullptr;
+}
+
+void register_baked_font_renderer()
+{
+	if (TBBakedFontRenderer *fr = new TBBakedFontRenderer)
+		g_font_manager->AddRenderer(fr);
+}
+
+#endif // TB_FONT_RENDERER_BAKED
@@ -61,6 +61,7 @@ public:
 	virtual TBFontMetrics GetMetrics();
 	virtual bool RenderGlyph(TBFontGlyphData *dst_bitmap, UCS4 cp);
 	virtual void GetGlyphMetrics(TBGlyphMetrics *metrics, UCS4 cp);
+	virtual bool HasGlyph(UCS4 cp);
 private:
 	bool Load(FreetypeFace *face, int size);
 	bool Load(const char *filename, int size);
@@ -124,6 +125,11 @@ void FreetypeFontRenderer::GetGlyphMetrics(TBGlyphMetrics *metrics, UCS4 cp)
 	metrics->y = - slot->bitmap_top;
 }
 
+bool FreetypeFontRenderer::HasGlyph(UCS4 cp)
+{
+	return FT_Get_Char_Index(m_face->m_face, cp) != 0;
+}
+
 bool FreetypeFontRenderer::Load(FreetypeFace *face, int size)
 {
 	// Should not be possible to have a face if freetype is not initialized
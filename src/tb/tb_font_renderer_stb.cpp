@@ -31,6 +31,7 @@ public:
 	virtual TBFontMetrics GetMetrics();
 	virtual bool RenderGlyph(TBFontGlyphData *dst_bitmap, UCS4 cp);
 	virtual void GetGlyphMetrics(TBGlyphMetrics *metrics, UCS4 cp);
+	virtual bool HasGlyph(UCS4 cp);
 private:
 	stbtt_fontinfo font;
 	TBTempBuffer ttf_buffer;
@@ -81,6 +82,11 @@ void STBFontRenderer::GetGlyphMetrics(TBGlyphMetrics *metrics, UCS4 cp)
 	metrics->y = iy0;
 }
 
+bool STBFontRenderer::HasGlyph(UCS4 cp)
+{
+	return stbtt_FindGlyphIndex(&font, cp) != 0;
+}
+
 bool STBFontRenderer::Load(const char *filename, int size)
 {
 	if (!ttf_buffer.AppendFile(filename))
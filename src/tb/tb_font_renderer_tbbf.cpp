@@ -74,6 +74,7 @@ public:
 	virtual TBFontMetrics GetMetrics();
 	virtual bool RenderGlyph(TBFontGlyphData *dst_bitmap, UCS4 cp);
 	virtual void GetGlyphMetrics(TBGlyphMetrics *metrics, UCS4 cp);
+	virtual bool HasGlyph(UCS4 cp);
 private:
 	TBNode m_node;
 	TBFontMetrics m_metrics;
@@ -136,6 +137,11 @@ void TBBFRenderer::GetGlyphMetrics(TBGlyphMetrics *metrics, UCS4 cp)
 		metrics->advance = glyph->w + m_advance_delta;
 }
 
+bool TBBFRenderer::HasGlyph(UCS4 cp)
+{
+	return cp == ' ' || m_glyph_table.Get(cp);
+}
+
 bool TBBFRenderer::Load(const char *filename, int size)
 {
 	m_size = size;
@@ -195,10 +201,10 @@ bool TBBFRenderer::FindGlyphs()
 	if (!glyph_str)
 		return false;
 
-	int glyph_str_len = strlen(glyph_str);
-	int i = 0;
+	utf8::span_decoder decoder(glyph_str, strlen(glyph_str));
+	UCS4 uc;
 	int x = 0;
-	while (UCS4 uc = utf8::decode_next(glyph_str, &i, glyph_str_len))
+	while (decoder.next(uc))
 	{
 		if (GLYPH *glyph = FindNext(uc, x))
 		{
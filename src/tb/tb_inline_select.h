@@ -29,7 +29,7 @@ public:
 	~TBInlineSelect();
 
 	/** Set along which axis the content should layouted. */
-	virtual void SetAxis(AXIS axis) { m_layout.SetAxis(axis); }
+	virtual void SetAxis(AXIS axis) { m_layout.SetAxis(axis); InvalidateSkinStates(); }
 	virtual AXIS GetAxis() const { return m_layout.GetAxis(); }
 
 	void SetLimits(int min, int max);
@@ -18,6 +18,7 @@ TBLayout::TBLayout(AXIS axis)
 	, m_overflow(0)
 	, m_overflow_scroll(0)
 	, m_packed_init(0)
+	, m_num_positioned(0)
 {
 	m_packed.layout_mode_size = LAYOUT_SIZE_GRAVITY;
 	m_packed.layout_mode_pos = LAYOUT_POSITION_CENTER;
@@ -395,11 +396,89 @@ void TBLayout::ValidateLayout(const SizeConstraints &constraints, PreferredSize
 
 		child->SetRect(RotRect(rect, m_axis));
 	}
+	UpdateChildPositions();
+
 	// Update overflow and overflow scroll
 	m_overflow = MAX(0, used_space - layout_rect.w);
 	SetOverflowScroll(m_overflow_scroll);
 }
 
+void TBLayout::UpdateChildPositions()
+{
+	m_packed.child_positions_valid = 0;
+	m_num_positioned = 0;
+	for (TBWidget *child = GetFirstChild(); child; child = child->GetNext())
+		if (child->GetVisibility() != WIDGET_VISIBILITY_GONE)
+			m_num_positioned++;
+	if (!m_child_positions.Reserve((sizeof(TBWidget *) + sizeof(int) * 2) * m_num_positioned))
+		return;
+	TBWidget **children = (TBWidget **) m_child_positions.GetData();
+	int *start = (int *) (children + m_num_positioned);
+	int *max_end = start + m_num_positioned;
+
+	int i = 0;
+	for (TBWidget *child = GetFirstInLayoutOrder(); child; child = GetNextInLayoutOrder(child))
+	{
+		if (child->GetVisibility() == WIDGET_VISIBILITY_GONE)
+			continue;
+		const TBRect rect = RotRect(child->GetRect(), m_axis);
+		// With negative spacing, children may not be in order. Then we can't search.
+		if (i > 0 && rect.x < start[i - 1])
+			return;
+		start[i] = rect.x;
+		max_end[i] = i > 0 ? MAX(max_end[i - 1], rect.x + rect.w) : rect.x + rect.w;
+		children[m_packed.mode_reverse_order ? m_num_positioned - 1 - i : i] = child;
+		i++;
+	}
+	m_packed.child_positions_valid = 1;
+}
+
+void TBLayout::OnChildRectChanged(TBWidget *child)
+{
+	// If a child is moved by something else than the layout, the positions are not
+	// valid anymore. ValidateLayout updates them after moving the children.
+	m_packed.child_positions_valid = 0;
+}
+
+int TBLayout::GetChildrenInRect(const TBRect &rect, TBWidget **&children) const
+{
+	if (m_packed.layout_is_invalid || !m_packed.child_positions_valid)
+		return TBWidget::GetChildrenInRect(rect, children);
+
+	TBWidget **positioned = (TBWidget **) m_child_positions.GetData();
+	const int *start = (const int *) (positioned + m_num_positioned);
+	const int *max_end = start + m_num_positioned;
+	const TBRect r = RotRect(rect, m_axis);
+
+	// Find the first child (in layout order) that ends after the rect start.
+	int lo = 0, hi = m_num_positioned;
+	while (lo < hi)
+	{
+		int mid = (lo + hi) >> 1;
+		if (max_end[mid] > r.x)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	const int first = lo;
+
+	// Find the first child (in layout order) that starts after the rect end.
+	hi = m_num_positioned;
+	while (lo < hi)
+	{
+		int mid = (lo + hi) >> 1;
+		if (start[mid] >= r.x + r.w)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	const int count = lo - first;
+
+	// The children are stored in z order, so map the range if the layout order is reversed.
+	children = positioned + (m_packed.mode_reverse_order ? m_num_positioned - first - count : first);
+	return count;
+}
+
 PreferredSize TBLayout::OnCalculatePreferredContentSize(const SizeConstraints &constraints)
 {
 	// Do a layout pass (without layouting) to check childrens preferences.
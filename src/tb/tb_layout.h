@@ -7,6 +7,7 @@
 #define TB_LAYOUT_H
 
 #include "tb_widgets.h"
+#include "tb_tempbuffer.h"
 
 namespace tb {
 
@@ -130,7 +131,9 @@ public:
 	virtual void OnProcess();
 	virtual void OnResized(int old_w, int old_h);
 	virtual void OnInflateChild(TBWidget *child);
+	virtual void OnChildRectChanged(TBWidget *child);
 	virtual void GetChildTranslation(int &x, int &y) const;
+	virtual int GetChildrenInRect(const TBRect &rect, TBWidget **&children) const;
 	virtual void ScrollTo(int x, int y);
 	virtual TBWidget::ScrollInfo GetScrollInfo();
 protected:
@@ -148,9 +151,16 @@ protected:
 			uint32 layout_mode_dist_pos		: 4;
 			uint32 mode_reverse_order		: 1;
 			uint32 paint_overflow_fadeout	: 1;
+			uint32 child_positions_valid	: 1;
 		} m_packed;
 		uint32 m_packed_init;
 	};
+	/** The laid out children, for finding the children in a rect with a binary search.
+		Contains m_num_positioned TBWidget pointers (in z order), followed by the start
+		position and the max end position so far, along the axis (in layout order). */
+	TBTempBuffer m_child_positions;
+	int m_num_positioned;
+	void UpdateChildPositions();
 	void ValidateLayout(const SizeConstraints &constraints, PreferredSize *calculate_ps = nullptr);
 	bool QualifyForExpansion(WIDGET_GRAVITY gravity) const;
 	int GetWantedHeight(WIDGET_GRAVITY gravity, const PreferredSize &ps, int available_height) const;
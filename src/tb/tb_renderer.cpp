@@ -4,11 +4,22 @@
 // ================================================================================
 
 #include "tb_renderer.h"
+#include "tb_bitmap_fragment.h"
 
 namespace tb {
 
 // == TBRenderer ========================================================================
 
+void TBRenderer::DrawGlyphRun(const GlyphRunItem *glyphs, int num_glyphs, const TBColor &color)
+{
+	for (int i = 0; i < num_glyphs; i++)
+	{
+		TBBitmapFragment *frag = glyphs[i].fragment;
+		DrawBitmapColored(TBRect(glyphs[i].x, glyphs[i].y, frag->Width(), frag->Height()),
+							TBRect(0, 0, frag->Width(), frag->Height()), color, frag);
+	}
+}
+
 void TBRenderer::InvokeContextLost()
 {
 	TBLinkListOf<TBRendererListener>::Iterator iter = m_listeners.IterateForward();
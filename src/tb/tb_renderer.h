@@ -100,6 +100,20 @@ public:
 	/** Draw the bitmap tiled into dst_rect. */
 	virtual void DrawBitmapTile(const TBRect &dst_rect, TBBitmap *bitmap) = 0;
 
+	/** A bitmap fragment and the position to draw it at, used by DrawGlyphRun. */
+	struct GlyphRunItem
+	{
+		TBBitmapFragment *fragment;
+		int x, y;
+	};
+
+	/** Draw a run of glyphs (unscaled bitmap fragments) at the given positions.
+		The fragments will be used as a mask for the color, like DrawBitmapColored.
+		All fragments should be in the same bitmap (f.ex the font glyph cache), which
+		lets batching renderers add all of them in one go.
+		The default implementation calls DrawBitmapColored for each glyph. */
+	virtual void DrawGlyphRun(const GlyphRunItem *glyphs, int num_glyphs, const TBColor &color);
+
 	/** Make sure the given bitmap fragment is flushed from any batching, because it may
 		be changed or deleted after this call. */
 	virtual void FlushBitmapFragment(TBBitmapFragment *bitmap_fragment) = 0;
@@ -164,6 +164,7 @@ TBWidget::ScrollInfo TBScrollContainer::GetScrollInfo()
 void TBScrollContainer::InvalidateLayout(INVALIDATE_LAYOUT il)
 {
 	m_layout_is_invalid = true;
+	RequestProcess();
 	// No recursion up to parents here unless we adapt to content size.
 	if (m_adapt_to_content_size)
 		TBWidget::InvalidateLayout(il);
@@ -12,6 +12,9 @@
 
 namespace tb {
 
+/** Number of rows above and below the viewport that get widgets in a virtualized list. */
+#define VIRTUAL_OVERSCAN_ROWS 4
+
 // == Sort callback for sorting items ===================================================
 
 int select_list_sort_cb(TBSelectItemSource *source, const int *a, const int *b)
@@ -20,6 +23,35 @@ int select_list_sort_cb(TBSelectItemSource *source, const int *a, const int *b)
 	return source->GetSort() == TB_SORT_DESCENDING ? -value : value;
 }
 
+/** The keys used when sorting. The item strings are copied, since GetItemString
+	may return a pointer that is only valid until the next call. */
+class TBSelectListSortKeys
+{
+public:
+	TBSelectListSortKeys(TBSelectItemSource *source) : source(source), oom(false) {}
+	TBSelectItemSource *source;
+	TBTempBuffer strings;
+	bool oom;
+};
+
+int select_list_sort_key(TBSelectListSortKeys *keys, const int *index)
+{
+	// Return the offset of the copied string, since the buffer may move while growing.
+	int ofs = keys->strings.GetAppendPos();
+	const char *str = keys->source->GetItemString(*index);
+	if (!keys->strings.Append(str, strlen(str) + 1))
+		keys->oom = true;
+	return ofs;
+}
+
+int select_list_sort_key_cb(TBSelectListSortKeys *keys, const int *a, const int *b)
+{
+	if (keys->oom)
+		return 0;
+	int value = strcmp(keys->strings.GetData() + *a, keys->strings.GetData() + *b);
+	return keys->source->GetSort() == TB_SORT_DESCENDING ? -value : value;
+}
+
 // == TBSelectList ==============================================
 
 TBSelectList::TBSelectList()
@@ -27,6 +59,13 @@ TBSelectList::TBSelectList()
 	, m_list_is_invalid(false)
 	, m_scroll_to_current(false)
 	, m_header_lng_string_id(TBIDC("TBList.header"))
+	, m_num_sorted_items(0)
+	, m_num_item_positions(0)
+	, m_sorted_items_sort(TB_SORT_NONE)
+	, m_sorted_items_valid(false)
+	, m_virtualized(false)
+	, m_virtual_row_height(0)
+	, m_row_height(1)
 {
 	SetSource(&m_default_source);
 	SetIsFocusable(true);
@@ -41,6 +80,7 @@ TBSelectList::TBSelectList()
 	m_layout.SetLayoutDistributionPosition(LAYOUT_DISTRIBUTION_POSITION_LEFT_TOP);
 	m_layout.SetLayoutSize(LAYOUT_SIZE_AVAILABLE);
 	m_container.GetContentRoot()->AddChild(&m_layout);
+	m_virtual_root.SetGravity(WIDGET_GRAVITY_ALL);
 	m_container.SetScrollMode(SCROLL_MODE_Y_AUTO);
 	m_container.SetAdaptContentSize(true);
 }
@@ -48,29 +88,61 @@ TBSelectList::TBSelectList()
 TBSelectList::~TBSelectList()
 {
 	m_layout.RemoveFromParent();
+	m_virtual_root.RemoveFromParent();
 	m_container.RemoveFromParent();
 	SetSource(nullptr);
 }
 
 void TBSelectList::OnSourceChanged()
 {
+	// Widgets created by the old source can't be reused by the new one.
+	DeleteItemWidgets();
 	InvalidateList();
 }
 
 void TBSelectList::OnItemChanged(int index)
 {
 	if (m_list_is_invalid) // We're updating all widgets soon.
+	{
+		m_sorted_items_valid = false;
 		return;
+	}
+
+	// Move or hide the item if its sort position or filter match has changed.
+	int pos = GetSortedPosition(index);
+	bool match = MatchesFilter(index);
+	if (pos == -1 ? match : (!match || !IsInSortOrder(pos)))
+	{
+		RemoveSortedItem(index, true);
+		if (match && !AddSortedItem(index))
+			InvalidateList();
+		UpdateHeaderWidget();
+		UpdateVirtualRows();
+		return;
+	}
 
 	TBWidget *old_widget = GetItemWidget(index);
 	if (!old_widget) // We don't have this widget so we have nothing to update.
 		return;
 
-	// Replace the old widget representing the item, with a new one. Preserve its state.
+	// Update the old widget representing the item, or replace it with a new one. Preserve its state.
 	WIDGET_STATE old_state = old_widget->GetStateRaw();
 
-	if (TBWidget *widget = CreateAndAddItemAfter(index, old_widget))
+	if (m_source->GetItemWidgetType(index) && m_source->RebindItemWidget(index, old_widget, this))
+	{
+		old_widget->SetStateRaw(old_state);
+		return;
+	}
+
+	if (TBWidget *widget = CreateAndAddItem(index, WIDGET_Z_REL_AFTER, old_widget))
+	{
 		widget->SetStateRaw(old_state);
+		if (m_virtualized)
+		{
+			widget->SetGravity(old_widget->GetGravity());
+			widget->SetRect(old_widget->GetRect());
+		}
+	}
 
 	old_widget->RemoveFromParent();
 	delete old_widget;
@@ -78,22 +150,54 @@ void TBSelectList::OnItemChanged(int index)
 
 void TBSelectList::OnItemAdded(int index)
 {
+	if (m_value >= index)
+		m_value++;
 	if (m_list_is_invalid) // We're updating all widgets soon.
+	{
+		m_sorted_items_valid = false;
 		return;
+	}
 
-	// Sorting, filtering etc. makes it messy to handle dynamic addition of items.
-	// Resort to invalidate the entire list (may even be faster anyway)
-	InvalidateList();
+	// The header appears with the first item.
+	if (GetNumHeaderRows() && m_source->GetNumItems() == 1)
+	{
+		InvalidateList();
+		return;
+	}
+
+	// Update only the widget of the new item (if it should be shown), keeping
+	// the scroll position and selection.
+	if (!ShiftItemIndexes(index, 1) || (MatchesFilter(index) && !AddSortedItem(index)))
+		InvalidateList();
+	UpdateHeaderWidget();
+	UpdateVirtualRows();
 }
 
 void TBSelectList::OnItemRemoved(int index)
 {
+	if (m_value == index)
+		m_value = -1;
+	else if (m_value > index)
+		m_value--;
 	if (m_list_is_invalid) // We're updating all widgets soon.
+	{
+		m_sorted_items_valid = false;
 		return;
+	}
 
-	// Sorting, filtering etc. makes it messy to handle dynamic addition of items.
-	// Resort to invalidate the entire list (may even be faster anyway)
-	InvalidateList();
+	// The header disappears with the last item.
+	if (!m_source->GetNumItems())
+	{
+		InvalidateList();
+		return;
+	}
+
+	// The item no longer exists so its widget type is unknown. Don't recycle it.
+	RemoveSortedItem(index, false);
+	if (!ShiftItemIndexes(index + 1, -1))
+		InvalidateList();
+	UpdateHeaderWidget();
+	UpdateVirtualRows();
 }
 
 void TBSelectList::OnAllItemsRemoved()
@@ -110,7 +214,8 @@ void TBSelectList::SetFilter(const char *filter)
 	if (m_filter.Equals(new_filter))
 		return;
 	m_filter.Set(new_filter);
-	InvalidateList();
+	// The items shown may be found by filtering the previous ones, in ValidateList.
+	InvalidateItemWidgets();
 }
 
 void TBSelectList::SetHeaderString(const TBID& id)
@@ -118,87 +223,456 @@ void TBSelectList::SetHeaderString(const TBID& id)
 	if (m_header_lng_string_id == id)
 		return;
 	m_header_lng_string_id = id;
-	InvalidateList();
+	InvalidateItemWidgets();
 }
 
 void TBSelectList::InvalidateList()
+{
+	m_sorted_items_valid = false;
+	InvalidateItemWidgets();
+}
+
+void TBSelectList::InvalidateItemWidgets()
 {
 	if (m_list_is_invalid)
 		return;
 	m_list_is_invalid = true;
+	RequestProcess();
 	Invalidate();
 }
 
+void TBSelectList::SetVirtualized(bool virtualized, int row_height)
+{
+	if (virtualized == m_virtualized && row_height == m_virtual_row_height)
+		return;
+	// Item widgets are sized differently when virtualized, so don't reuse them.
+	DeleteItemWidgets();
+	if (virtualized != m_virtualized)
+	{
+		GetItemRoot()->RemoveFromParent();
+		m_virtualized = virtualized;
+		m_container.GetContentRoot()->AddChild(GetItemRoot());
+		// Poll the scroll position to update the rows that have widgets.
+		SetWantProcessAlways(virtualized);
+	}
+	m_virtual_row_height = row_height;
+	InvalidateItemWidgets();
+}
+
 void TBSelectList::ValidateList()
 {
 	if (!m_list_is_invalid)
 		return;
 	m_list_is_invalid = false;
-	// FIX: Could delete and create only the changed items (faster filter change)
 
-	// Remove old items
-	while (TBWidget *child = m_layout.GetContentRoot()->GetFirstChild())
+	// Invalidate the layout once, instead of for each removed and added item.
+	TBWidget *item_root = GetItemRoot();
+	TBWidgetUpdateBlocker update_blocker(item_root);
+
+	// Remove old items, keeping them for reuse by new items of the same type.
+	while (TBWidget *child = item_root->GetFirstChild())
 	{
 		child->RemoveFromParent();
-		delete child;
+		RecycleItemWidget(child);
 	}
+	// If only the filter has changed, and the new filter contains the old one, the items
+	// to show are among the items shown now. Filter those instead of all items. That also
+	// keeps them sorted. It requires a Filter that never matches more items with a longer
+	// filter (See TBSelectItemSource::IsFilterNarrowing). The default source has the
+	// default Filter.
+	const bool refilter = m_sorted_items_valid && m_source && !m_filter.IsEmpty() &&
+		(m_source == &m_default_source || m_source->IsFilterNarrowing()) &&
+		m_sorted_items_sort == m_source->GetSort() &&
+		(m_sorted_items_filter.IsEmpty() || stristr(m_filter, m_sorted_items_filter));
+	const int num_old_sorted_items = m_num_sorted_items;
+	m_num_sorted_items = 0;
+	m_num_item_positions = 0;
+	m_sorted_items_valid = false;
 	if (!m_source || !m_source->GetNumItems())
+	{
+		m_item_pool.Clear();
+		UpdateVirtualRows();
 		return;
+	}
 
 	// Create a sorted list of the items we should include using the current filter.
-	TBTempBuffer sort_buf;
-	if (!sort_buf.Reserve(m_source->GetNumItems() * sizeof(int)))
+	const int num_items = m_source->GetNumItems();
+	if (!m_sorted_items.Reserve(num_items * sizeof(int)) ||
+		!m_item_positions.Reserve(num_items * sizeof(int)))
 		return; // Out of memory
-	int *sorted_index = (int *) sort_buf.GetData();
+	int *sorted_index = (int *) m_sorted_items.GetData();
 
-	// Populate the sorted index list
 	int num_sorted_items = 0;
-	for (int i = 0; i < m_source->GetNumItems(); i++)
-		if (m_filter.IsEmpty() || m_source->Filter(i, m_filter))
-			sorted_index[num_sorted_items++] = i;
-
-	// Sort
-	if (m_source->GetSort() != TB_SORT_NONE)
-		insertion_sort<TBSelectItemSource*, int>(sorted_index, num_sorted_items, m_source, select_list_sort_cb);
+	if (refilter)
+		num_sorted_items = m_source->FilterItems(m_filter, sorted_index, num_old_sorted_items, sorted_index);
+	else
+	{
+		// Populate the sorted index list
+		if (m_filter.IsEmpty())
+			for (int i = 0; i < m_source->GetNumItems(); i++)
+				sorted_index[num_sorted_items++] = i;
+		else
+			num_sorted_items = m_source->FilterItems(m_filter, nullptr, 0, sorted_index);
 
-	// Show header if we only show a subset of all items.
-	if (!m_filter.IsEmpty())
+		// Sort. Get the string of each item once, instead of for each comparison.
+		if (m_source->GetSort() != TB_SORT_NONE)
+		{
+			TBSelectListSortKeys keys(m_source);
+			if (!merge_sort_by_key<TBSelectListSortKeys*, int, int>(sorted_index, num_sorted_items, &keys,
+																	select_list_sort_key, select_list_sort_key_cb) ||
+				keys.oom)
+				merge_sort<TBSelectItemSource*, int>(sorted_index, num_sorted_items, m_source, select_list_sort_cb);
+		}
+	}
+	m_num_sorted_items = num_sorted_items;
+	m_num_item_positions = num_items;
+	int *item_positions = (int *) m_item_positions.GetData();
+	for (int i = 0; i < num_items; i++)
+		item_positions[i] = -1;
+	UpdateItemPositions(0);
+	m_sorted_items_filter.Set(m_filter);
+	m_sorted_items_sort = m_source->GetSort();
+	m_sorted_items_valid = true;
+
+	if (m_virtualized)
 	{
-		if (TBWidget *widget = new TBTextField())
+		// Estimate the row height from the first item. Its widget goes back to
+		// the pool, so UpdateVirtualRows can use it.
+		m_row_height = m_virtual_row_height;
+		if (!m_row_height && num_sorted_items)
 		{
-			TBStr str;
-			str.SetFormatted(g_tb_lng->GetString(m_header_lng_string_id), num_sorted_items, m_source->GetNumItems());
-			widget->SetText(str);
-			widget->SetSkinBg(TBIDC("TBList.header"));
-			widget->SetState(WIDGET_STATE_DISABLED, true);
-			widget->SetGravity(WIDGET_GRAVITY_ALL);
-			widget->data.SetInt(-1);
-			m_layout.GetContentRoot()->AddChild(widget);
+			int index = sorted_index[0];
+			TBWidget *widget = m_item_pool.GetAndRebind(m_source, index, this);
+			if (widget || (widget = m_source->CreateItemWidget(index, this)))
+			{
+				widget->data.SetInt(index);
+				m_row_height = widget->GetPreferredSize().pref_h;
+				RecycleItemWidget(widget);
+			}
 		}
+		m_row_height = MAX(m_row_height, 1);
+		UpdateVirtualRows();
+	}
+	else
+	{
+		// Show header if we only show a subset of all items.
+		if (GetNumHeaderRows())
+			if (TBWidget *widget = CreateHeaderWidget())
+				item_root->AddChild(widget);
+
+		// Create new items
+		for (int i = 0; i < num_sorted_items; i++)
+			CreateAndAddItem(sorted_index[i], WIDGET_Z_REL_AFTER, nullptr);
 	}
 
-	// Create new items
-	for (int i = 0; i < num_sorted_items; i++)
-		CreateAndAddItemAfter(sorted_index[i], nullptr);
+	// Keep no more widgets for reuse than there are in use, so the widgets of all
+	// items are not kept when the filter has narrowed down the list.
+	int num_widgets_in_use = 0;
+	for (TBWidget *child = item_root->GetFirstChild(); child; child = child->GetNext())
+		num_widgets_in_use++;
+	m_item_pool.Trim(num_widgets_in_use);
 
 	SelectItem(m_value, true);
 
 	// FIX: Should not scroll just because we update the list. Only automatically first time!
 	m_scroll_to_current = true;
+	RequestProcess();
 }
 
-TBWidget *TBSelectList::CreateAndAddItemAfter(int index, TBWidget *reference)
+TBWidget *TBSelectList::CreateAndAddItem(int index, WIDGET_Z_REL z, TBWidget *reference)
 {
-	if (TBWidget *widget = m_source->CreateItemWidget(index, this))
+	TBWidget *widget = m_item_pool.GetAndRebind(m_source, index, this);
+	if (widget || (widget = m_source->CreateItemWidget(index, this)))
 	{
 		// Use item data as widget to index lookup
 		widget->data.SetInt(index);
-		m_layout.GetContentRoot()->AddChildRelative(widget, WIDGET_Z_REL_AFTER, reference);
+		GetItemRoot()->AddChildRelative(widget, z, reference);
 		return widget;
 	}
 	return nullptr;
 }
 
+TBWidget *TBSelectList::CreateHeaderWidget()
+{
+	TBWidget *widget = new TBTextField();
+	if (!widget)
+		return nullptr;
+	SetHeaderWidgetText(widget);
+	widget->SetSkinBg(TBIDC("TBList.header"));
+	widget->SetState(WIDGET_STATE_DISABLED, true);
+	widget->SetGravity(WIDGET_GRAVITY_ALL);
+	widget->data.SetInt(-1);
+	return widget;
+}
+
+void TBSelectList::SetHeaderWidgetText(TBWidget *widget)
+{
+	TBStr str;
+	str.SetFormatted(g_tb_lng->GetString(m_header_lng_string_id), m_num_sorted_items, m_source->GetNumItems());
+	widget->SetText(str);
+}
+
+void TBSelectList::UpdateHeaderWidget()
+{
+	TBWidget *widget = GetItemRoot()->GetFirstChild();
+	if (widget && widget->data.GetInt() == -1)
+		SetHeaderWidgetText(widget);
+}
+
+int TBSelectList::CompareSortedItems(int a, int b)
+{
+	int value = m_source->GetSort() != TB_SORT_NONE ? select_list_sort_cb(m_source, &a, &b) : 0;
+	// Equal items are kept in source order, like the stable sort in ValidateList.
+	return value ? value : a - b;
+}
+
+bool TBSelectList::MatchesFilter(int index)
+{
+	int result;
+	return m_filter.IsEmpty() || m_source->FilterItems(m_filter, &index, 1, &result) == 1;
+}
+
+int TBSelectList::GetSortedPosition(int index) const
+{
+	if (index < 0 || index >= m_num_item_positions)
+		return -1;
+	return ((const int *) m_item_positions.GetData())[index];
+}
+
+void TBSelectList::UpdateItemPositions(int first_pos)
+{
+	const int *sorted_index = (const int *) m_sorted_items.GetData();
+	int *item_positions = (int *) m_item_positions.GetData();
+	for (int i = first_pos; i < m_num_sorted_items; i++)
+		item_positions[sorted_index[i]] = i;
+}
+
+bool TBSelectList::IsInSortOrder(int pos)
+{
+	const int *sorted_index = (const int *) m_sorted_items.GetData();
+	return (pos == 0 || CompareSortedItems(sorted_index[pos - 1], sorted_index[pos]) < 0) &&
+		(pos == m_num_sorted_items - 1 || CompareSortedItems(sorted_index[pos], sorted_index[pos + 1]) < 0);
+}
+
+bool TBSelectList::AddSortedItem(int index)
+{
+	const int needed_size = (m_num_sorted_items + 1) * sizeof(int);
+	if (needed_size > m_sorted_items.GetCapacity() && !m_sorted_items.Reserve(needed_size * 2))
+		return false;
+
+	// Find the position with a binary search, since the items are already sorted.
+	int *sorted_index = (int *) m_sorted_items.GetData();
+	int low = 0, high = m_num_sorted_items;
+	while (low < high)
+	{
+		int mid = (low + high) / 2;
+		if (CompareSortedItems(index, sorted_index[mid]) < 0)
+			high = mid;
+		else
+			low = mid + 1;
+	}
+	memmove(&sorted_index[low + 1], &sorted_index[low], (m_num_sorted_items - low) * sizeof(int));
+	sorted_index[low] = index;
+	m_num_sorted_items++;
+	UpdateItemPositions(low);
+
+	const int row = low + GetNumHeaderRows();
+	if (m_virtualized)
+	{
+		MoveVirtualRows(row, 1); // The row gets a widget in UpdateVirtualRows.
+		return true;
+	}
+	TBWidget *reference = GetItemRoot()->GetChildFromIndex(row);
+	TBWidget *widget = CreateAndAddItem(index, reference ? WIDGET_Z_REL_BEFORE : WIDGET_Z_REL_AFTER, reference);
+	if (!widget)
+		return false;
+	if (index == m_value)
+		widget->SetState(WIDGET_STATE_SELECTED, true);
+	return true;
+}
+
+void TBSelectList::RemoveSortedItem(int index, bool recycle_widget)
+{
+	int pos = GetSortedPosition(index);
+	if (pos == -1)
+		return;
+	int *sorted_index = (int *) m_sorted_items.GetData();
+	memmove(&sorted_index[pos], &sorted_index[pos + 1], (m_num_sorted_items - pos - 1) * sizeof(int));
+	m_num_sorted_items--;
+	((int *) m_item_positions.GetData())[index] = -1;
+	UpdateItemPositions(pos);
+
+	if (TBWidget *widget = GetItemWidget(index))
+	{
+		widget->RemoveFromParent();
+		if (recycle_widget)
+			RecycleItemWidget(widget);
+		else
+			delete widget;
+	}
+	if (m_virtualized)
+		MoveVirtualRows(pos + GetNumHeaderRows() + 1, -1);
+}
+
+bool TBSelectList::ShiftItemIndexes(int first_index, int delta)
+{
+	// Fail if the positions don't include the shifted items (f.ex after OOM in ValidateList).
+	const int needed_size = (m_num_item_positions + delta) * sizeof(int);
+	if (first_index > m_num_item_positions ||
+		(needed_size > m_item_positions.GetCapacity() && !m_item_positions.Reserve(needed_size * 2)))
+		return false;
+	int *sorted_index = (int *) m_sorted_items.GetData();
+	for (int i = 0; i < m_num_sorted_items; i++)
+		if (sorted_index[i] >= first_index)
+			sorted_index[i] += delta;
+	for (TBWidget *child = GetItemRoot()->GetFirstChild(); child; child = child->GetNext())
+		if (child->data.GetInt() >= first_index)
+			child->data.SetInt(child->data.GetInt() + delta);
+
+	// Move the positions with the items. Inserted items are not shown yet, and removed
+	// items must already have been removed with RemoveSortedItem.
+	int *item_positions = (int *) m_item_positions.GetData();
+	memmove(&item_positions[first_index + delta], &item_positions[first_index], (m_num_item_positions - first_index) * sizeof(int));
+	for (int i = first_index; i < first_index + delta; i++)
+		item_positions[i] = -1;
+	m_num_item_positions += delta;
+	return true;
+}
+
+void TBSelectList::RecycleItemWidget(TBWidget *widget)
+{
+	int index = widget->data.GetInt();
+	bool is_item = m_source && index >= 0 && index < m_source->GetNumItems();
+	m_item_pool.Recycle(widget, is_item ? m_source->GetItemWidgetType(index) : TBID());
+}
+
+void TBSelectList::DeleteItemWidgets()
+{
+	while (TBWidget *child = GetItemRoot()->GetFirstChild())
+	{
+		child->RemoveFromParent();
+		delete child;
+	}
+	m_item_pool.Clear();
+}
+
+int TBSelectList::GetNumHeaderRows() const
+{
+	// The header is the first row when only a subset of all items are shown.
+	return !m_filter.IsEmpty() && m_source && m_source->GetNumItems() ? 1 : 0;
+}
+
+int TBSelectList::GetNumVirtualRows() const
+{
+	return m_num_sorted_items + GetNumHeaderRows();
+}
+
+int TBSelectList::GetVirtualRowItem(int row) const
+{
+	int header_rows = GetNumHeaderRows();
+	if (row < header_rows)
+		return -1;
+	return ((const int *) m_sorted_items.GetData())[row - header_rows];
+}
+
+int TBSelectList::GetVirtualRowFromItem(int index) const
+{
+	if (index < 0)
+		return -1;
+	int pos = GetSortedPosition(index);
+	return pos == -1 ? -1 : pos + GetNumHeaderRows();
+}
+
+void TBSelectList::MoveVirtualRows(int first_row, int delta)
+{
+	for (TBWidget *child = m_virtual_root.GetFirstChild(); child; child = child->GetNext())
+	{
+		TBRect rect = child->GetRect();
+		if (rect.y / m_row_height >= first_row)
+			child->SetRect(rect.Offset(0, delta * m_row_height));
+	}
+}
+
+bool TBSelectList::GetVirtualRowSelectable(int row)
+{
+	int index = GetVirtualRowItem(row);
+	if (index == -1)
+		return false;
+	if (TBWidget *widget = GetItemWidget(index))
+		return !widget->GetDisabled();
+	// Only separators are disabled by default.
+	const char *string = m_source->GetItemString(index);
+	return !(string && *string == '-');
+}
+
+void TBSelectList::UpdateVirtualRows()
+{
+	if (!m_virtualized || m_list_is_invalid)
+		return;
+
+	// Size the content from the number of rows, so the scroll range is right.
+	const int num_rows = GetNumVirtualRows();
+	const int content_h = num_rows * m_row_height;
+	const LayoutParams *old_lp = m_virtual_root.GetLayoutParams();
+	if (!old_lp || old_lp->pref_h != content_h)
+	{
+		LayoutParams lp;
+		lp.SetHeight(content_h);
+		m_virtual_root.SetLayoutParams(lp);
+	}
+
+	// Find the rows intersecting the viewport.
+	const int scroll_y = m_container.GetScrollInfo().y;
+	const int visible_h = m_container.GetPaddingRect().h;
+	const int last_row = MIN((scroll_y + visible_h + m_row_height - 1) / m_row_height + VIRTUAL_OVERSCAN_ROWS, num_rows);
+	const int first_row = MIN(MAX(scroll_y / m_row_height - VIRTUAL_OVERSCAN_ROWS, 0), last_row);
+
+	TBWidgetUpdateBlocker update_blocker(&m_virtual_root);
+
+	// Recycle widgets for rows outside the range. The widgets are positioned by row,
+	// and kept in the same order.
+	for (TBWidget *child = m_virtual_root.GetFirstChild(), *next; child; child = next)
+	{
+		next = child->GetNext();
+		int row = child->GetRect().y / m_row_height;
+		if (row < first_row || row >= last_row)
+		{
+			child->RemoveFromParent();
+			RecycleItemWidget(child);
+		}
+	}
+
+	// Add widgets for the rows in range that don't have one, and update the size of the others.
+	const int row_w = m_virtual_root.GetRect().w;
+	TBWidget *child = m_virtual_root.GetFirstChild();
+	for (int row = first_row; row < last_row; row++)
+	{
+		if (child && child->GetRect().y / m_row_height == row)
+		{
+			child->SetRect(TBRect(0, row * m_row_height, row_w, m_row_height));
+			child = child->GetNext();
+			continue;
+		}
+		int index = GetVirtualRowItem(row);
+		TBWidget *widget = nullptr;
+		if (index == -1)
+		{
+			if ((widget = CreateHeaderWidget()))
+				m_virtual_root.AddChildRelative(widget, child ? WIDGET_Z_REL_BEFORE : WIDGET_Z_REL_AFTER, child);
+		}
+		else
+			widget = CreateAndAddItem(index, child ? WIDGET_Z_REL_BEFORE : WIDGET_Z_REL_AFTER, child);
+		if (widget)
+		{
+			// Rows are positioned by us, so they shouldn't move when the content is resized.
+			widget->SetGravity(WIDGET_GRAVITY_LEFT_RIGHT | WIDGET_GRAVITY_TOP);
+			widget->SetRect(TBRect(0, row * m_row_height, row_w, m_row_height));
+			if (index == m_value && index != -1)
+				widget->SetState(WIDGET_STATE_SELECTED, true);
+		}
+	}
+}
+
 void TBSelectList::SetValue(int value)
 {
 	if (value == m_value)
@@ -232,7 +706,7 @@ TBWidget *TBSelectList::GetItemWidget(int index)
 {
 	if (index == -1)
 		return nullptr;
-	for (TBWidget *tmp = m_layout.GetContentRoot()->GetFirstChild(); tmp; tmp = tmp->GetNext())
+	for (TBWidget *tmp = GetItemRoot()->GetFirstChild(); tmp; tmp = tmp->GetNext())
 		if (tmp->data.GetInt() == index)
 			return tmp;
 	return nullptr;
@@ -246,7 +720,17 @@ void TBSelectList::ScrollToSelectedItem()
 		return;
 	}
 	m_scroll_to_current = false;
-	if (TBWidget *widget = GetItemWidget(m_value))
+	if (m_virtualized)
+	{
+		int row = GetVirtualRowFromItem(m_value);
+		if (row != -1)
+			m_container.ScrollIntoView(TBRect(0, row * m_row_height, m_virtual_root.GetRect().w, m_row_height));
+		else
+			m_container.ScrollTo(0, 0);
+		// Make sure the selected item has a widget right away.
+		UpdateVirtualRows();
+	}
+	else if (TBWidget *widget = GetItemWidget(m_value))
 		m_container.ScrollIntoView(widget->GetRect());
 	else
 		m_container.ScrollTo(0, 0);
@@ -266,11 +750,12 @@ void TBSelectList::OnProcessAfterChildren()
 {
 	if (m_scroll_to_current)
 		ScrollToSelectedItem();
+	UpdateVirtualRows();
 }
 
 bool TBSelectList::OnEvent(const TBWidgetEvent &ev)
 {
-	if (ev.type == EVENT_TYPE_CLICK && ev.target->GetParent() == m_layout.GetContentRoot())
+	if (ev.type == EVENT_TYPE_CLICK && ev.target->GetParent() == GetItemRoot())
 	{
 		// SetValue (EVENT_TYPE_CHANGED) might cause something to delete this (f.ex closing
 		// the dropdown menu. We want to sent another event, so ensure we're still around.
@@ -319,7 +804,7 @@ bool TBSelectList::OnEvent(const TBWidgetEvent &ev)
 
 bool TBSelectList::ChangeValue(SPECIAL_KEY key)
 {
-	if (!m_source || !m_layout.GetContentRoot()->GetFirstChild())
+	if (!m_source || !GetItemRoot()->GetFirstChild())
 		return false;
 
 	bool forward;
@@ -330,6 +815,27 @@ bool TBSelectList::ChangeValue(SPECIAL_KEY key)
 	else
 		return false;
 
+	if (m_virtualized)
+	{
+		// Navigate by row, since most items don't have any widget.
+		const int num_rows = GetNumVirtualRows();
+		int row = GetVirtualRowFromItem(m_value);
+		int origin = -1;
+		if (key == TB_KEY_HOME || (row == -1 && key == TB_KEY_DOWN))
+			row = 0;
+		else if (key == TB_KEY_END || (row == -1 && key == TB_KEY_UP))
+			row = num_rows - 1;
+		else
+			origin = row;
+		for (; row >= 0 && row < num_rows; row += forward ? 1 : -1)
+			if (row != origin && GetVirtualRowSelectable(row))
+			{
+				SetValue(GetVirtualRowItem(row));
+				return true;
+			}
+		return false;
+	}
+
 	TBWidget *item_root = m_layout.GetContentRoot();
 	TBWidget *current = GetItemWidget(m_value);
 	TBWidget *origin = nullptr;
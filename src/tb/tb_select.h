@@ -9,6 +9,7 @@
 #include "tb_window.h"
 #include "tb_scroll_container.h"
 #include "tb_select_item.h"
+#include "tb_tempbuffer.h"
 
 namespace tb {
 
@@ -51,6 +52,18 @@ public:
 	/** Make sure the list is reflecting the current items in the source. */
 	void ValidateList();
 
+	/** Set if the list should be virtualized. A virtualized list only has widgets for
+		the items that are visible in the scroll viewport (and a few rows above and below),
+		so it stays fast with a very large number of items.
+
+		All rows in a virtualized list have the same height. row_height specifies it, or
+		if it's 0 it's estimated from the preferred height of the first item.
+
+		Note: GetItemWidget returns nullptr for items that are scrolled out of view in
+		a virtualized list. */
+	void SetVirtualized(bool virtualized, int row_height = 0);
+	bool GetVirtualized() const { return m_virtualized; }
+
 	/** The value is the selected item. In lists with multiple selectable
 		items it's the item that is the current focus. */
 	virtual void SetValue(int value);
@@ -71,6 +84,8 @@ public:
 	/** Set the selected state of the item at the given index. If you want
 		to unselect the previously selected item, use SetValue. */
 	void SelectItem(int index, bool selected);
+
+	/** Get the widget for the item at the given index, or nullptr if the item isn't shown. */
 	TBWidget *GetItemWidget(int index);
 
 	/** Scroll to the current selected item. The scroll may be delayed until
@@ -96,13 +111,47 @@ protected:
 	TBScrollContainer m_container;
 	TBLayout m_layout;
 	TBGenericStringItemSource m_default_source;
+	TBItemWidgetPool m_item_pool;	///< Item widgets kept for reuse when the list is updated.
 	int m_value;
 	TBStr m_filter;
 	bool m_list_is_invalid;
 	bool m_scroll_to_current;
 	TBID m_header_lng_string_id;
+	TBTempBuffer m_sorted_items;	///< Index of the items shown with the current filter, in sort order.
+	int m_num_sorted_items;
+	TBTempBuffer m_item_positions;	///< Position in m_sorted_items of each item, or -1 if not shown.
+	int m_num_item_positions;
+	TBStr m_sorted_items_filter;	///< The filter m_sorted_items was created with.
+	TB_SORT m_sorted_items_sort;	///< The sort m_sorted_items was created with.
+	bool m_sorted_items_valid;		///< If m_sorted_items is still valid except for filter changes.
+	TBWidget m_virtual_root;		///< Parent of the item widgets when virtualized.
+	bool m_virtualized;
+	int m_virtual_row_height;		///< Row height set by SetVirtualized (0 means estimated).
+	int m_row_height;				///< Row height used when virtualized.
 private:
-	TBWidget *CreateAndAddItemAfter(int index, TBWidget *reference);
+	TBWidget *GetItemRoot() { return m_virtualized ? &m_virtual_root : m_layout.GetContentRoot(); }
+	void InvalidateItemWidgets();
+	bool MatchesFilter(int index);
+	TBWidget *CreateAndAddItem(int index, WIDGET_Z_REL z, TBWidget *reference);
+	TBWidget *CreateHeaderWidget();
+	void SetHeaderWidgetText(TBWidget *widget);
+	void UpdateHeaderWidget();
+	int CompareSortedItems(int a, int b);
+	int GetSortedPosition(int index) const;
+	void UpdateItemPositions(int first_pos);
+	bool IsInSortOrder(int pos);
+	bool AddSortedItem(int index);
+	void RemoveSortedItem(int index, bool recycle_widget);
+	bool ShiftItemIndexes(int first_index, int delta);
+	void RecycleItemWidget(TBWidget *widget);
+	void DeleteItemWidgets();
+	int GetNumHeaderRows() const;
+	int GetNumVirtualRows() const;
+	int GetVirtualRowItem(int row) const;
+	int GetVirtualRowFromItem(int index) const;
+	bool GetVirtualRowSelectable(int row);
+	void MoveVirtualRows(int first_row, int delta);
+	void UpdateVirtualRows();
 };
 
 /** TBSelectDropdown shows a button that opens a popup with a TBSelectList with items
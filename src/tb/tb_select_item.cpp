@@ -7,8 +7,11 @@
 #include "tb_menu_window.h"
 #include "tb_widgets_listener.h"
 #include "tb_language.h"
+#include "tb_tempbuffer.h"
+#include "tb_sort.h"
 #include <assert.h>
 #include <stdlib.h>
+#include <ctype.h>
 
 namespace tb {
 
@@ -21,8 +24,18 @@ namespace tb {
 class TBSimpleLayoutItemWidget : public TBLayout, private TBWidgetListener
 {
 public:
+	// For safe typecasting
+	TBOBJECT_SUBCLASS(TBSimpleLayoutItemWidget, TBLayout);
+
 	TBSimpleLayoutItemWidget(TBID image, TBSelectItemSource *source, const char *str);
 	~TBSimpleLayoutItemWidget();
+
+	/** Set the content of the item. */
+	void Bind(TBID image, TBSelectItemSource *source, const char *str);
+
+	/** Close the submenu, if open. */
+	void CloseSubMenu();
+
 	virtual bool OnEvent(const TBWidgetEvent &ev);
 private:
 	TBSelectItemSource *m_source;
@@ -32,37 +45,46 @@ private:
 	TBMenuWindow *m_menu; ///< Points to the submenu window if opened
 	virtual void OnWidgetDelete(TBWidget *widget);
 	void OpenSubMenu();
-	void CloseSubMenu();
 };
 
 // == TBSimpleLayoutItemWidget ==============================================================================
 
 TBSimpleLayoutItemWidget::TBSimpleLayoutItemWidget(TBID image, TBSelectItemSource *source, const char *str)
-	: m_source(source)
+	: m_source(nullptr)
 	, m_menu(nullptr)
 {
 	SetSkinBg(TBIDC("TBSelectItem"));
 	SetLayoutDistribution(LAYOUT_DISTRIBUTION_AVAILABLE);
 	SetPaintOverflowFadeout(false);
 
+	m_image.SetIgnoreInput(true);
+	m_textfield.SetTextAlign(TB_TEXT_ALIGN_LEFT);
+	m_textfield.SetIgnoreInput(true);
+	m_image_arrow.SetSkinBg(TBIDC("arrow.right"));
+	m_image_arrow.SetIgnoreInput(true);
+	Bind(image, source, str);
+}
+
+void TBSimpleLayoutItemWidget::Bind(TBID image, TBSelectItemSource *source, const char *str)
+{
+	CloseSubMenu();
+	m_source = source;
+
+	m_image_arrow.RemoveFromParent();
+	m_textfield.RemoveFromParent();
+	m_image.RemoveFromParent();
+
 	if (image)
 	{
 		m_image.SetSkinBg(image);
-		m_image.SetIgnoreInput(true);
 		AddChild(&m_image);
 	}
 
 	m_textfield.SetText(str);
-	m_textfield.SetTextAlign(TB_TEXT_ALIGN_LEFT);
-	m_textfield.SetIgnoreInput(true);
 	AddChild(&m_textfield);
 
 	if (source)
-	{
-		m_image_arrow.SetSkinBg(TBIDC("arrow.right"));
-		m_image_arrow.SetIgnoreInput(true);
 		AddChild(&m_image_arrow);
-	}
 }
 
 TBSimpleLayoutItemWidget::~TBSimpleLayoutItemWidget()
@@ -116,6 +138,338 @@ void TBSimpleLayoutItemWidget::CloseSubMenu()
 	m_menu = nullptr;
 }
 
+/** TBSelectItemFilterCache keeps the item strings of a TBSelectItemSource in upper case,
+	so filtering can use strstr instead of calling GetItemString and stristr for each item.
+	Strings are converted the first time they are needed.
+
+	It can also keep a index of the three character sequences (trigrams) in the strings.
+	A item can only match a filter if it contains all trigrams of the filter, so only the
+	items that have the rarest trigram of the filter need to be checked.
+	The index is rebuilt on the next filtering when any item has changed. */
+
+class TBSelectItemFilterCache
+{
+public:
+	TBSelectItemFilterCache(TBSelectItemSource *source, bool ngram_index);
+	~TBSelectItemFilterCache();
+
+	/** Like TBSelectItemSource::FilterItems. Returns -1 if out of memory. */
+	int FilterItems(const char *filter, const int *candidates, int num_candidates, int *result);
+
+	bool GetIndexEnabled() const { return m_ngram_index; }
+
+	void OnItemChanged(int index);
+	void OnItemAdded(int index);
+	void OnItemRemoved(int index);
+	void OnAllItemsRemoved() { Clear(); }
+private:
+	const char *GetString(int index);
+	bool Match(int index, const char *upper_filter, const char *filter);
+	bool ValidateStrings();
+	bool ValidateIndex();
+	const int *FindTrigram(uint32 trigram, int &num_items) const;
+	void Clear();
+	void ClearIndex();
+	TBSelectItemSource *m_source;
+	bool m_ngram_index;
+	char **m_strings;			///< Upper case item strings. nullptr for strings not converted yet.
+	int m_num_strings;
+	int m_strings_capacity;
+	bool m_index_valid;
+	uint32 *m_trigrams;			///< All trigrams in the strings, sorted.
+	int *m_trigram_offsets;		///< Offset of the items of each trigram in m_trigram_items.
+	int *m_trigram_items;		///< Items containing each trigram, in index order.
+	int m_num_trigrams;
+};
+
+/** A trigram found in the string of a item. */
+struct FILTER_TRIGRAM
+{
+	uint32 trigram;
+	int index;
+};
+
+static int filter_trigram_cmp(void *context, const FILTER_TRIGRAM *a, const FILTER_TRIGRAM *b)
+{
+	return a->trigram < b->trigram ? -1 : (a->trigram > b->trigram ? 1 : 0);
+}
+
+static uint32 GetTrigram(const char *str)
+{
+	return (uint8) str[0] | ((uint8) str[1] << 8) | ((uint8) str[2] << 16);
+}
+
+/** Return a copy of str converted to upper case, like stristr compares. */
+static char *CreateUpperCaseString(const char *str)
+{
+	size_t len = strlen(str);
+	char *upper = (char *) malloc(len + 1);
+	if (upper)
+		for (size_t i = 0; i <= len; i++)
+			upper[i] = (char) toupper(str[i]);
+	return upper;
+}
+
+// == TBSelectItemFilterCache ===============================================================================
+
+TBSelectItemFilterCache::TBSelectItemFilterCache(TBSelectItemSource *source, bool ngram_index)
+	: m_source(source)
+	, m_ngram_index(ngram_index)
+	, m_strings(nullptr)
+	, m_num_strings(0)
+	, m_strings_capacity(0)
+	, m_index_valid(false)
+	, m_trigrams(nullptr)
+	, m_trigram_offsets(nullptr)
+	, m_trigram_items(nullptr)
+	, m_num_trigrams(0)
+{
+}
+
+TBSelectItemFilterCache::~TBSelectItemFilterCache()
+{
+	Clear();
+}
+
+void TBSelectItemFilterCache::Clear()
+{
+	ClearIndex();
+	for (int i = 0; i < m_num_strings; i++)
+		free(m_strings[i]);
+	free(m_strings);
+	m_strings = nullptr;
+	m_num_strings = m_strings_capacity = 0;
+}
+
+void TBSelectItemFilterCache::ClearIndex()
+{
+	free(m_trigrams);
+	free(m_trigram_offsets);
+	free(m_trigram_items);
+	m_trigrams = nullptr;
+	m_trigram_offsets = nullptr;
+	m_trigram_items = nullptr;
+	m_num_trigrams = 0;
+	m_index_valid = false;
+}
+
+void TBSelectItemFilterCache::OnItemChanged(int index)
+{
+	ClearIndex();
+	if (index >= 0 && index < m_num_strings)
+	{
+		free(m_strings[index]);
+		m_strings[index] = nullptr;
+	}
+}
+
+void TBSelectItemFilterCache::OnItemAdded(int index)
+{
+	ClearIndex();
+	if (!m_strings)
+		return;
+	if (m_num_strings + 1 != m_source->GetNumItems() || index < 0 || index > m_num_strings)
+	{
+		Clear(); // Out of sync, convert all strings again.
+		return;
+	}
+	if (m_num_strings == m_strings_capacity)
+	{
+		int new_capacity = m_strings_capacity * 2 + 16;
+		char **new_strings = (char **) realloc(m_strings, new_capacity * sizeof(char *));
+		if (!new_strings)
+		{
+			Clear();
+			return;
+		}
+		m_strings = new_strings;
+		m_strings_capacity = new_capacity;
+	}
+	memmove(&m_strings[index + 1], &m_strings[index], (m_num_strings - index) * sizeof(char *));
+	m_strings[index] = nullptr;
+	m_num_strings++;
+}
+
+void TBSelectItemFilterCache::OnItemRemoved(int index)
+{
+	ClearIndex();
+	if (!m_strings)
+		return;
+	if (m_num_strings - 1 != m_source->GetNumItems() || index < 0 || index >= m_num_strings)
+	{
+		Clear(); // Out of sync, convert all strings again.
+		return;
+	}
+	free(m_strings[index]);
+	memmove(&m_strings[index], &m_strings[index + 1], (m_num_strings - index - 1) * sizeof(char *));
+	m_num_strings--;
+}
+
+bool TBSelectItemFilterCache::ValidateStrings()
+{
+	const int num_items = m_source->GetNumItems();
+	if (m_strings && m_num_strings == num_items)
+		return true;
+	Clear();
+	if (!num_items)
+		return true;
+	if (!(m_strings = (char **) calloc(num_items, sizeof(char *))))
+		return false;
+	m_num_strings = m_strings_capacity = num_items;
+	return true;
+}
+
+const char *TBSelectItemFilterCache::GetString(int index)
+{
+	if (!m_strings[index])
+	{
+		const char *str = m_source->GetItemString(index);
+		m_strings[index] = CreateUpperCaseString(str ? str : "");
+	}
+	return m_strings[index];
+}
+
+bool TBSelectItemFilterCache::Match(int index, const char *upper_filter, const char *filter)
+{
+	if (const char *str = GetString(index))
+		return strstr(str, upper_filter) != nullptr;
+	return m_source->Filter(index, filter); // Out of memory
+}
+
+bool TBSelectItemFilterCache::ValidateIndex()
+{
+	if (m_index_valid)
+		return true;
+	ClearIndex();
+
+	// Collect the trigrams of all strings.
+	int num_found = 0;
+	for (int i = 0; i < m_num_strings; i++)
+	{
+		const char *str = GetString(i);
+		if (!str)
+			return false;
+		int len = strlen(str);
+		num_found += len > 2 ? len - 2 : 0;
+	}
+	FILTER_TRIGRAM *found = (FILTER_TRIGRAM *) malloc(num_found * sizeof(FILTER_TRIGRAM) + 1);
+	if (!found)
+		return false;
+	num_found = 0;
+	for (int i = 0; i < m_num_strings; i++)
+		for (const char *str = m_strings[i]; str[0] && str[1] && str[2]; str++)
+		{
+			found[num_found].trigram = GetTrigram(str);
+			found[num_found].index = i;
+			num_found++;
+		}
+
+	// Sort by trigram. The sort is stable so the items of each trigram stay in index order.
+	merge_sort<void *, FILTER_TRIGRAM>(found, num_found, nullptr, filter_trigram_cmp);
+
+	// Count the unique trigrams and items, and store them.
+	int num_trigrams = 0, num_items = 0;
+	for (int i = 0; i < num_found; i++)
+	{
+		if (!i || found[i].trigram != found[i - 1].trigram)
+			num_trigrams++, num_items++;
+		else if (found[i].index != found[i - 1].index)
+			num_items++;
+	}
+	m_trigrams = (uint32 *) malloc(num_trigrams * sizeof(uint32) + 1);
+	m_trigram_offsets = (int *) malloc((num_trigrams + 1) * sizeof(int));
+	m_trigram_items = (int *) malloc(num_items * sizeof(int) + 1);
+	if (!m_trigrams || !m_trigram_offsets || !m_trigram_items)
+	{
+		free(found);
+		ClearIndex();
+		return false;
+	}
+	num_items = 0;
+	for (int i = 0; i < num_found; i++)
+	{
+		if (!i || found[i].trigram != found[i - 1].trigram)
+		{
+			m_trigrams[m_num_trigrams] = found[i].trigram;
+			m_trigram_offsets[m_num_trigrams++] = num_items;
+			m_trigram_items[num_items++] = found[i].index;
+		}
+		else if (found[i].index != found[i - 1].index)
+			m_trigram_items[num_items++] = found[i].index;
+	}
+	m_trigram_offsets[m_num_trigrams] = num_items;
+	free(found);
+	m_index_valid = true;
+	return true;
+}
+
+const int *TBSelectItemFilterCache::FindTrigram(uint32 trigram, int &num_items) const
+{
+	int low = 0, high = m_num_trigrams;
+	while (low < high)
+	{
+		int mid = (low + high) / 2;
+		if (m_trigrams[mid] < trigram)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	if (low == m_num_trigrams || m_trigrams[low] != trigram)
+	{
+		num_items = 0;
+		return nullptr;
+	}
+	num_items = m_trigram_offsets[low + 1] - m_trigram_offsets[low];
+	return &m_trigram_items[m_trigram_offsets[low]];
+}
+
+int TBSelectItemFilterCache::FilterItems(const char *filter, const int *candidates, int num_candidates, int *result)
+{
+	TBTempBuffer upper_filter;
+	if (!upper_filter.AppendString(filter) || !ValidateStrings())
+		return -1;
+	for (char *c = upper_filter.GetData(); *c; c++)
+		*c = (char) toupper(*c);
+	const char *upper = upper_filter.GetData();
+
+	int num_results = 0;
+	if (candidates)
+	{
+		for (int i = 0; i < num_candidates; i++)
+			if (Match(candidates[i], upper, filter))
+				result[num_results++] = candidates[i];
+		return num_results;
+	}
+
+	// Only check the items that have the trigram of the filter with fewest items.
+	if (m_ngram_index && strlen(upper) > 2 && ValidateIndex())
+	{
+		const int *items = nullptr;
+		int num_items = 0;
+		for (const char *c = upper; c[2]; c++)
+		{
+			int num_trigram_items;
+			const int *trigram_items = FindTrigram(GetTrigram(c), num_trigram_items);
+			if (!trigram_items)
+				return 0; // No item has this trigram.
+			if (!items || num_trigram_items < num_items)
+			{
+				items = trigram_items;
+				num_items = num_trigram_items;
+			}
+		}
+		for (int i = 0; i < num_items; i++)
+			if (Match(items[i], upper, filter))
+				result[num_results++] = items[i];
+		return num_results;
+	}
+
+	for (int i = 0; i < m_num_strings; i++)
+		if (Match(i, upper, filter))
+			result[num_results++] = i;
+	return num_results;
+}
+
 // == TBSelectItemViewer ==============================================================================
 
 void TBSelectItemViewer::SetSource(TBSelectItemSource *source)
@@ -132,13 +486,12 @@ void TBSelectItemViewer::SetSource(TBSelectItemSource *source)
 	OnSourceChanged();
 }
 
-// == TBSelectItemSource ====================================================================================
-
 TBSelectItemSource::~TBSelectItemSource()
 {
 	// If this assert trig, you are deleting a model that's still set on some
 	// TBSelect widget. That might be dangerous.
 	assert(!m_viewers.HasLinks());
+	delete m_filter_cache;
 }
 
 bool TBSelectItemSource::Filter(int index, const char *filter)
@@ -149,6 +502,126 @@ bool TBSelectItemSource::Filter(int index, const char *filter)
 	return false;
 }
 
+int TBSelectItemSource::FilterItems(const char *filter, const int *candidates, int num_candidates, int *result)
+{
+	if (m_filter_cache)
+	{
+		int num_results = m_filter_cache->FilterItems(filter, candidates, num_candidates, result);
+		if (num_results >= 0)
+			return num_results;
+	}
+	int num_results = 0;
+	if (candidates)
+	{
+		for (int i = 0; i < num_candidates; i++)
+			if (Filter(candidates[i], filter))
+				result[num_results++] = candidates[i];
+	}
+	else
+	{
+		for (int i = 0; i < GetNumItems(); i++)
+			if (Filter(i, filter))
+				result[num_results++] = i;
+	}
+	return num_results;
+}
+
+void TBSelectItemSource::SetFilterCacheEnabled(bool enabled, bool ngram_index)
+{
+	if (m_filter_cache && (!enabled || m_filter_cache->GetIndexEnabled() != ngram_index))
+	{
+		delete m_filter_cache;
+		m_filter_cache = nullptr;
+	}
+	if (enabled && !m_filter_cache)
+		m_filter_cache = new TBSelectItemFilterCache(this, ngram_index);
+}
+
+/** TBSimpleTextItemWidget is the item widget for string-only items. */
+
+class TBSimpleTextItemWidget : public TBTextField
+{
+public:
+	// For safe typecasting
+	TBOBJECT_SUBCLASS(TBSimpleTextItemWidget, TBTextField);
+
+	TBSimpleTextItemWidget()
+	{
+		SetSkinBg("TBSelectItem");
+		SetTextAlign(TB_TEXT_ALIGN_LEFT);
+	}
+};
+
+// == TBItemWidgetPool ======================================================================================
+
+void TBItemWidgetPool::Recycle(TBWidget *widget, const TBID &type)
+{
+	assert(!widget->GetParent());
+	// The item is no longer shown, so it shouldn't keep its submenu open.
+	if (TBSimpleLayoutItemWidget *itemwidget = TBSafeCast<TBSimpleLayoutItemWidget>(widget))
+		itemwidget->CloseSubMenu();
+	if (type)
+	{
+		TBListOf<TBWidget> *list = m_widgets.Get(type);
+		if (!list && (list = new TBListOf<TBWidget>) && !m_widgets.Add(type, list))
+		{
+			delete list;
+			list = nullptr;
+		}
+		if (list && list->Add(widget))
+		{
+			m_num_widgets++;
+			return;
+		}
+	}
+	delete widget;
+}
+
+TBWidget *TBItemWidgetPool::Get(const TBID &type)
+{
+	TBListOf<TBWidget> *list = type ? m_widgets.Get(type) : nullptr;
+	if (!list || !list->GetNumItems())
+		return nullptr;
+	m_num_widgets--;
+	return list->Remove(list->GetNumItems() - 1);
+}
+
+TBWidget *TBItemWidgetPool::GetAndRebind(TBSelectItemSource *source, int index, TBSelectItemViewer *viewer)
+{
+	TBWidget *widget = Get(source->GetItemWidgetType(index));
+	if (!widget || source->RebindItemWidget(index, widget, viewer))
+		return widget;
+	delete widget;
+	return nullptr;
+}
+
+void TBItemWidgetPool::Trim(int max_widgets)
+{
+	TBHashTableIteratorOf<TBListOf<TBWidget>> it(&m_widgets);
+	while (m_num_widgets > max_widgets)
+	{
+		TBListOf<TBWidget> *list = it.GetNextContent();
+		if (!list)
+			break;
+		while (m_num_widgets > max_widgets && list->GetNumItems())
+		{
+			delete list->Remove(list->GetNumItems() - 1);
+			m_num_widgets--;
+		}
+	}
+}
+
+void TBItemWidgetPool::Clear()
+{
+	TBHashTableIteratorOf<TBListOf<TBWidget>> it(&m_widgets);
+	while (TBListOf<TBWidget> *list = it.GetNextContent())
+		list->DeleteAll();
+	m_widgets.DeleteAll();
+	m_num_widgets = 0;
+}
+
+// == TBSelectItemSource ====================================================================================
+
 TBWidget *TBSelectItemSource::CreateItemWidget(int index, TBSelectItemViewer *viewer)
 {
 	const char *string = GetItemString(index);
@@ -168,18 +641,51 @@ TBWidget *TBSelectItemSource::CreateItemWidget(int index, TBSelectItemViewer *vi
 			return separator;
 		}
 	}
-	else if (TBTextField *textfield = new TBTextField)
+	else if (TBTextField *textfield = new TBSimpleTextItemWidget)
 	{
-		textfield->SetSkinBg("TBSelectItem");
 		textfield->SetText(string);
-		textfield->SetTextAlign(TB_TEXT_ALIGN_LEFT);
 		return textfield;
 	}
 	return nullptr;
 }
 
+TBID TBSelectItemSource::GetItemWidgetType(int index)
+{
+	if (GetItemSubSource(index) || GetItemImage(index))
+		return TBIDC("TBSimpleLayoutItemWidget");
+	const char *string = GetItemString(index);
+	if (string && *string == '-')
+		return TBID(); // Separators are cheap and rare. Not worth reusing.
+	return TBIDC("TBSimpleTextItemWidget");
+}
+
+bool TBSelectItemSource::RebindItemWidget(int index, TBWidget *widget, TBSelectItemViewer *viewer)
+{
+	const char *string = GetItemString(index);
+	TBSelectItemSource *sub_source = GetItemSubSource(index);
+	TBID image = GetItemImage(index);
+	if (sub_source || image)
+	{
+		TBSimpleLayoutItemWidget *itemwidget = TBSafeCast<TBSimpleLayoutItemWidget>(widget);
+		if (!itemwidget)
+			return false;
+		itemwidget->Bind(image, sub_source, string);
+	}
+	else if (string && *string == '-')
+		return false;
+	else if (TBSimpleTextItemWidget *textfield = TBSafeCast<TBSimpleTextItemWidget>(widget))
+		textfield->SetText(string);
+	else
+		return false;
+	widget->SetStateRaw(WIDGET_STATE_NONE);
+	widget->SetID(TBID());
+	return true;
+}
+
 void TBSelectItemSource::InvokeItemChanged(int index, TBSelectItemViewer *exclude_viewer)
 {
+	if (m_filter_cache)
+		m_filter_cache->OnItemChanged(index);
 	TBLinkListOf<TBSelectItemViewer>::Iterator iter = m_viewers.IterateForward();
 	while (TBSelectItemViewer *viewer = iter.GetAndStep())
 		if (viewer != exclude_viewer)
@@ -188,6 +694,8 @@ void TBSelectItemSource::InvokeItemChanged(int index, TBSelectItemViewer *exclud
 
 void TBSelectItemSource::InvokeItemAdded(int index)
 {
+	if (m_filter_cache)
+		m_filter_cache->OnItemAdded(index);
 	TBLinkListOf<TBSelectItemViewer>::Iterator iter = m_viewers.IterateForward();
 	while (TBSelectItemViewer *viewer = iter.GetAndStep())
 		viewer->OnItemAdded(index);
@@ -195,6 +703,8 @@ void TBSelectItemSource::InvokeItemAdded(int index)
 
 void TBSelectItemSource::InvokeItemRemoved(int index)
 {
+	if (m_filter_cache)
+		m_filter_cache->OnItemRemoved(index);
 	TBLinkListOf<TBSelectItemViewer>::Iterator iter = m_viewers.IterateForward();
 	while (TBSelectItemViewer *viewer = iter.GetAndStep())
 		viewer->OnItemRemoved(index);
@@ -202,6 +712,8 @@ void TBSelectItemSource::InvokeItemRemoved(int index)
 
 void TBSelectItemSource::InvokeAllItemsRemoved()
 {
+	if (m_filter_cache)
+		m_filter_cache->OnAllItemsRemoved();
 	TBLinkListOf<TBSelectItemViewer>::Iterator iter = m_viewers.IterateForward();
 	while (TBSelectItemViewer *viewer = iter.GetAndStep())
 		viewer->OnAllItemsRemoved();
@@ -9,10 +9,14 @@
 #include "tb_linklist.h"
 #include "tb_list.h"
 #include "tb_value.h"
+#include "tb_hashtable.h"
+#include "tb_id.h"
 
 namespace tb {
 
 class TBSelectItemSource;
+class TBSelectItemFilterCache;
+class TBWidget;
 
 enum TB_SORT {
 	TB_SORT_NONE,		///< No sorting. Items appear in list order.
@@ -72,13 +76,38 @@ protected:
 class TBSelectItemSource
 {
 public:
-	TBSelectItemSource() : m_sort(TB_SORT_NONE) {}
+	TBSelectItemSource() : m_sort(TB_SORT_NONE), m_filter_cache(nullptr) {}
 	virtual ~TBSelectItemSource();
 
 	/** Return true if a item matches the given filter text.
 		By default, it returns true if GetItemString contains filter. */
 	virtual bool Filter(int index, const char *filter);
 
+	/** Find the items matching filter (See Filter), write their indexes to result and
+		return the number of them.
+		If candidates is nullptr, all items are checked and the result is in index order.
+		Otherwise only the num_candidates items in candidates are checked, and the result
+		keeps their order. result may be the same array as candidates, and must have room
+		for all checked items. */
+	int FilterItems(const char *filter, const int *candidates, int num_candidates, int *result);
+
+	/** Return true if no item that fails a filter can match a longer filter containing it,
+		like with the default Filter (a case insensitive substring match). Viewers may then
+		filter only the items shown when the filter text is extended.
+		The default returns true only if the filter cache is enabled, since that requires the
+		default Filter anyway. Override it to return true if Filter keeps this property. */
+	virtual bool IsFilterNarrowing() { return m_filter_cache != nullptr; }
+
+	/** Set if the item strings should be cached in upper case, so FilterItems can compare
+		them directly instead of calling Filter for each item.
+		If ngram_index is true, a index of all three character sequences in the strings is
+		also kept, so only the items that contain the sequences of the filter have to be
+		checked. That makes filtering large sources much faster, but uses more memory.
+
+		The cache matches like the default Filter, so don't enable it if Filter is overridden.
+		Items must not change without calling InvokeItemChanged (or InvokeItemAdded...). */
+	void SetFilterCacheEnabled(bool enabled, bool ngram_index = false);
+
 	/** Get the string of a item. If a item has more than one string,
 		return the one that should be used for inline-find (pressing keys
 		in the list will scroll to the item starting with the same letters),
@@ -99,6 +128,21 @@ public:
 		also has image or submenu. */
 	virtual TBWidget *CreateItemWidget(int index, TBSelectItemViewer *viewer);
 
+	/** Get the type of the widget CreateItemWidget creates for the item at the given index.
+		Viewers may keep widgets that are no longer used in a TBItemWidgetPool, and reuse
+		them for other items with the same type by calling RebindItemWidget.
+		Return 0 if the widget should not be reused. */
+	virtual TBID GetItemWidgetType(int index);
+
+	/** Update a widget created by CreateItemWidget for another item with the same
+		type (See GetItemWidgetType) so it represents the item at the given index,
+		just like if CreateItemWidget had been called for it.
+		Return false if the widget can't be reused. It will then be deleted and a
+		new widget created instead.
+		The default implementation only reuses widgets created by the default
+		CreateItemWidget. */
+	virtual bool RebindItemWidget(int index, TBWidget *widget, TBSelectItemViewer *viewer);
+
 	/** Get the number of items */
 	virtual int GetNumItems() = 0;
 
@@ -115,6 +159,42 @@ private:
 	friend class TBSelectItemViewer;
 	TBLinkListOf<TBSelectItemViewer> m_viewers;
 	TB_SORT m_sort;
+	TBSelectItemFilterCache *m_filter_cache;
+};
+
+/** TBItemWidgetPool keeps item widgets that are no longer used by a viewer, so they can be
+	reused for other items of the same type instead of deleting them and creating new ones.
+	See TBSelectItemSource::GetItemWidgetType and TBSelectItemSource::RebindItemWidget. */
+class TBItemWidgetPool
+{
+public:
+	TBItemWidgetPool() : m_num_widgets(0) {}
+	~TBItemWidgetPool() { Clear(); }
+
+	/** Add a widget (that must not have a parent) for reuse by items of the given type.
+		The widget is deleted if type is 0, or on OOM. */
+	void Recycle(TBWidget *widget, const TBID &type);
+
+	/** Get a widget of the given type and remove it from the pool,
+		or return nullptr if there is none. */
+	TBWidget *Get(const TBID &type);
+
+	/** Get a widget of the given type and rebind it to the item at index in source.
+		Returns nullptr if there is no widget of the type in the pool, or if the widget
+		failed to rebind (it's deleted, but the other widgets of the type are kept). */
+	TBWidget *GetAndRebind(TBSelectItemSource *source, int index, TBSelectItemViewer *viewer);
+
+	/** Delete widgets until there are at most max_widgets in the pool. */
+	void Trim(int max_widgets);
+
+	/** Delete all widgets in the pool. */
+	void Clear();
+
+	/** Get the number of widgets in the pool. */
+	int GetNumWidgets() const { return m_num_widgets; }
+private:
+	TBHashTableAutoDeleteOf<TBListOf<TBWidget>> m_widgets;
+	int m_num_widgets;
 };
 
 /** TBSelectItemSourceList is a item provider for list widgets (TBSelectList and
@@ -141,6 +221,13 @@ public:
 		}
 		return nullptr;
 	}
+	virtual bool RebindItemWidget(int index, TBWidget *widget, TBSelectItemViewer *viewer)
+	{
+		if (!TBSelectItemSource::RebindItemWidget(index, widget, viewer))
+			return false;
+		widget->SetID(m_items[index]->id);
+		return true;
+	}
 
 	/** Add a new item at the given index. */
 	bool AddItem(T *item, int index)
@@ -0,0 +1,272 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#include "tb_select_item_async.h"
+#include "tb_system.h"
+
+#ifdef TB_ASYNC_ITEM_SOURCE
+
+namespace tb {
+
+/** How often loaded pages are received while pages are requested. */
+#define LOAD_POLL_DELAY_MS 10
+
+struct TBAsyncPagedItemSource::PAGE : public TBLinkOf<PAGE>
+{
+	PAGE(int index, int first_index, int num_items, int generation)
+		: index(index), first_index(first_index), num_items(num_items)
+		, generation(generation), loaded(false), items(nullptr) {}
+	~PAGE() { delete [] items; }
+	int index;
+	int first_index;
+	int num_items;
+	int generation;		///< The generation of the source when the page was requested.
+	bool loaded;		///< Set by the worker thread if loading succeeded.
+	TBAsyncPagedItem *items;
+};
+
+// == TBAsyncPagedItemSource ======================================================================
+
+TBAsyncPagedItemSource::TBAsyncPagedItemSource(TBAsyncPageLoader *loader, int page_size, int max_cached_pages)
+	: m_loader(loader)
+	, m_num_items(0)
+	, m_page_size(MAX(page_size, 1))
+	, m_max_cached_pages(MAX(max_cached_pages, 1))
+	, m_generation(0)
+	, m_num_cached_pages(0)
+	, m_thread(nullptr)
+	, m_mutex(nullptr)
+	, m_wake(nullptr)
+	, m_num_queued_pages(0)
+	, m_quit(false)
+{
+}
+
+TBAsyncPagedItemSource::~TBAsyncPagedItemSource()
+{
+	StopLoading();
+	m_cached_pages.RemoveAll();
+	m_lru_pages.DeleteAll();
+	delete m_wake;
+	delete m_mutex;
+	delete m_loader;
+}
+
+void TBAsyncPagedItemSource::SetNumItems(int num_items)
+{
+	m_num_items = MAX(num_items, 0);
+	InvalidatePages();
+}
+
+void TBAsyncPagedItemSource::InvalidatePages()
+{
+	// Pages currently loading are dropped when received, since they're of an older generation.
+	m_generation++;
+	if (m_mutex)
+	{
+		TBMutexLocker lock(m_mutex);
+		m_queued_pages.DeleteAll();
+		m_num_queued_pages = 0;
+	}
+	m_requested_pages.RemoveAll();
+	m_cached_pages.RemoveAll();
+	m_lru_pages.DeleteAll();
+	m_num_cached_pages = 0;
+	InvokeAllItemsRemoved();
+}
+
+TBAsyncPagedItemSource::PAGE *TBAsyncPagedItemSource::GetLoadedPage(int index) const
+{
+	if (index < 0 || index >= m_num_items)
+		return nullptr;
+	return m_cached_pages.Get(index / m_page_size);
+}
+
+bool TBAsyncPagedItemSource::IsItemLoaded(int index) const
+{
+	return GetLoadedPage(index) != nullptr;
+}
+
+const char *TBAsyncPagedItemSource::GetItemString(int index)
+{
+	if (PAGE *page = GetLoadedPage(index))
+	{
+		m_lru_pages.Remove(page);
+		m_lru_pages.AddFirst(page);
+		return page->items[index - page->first_index].str;
+	}
+	RequestItem(index);
+	return m_placeholder;
+}
+
+TBID TBAsyncPagedItemSource::GetItemID(int index)
+{
+	if (PAGE *page = GetLoadedPage(index))
+		return TBID(page->items[index - page->first_index].id);
+	return TBID();
+}
+
+void TBAsyncPagedItemSource::RequestItem(int index)
+{
+	if (index < 0 || index >= m_num_items)
+		return;
+	const int page_index = index / m_page_size;
+	if (m_cached_pages.Get(page_index) || m_requested_pages.Get(page_index) || !StartLoading())
+		return;
+
+	const int first_index = page_index * m_page_size;
+	PAGE *page = new PAGE(page_index, first_index, MIN(m_page_size, m_num_items - first_index), m_generation);
+	if (!page)
+		return;
+	if (!(page->items = new TBAsyncPagedItem[page->num_items]) || !m_requested_pages.Add(page_index, page))
+	{
+		delete page;
+		return;
+	}
+	{
+		TBMutexLocker lock(m_mutex);
+		m_queued_pages.AddFirst(page);
+		m_num_queued_pages++;
+		// Pages requested long ago have most likely been scrolled out of view, and would
+		// be evicted when the pages requested after them are loaded anyway.
+		if (m_num_queued_pages > m_max_cached_pages)
+		{
+			PAGE *oldest = m_queued_pages.GetLast();
+			m_queued_pages.Remove(oldest);
+			m_num_queued_pages--;
+			m_requested_pages.Remove(oldest->index);
+			delete oldest;
+		}
+	}
+	m_wake->Post();
+
+	if (!GetMessageByID(TBIDC("receive_pages")))
+		PostMessageDelayed(TBIDC("receive_pages"), nullptr, LOAD_POLL_DELAY_MS);
+}
+
+bool TBAsyncPagedItemSource::StartLoading()
+{
+	if (m_thread)
+		return true;
+	if (!m_loader)
+		return false;
+	if (!m_mutex && !(m_mutex = TBMutex::Create()))
+		return false;
+	if (!m_wake && !(m_wake = TBSemaphore::Create()))
+		return false;
+	m_quit = false;
+	m_thread = TBThread::Start(LoadPages, this);
+	return m_thread != nullptr;
+}
+
+void TBAsyncPagedItemSource::StopLoading()
+{
+	if (!m_thread)
+		return;
+	{
+		TBMutexLocker lock(m_mutex);
+		m_quit = true;
+	}
+	m_wake->Post();
+	delete m_thread;
+	m_thread = nullptr;
+
+	// Drop everything not received yet. The semaphore may still have a count from
+	// the queued pages, so replace it.
+	m_queued_pages.DeleteAll();
+	m_num_queued_pages = 0;
+	m_loaded_pages.DeleteAll();
+	m_requested_pages.RemoveAll();
+	delete m_wake;
+	m_wake = nullptr;
+	if (TBMessage *msg = GetMessageByID(TBIDC("receive_pages")))
+		DeleteMessage(msg);
+}
+
+// static
+void TBAsyncPagedItemSource::LoadPages(void *source)
+{
+	TBAsyncPagedItemSource *self = (TBAsyncPagedItemSource *) source;
+	while (true)
+	{
+		self->m_wake->Wait();
+		PAGE *page;
+		{
+			TBMutexLocker lock(self->m_mutex);
+			if (self->m_quit)
+				return;
+			// Load the most recently requested page first, since it's most likely on screen.
+			if (!(page = self->m_queued_pages.GetFirst()))
+				continue; // The page was dropped.
+			self->m_queued_pages.Remove(page);
+			self->m_num_queued_pages--;
+		}
+		page->loaded = self->m_loader->LoadPage(page->first_index, page->num_items, page->items);
+		TBMutexLocker lock(self->m_mutex);
+		self->m_loaded_pages.AddLast(page);
+	}
+}
+
+void TBAsyncPagedItemSource::ReceiveLoadedPages()
+{
+	if (!m_mutex)
+		return;
+	TBLinkListOf<PAGE> pages;
+	{
+		TBMutexLocker lock(m_mutex);
+		while (PAGE *page = m_loaded_pages.GetFirst())
+		{
+			m_loaded_pages.Remove(page);
+			pages.AddLast(page);
+		}
+	}
+	while (PAGE *page = pages.GetFirst())
+	{
+		pages.Remove(page);
+		if (m_requested_pages.Get(page->index) == page)
+			m_requested_pages.Remove(page->index);
+		if (page->generation != m_generation || !page->loaded)
+		{
+			delete page;
+			continue;
+		}
+		AddCachedPage(page);
+		// Viewers replace the placeholders of the items they show.
+		for (int i = 0; i < page->num_items; i++)
+			InvokeItemChanged(page->first_index + i);
+	}
+}
+
+void TBAsyncPagedItemSource::AddCachedPage(PAGE *page)
+{
+	if (!m_cached_pages.Add(page->index, page))
+	{
+		delete page;
+		return;
+	}
+	m_lru_pages.AddFirst(page);
+	m_num_cached_pages++;
+	while (m_num_cached_pages > m_max_cached_pages)
+	{
+		PAGE *lru_page = m_lru_pages.GetLast();
+		m_cached_pages.Remove(lru_page->index);
+		m_lru_pages.Delete(lru_page);
+		m_num_cached_pages--;
+	}
+}
+
+void TBAsyncPagedItemSource::OnMessageReceived(TBMessage *msg)
+{
+	if (msg->message == TBIDC("receive_pages"))
+	{
+		ReceiveLoadedPages();
+		if (m_requested_pages.GetNumItems())
+			PostMessageDelayed(TBIDC("receive_pages"), nullptr, LOAD_POLL_DELAY_MS);
+	}
+}
+
+} // namespace tb
+
+#endif // TB_ASYNC_ITEM_SOURCE
@@ -0,0 +1,143 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#ifndef TB_SELECT_ITEM_ASYNC_H
+#define TB_SELECT_ITEM_ASYNC_H
+
+#include "tb_widgets.h"
+#include "tb_select_item.h"
+#include "tb_msg.h"
+#include "tb_str.h"
+
+#ifdef TB_ASYNC_ITEM_SOURCE
+
+namespace tb {
+
+class TBThread;
+class TBMutex;
+class TBSemaphore;
+
+/** TBAsyncPagedItem is a item loaded by TBAsyncPageLoader::LoadPage. */
+class TBAsyncPagedItem
+{
+public:
+	TBAsyncPagedItem() : id(0) {}
+	TBStr str;
+	uint32 id;	///< The id of the item, as a hash (See TBGetHash) since TBID is not thread safe.
+};
+
+/** TBAsyncPageLoader loads the pages of a TBAsyncPagedItemSource on its worker thread. */
+class TBAsyncPageLoader
+{
+public:
+	virtual ~TBAsyncPageLoader() {}
+
+	/** Load count items starting at first_index into items.
+		Called on the worker thread, so it must not use anything that is not thread safe,
+		such as widgets, TBID or TBMessageHandler.
+		Return false on failure. The page is requested again when it's needed. */
+	virtual bool LoadPage(int first_index, int count, TBAsyncPagedItem *items) = 0;
+};
+
+/** TBAsyncPagedItemSource is a item source for huge or slow datasets (such as the rows
+	of a database) that can't be kept in memory, or can't be read fast enough on the UI thread.
+
+	The number of items is set with SetNumItems, and pages of items are loaded by a
+	TBAsyncPageLoader on a worker thread. Items that are not loaded yet have the
+	placeholder string, and their page is requested, so viewers never wait for the data.
+	When a page has loaded, InvokeItemChanged is called for its items.
+
+	Loaded pages are kept in a cache with a limited number of pages. When it's full, the
+	least recently used page is evicted.
+
+	TBMessageHandler is not thread safe, so the worker thread never posts messages itself.
+	It queues the loaded pages, and a message handled on the UI thread picks them up while
+	any page is requested.
+
+	Use it with a virtualized TBSelectList (See TBSelectList::SetVirtualized), which only
+	gets the items of the rows on screen. Sorting and filtering needs all items, so they
+	should not be used.
+
+	Only available if TB_ASYNC_ITEM_SOURCE is defined (See tb_config.h). */
+class TBAsyncPagedItemSource : public TBSelectItemSource, private TBMessageHandler
+{
+public:
+	/** loader loads the pages. The source takes ownership of it, and deletes it after
+		stopping the worker thread. page_size is the number of items in each page, and
+		max_cached_pages is the number of loaded pages kept in memory. */
+	TBAsyncPagedItemSource(TBAsyncPageLoader *loader, int page_size = 64, int max_cached_pages = 64);
+	virtual ~TBAsyncPagedItemSource();
+
+	/** Get the loader. */
+	TBAsyncPageLoader *GetLoader() const { return m_loader; }
+
+	/** Set the number of items. All loaded pages are dropped (See InvalidatePages). */
+	void SetNumItems(int num_items);
+
+	/** Set the string of items that are not loaded yet. Default is empty. */
+	void SetPlaceholderString(const char *str) { m_placeholder.Set(str); }
+
+	/** Drop all loaded and requested pages and notify viewers, so items are loaded
+		again when they're needed. Call this when the data has changed. */
+	void InvalidatePages();
+
+	/** Return true if the item at the given index is loaded. */
+	bool IsItemLoaded(int index) const;
+
+	/** Request the page with the item at the given index, unless it's loaded or requested already. */
+	void RequestItem(int index);
+
+	/** Stop the worker thread, waiting for the page it's currently loading.
+		It's started again if more pages are requested. */
+	void StopLoading();
+
+	/** Get the number of pages in the cache. */
+	int GetNumCachedPages() const { return m_num_cached_pages; }
+
+	/** Get the number of pages requested but not received yet. */
+	int GetNumRequestedPages() const { return m_requested_pages.GetNumItems(); }
+
+	/** Receive pages loaded by the worker thread and notify viewers.
+		This is done automatically from TBMessageHandler::ProcessMessages. */
+	void ReceiveLoadedPages();
+
+	virtual const char *GetItemString(int index);
+	virtual TBID GetItemID(int index);
+	virtual int GetNumItems() { return m_num_items; }
+private:
+	struct PAGE;
+	PAGE *GetLoadedPage(int index) const;
+	void AddCachedPage(PAGE *page);
+	bool StartLoading();
+	static void LoadPages(void *source);
+	virtual void OnMessageReceived(TBMessage *msg);
+
+	TBAsyncPageLoader *m_loader;
+	int m_num_items;
+	int m_page_size;
+	int m_max_cached_pages;
+	int m_generation;					///< Increased when pages are invalidated.
+	TBStr m_placeholder;
+	TBHashTableOf<PAGE> m_cached_pages;	///< Loaded pages by page index.
+	TBLinkListOf<PAGE> m_lru_pages;		///< Loaded pages, the most recently used first.
+	int m_num_cached_pages;
+	TBHashTableOf<PAGE> m_requested_pages;	///< Requested pages by page index.
+
+	TBThread *m_thread;
+	TBMutex *m_mutex;
+	TBSemaphore *m_wake;				///< Posted for each queued page, and on quit.
+
+	// Used by both threads. Protected by m_mutex.
+	TBLinkListOf<PAGE> m_queued_pages;	///< Pages to load, the most recently requested first.
+	int m_num_queued_pages;
+	TBLinkListOf<PAGE> m_loaded_pages;	///< Pages loaded by the worker thread.
+	bool m_quit;
+};
+
+} // namespace tb
+
+#endif // TB_ASYNC_ITEM_SOURCE
+
+#endif // TB_SELECT_ITEM_ASYNC_H
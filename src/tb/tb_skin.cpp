@@ -110,6 +110,17 @@ bool TBSkinCondition::GetCondition(TBSkinConditionContext &context) const
 	return equal == (m_test == TEST_EQUAL);
 }
 
+bool TBSkinCondition::IsLocal() const
+{
+	if (m_target != TARGET_THIS)
+		return false;
+	// These are true if they're on the target or any child, or depend on the window.
+	return m_info.prop != PROPERTY_WINDOW_ACTIVE &&
+			m_info.prop != PROPERTY_HOVER &&
+			m_info.prop != PROPERTY_CAPTURE &&
+			m_info.prop != PROPERTY_FOCUS;
+}
+
 // == TBSkin ================================================================
 
 TBSkin::TBSkin()
@@ -118,6 +129,7 @@ TBSkin::TBSkin()
 	, m_default_disabled_opacity(0.3f)
 	, m_default_placeholder_opacity(0.2f)
 	, m_default_spacing(0)
+	, m_state_generation(1)
 {
 	g_renderer->AddListener(this);
 
@@ -127,6 +139,8 @@ TBSkin::TBSkin()
 
 bool TBSkin::Load(const char *skin_file, const char *override_skin_file)
 {
+	// Elements may get new overrides.
+	InvalidateStateGeneration();
 	if (!LoadInternal(skin_file))
 		return false;
 	if (override_skin_file && !LoadInternal(override_skin_file))
@@ -134,6 +148,12 @@ bool TBSkin::Load(const char *skin_file, const char *override_skin_file)
 	return ReloadBitmaps();
 }
 
+void TBSkin::InvalidateStateGeneration()
+{
+	if (++m_state_generation == 0)
+		m_state_generation = 1;
+}
+
 bool TBSkin::LoadInternal(const char *skin_file)
 {
 	TBNode node;
@@ -331,6 +351,33 @@ TBSkinElement *TBSkin::GetSkinElementStrongOverride(const TBID &skin_id, SKIN_ST
 	return nullptr;
 }
 
+bool TBSkin::IsStrongOverrideDependingOnOthers(const TBID &skin_id) const
+{
+	return !HasStrongOverrideConditionsMatching(skin_id, &TBSkinElementStateList::HasOnlyLocalConditions);
+}
+
+bool TBSkin::IsStrongOverrideCacheable(const TBID &skin_id) const
+{
+	return HasStrongOverrideConditionsMatching(skin_id, &TBSkinElementStateList::HasOnlyCacheableConditions);
+}
+
+bool TBSkin::HasStrongOverrideConditionsMatching(const TBID &skin_id, bool (TBSkinElementStateList::*has_only)() const) const
+{
+	TBSkinElement *skin_element = GetSkinElement(skin_id);
+	// Avoid eternal recursion when overrides refer to elements referring back.
+	if (!skin_element || skin_element->is_getting)
+		return true;
+	if (!(skin_element->m_strong_override_elements.*has_only)())
+		return false;
+	skin_element->is_getting = true;
+	bool matching = true;
+	for (const TBSkinElementState *override_state = skin_element->m_strong_override_elements.GetFirstElement();
+		override_state && matching; override_state = override_state->GetNext())
+		matching = HasStrongOverrideConditionsMatching(override_state->element_id, has_only);
+	skin_element->is_getting = false;
+	return matching;
+}
+
 TBSkinElement *TBSkin::PaintSkin(const TBRect &dst_rect, const TBID &skin_id, SKIN_STATE state, TBSkinConditionContext &context)
 {
 	return PaintSkin(dst_rect, GetSkinElement(skin_id), state, context);
@@ -816,6 +863,24 @@ TBSkinElementState *TBSkinElementStateList::GetStateElementExactMatch(SKIN_STATE
 	return nullptr;
 }
 
+bool TBSkinElementStateList::HasOnlyLocalConditions() const
+{
+	for (TBSkinElementState *state_element = m_state_elements.GetFirst(); state_element; state_element = state_element->GetNext())
+		for (TBSkinCondition *condition = state_element->conditions.GetFirst(); condition; condition = condition->GetNext())
+			if (!condition->IsLocal())
+				return false;
+	return true;
+}
+
+bool TBSkinElementStateList::HasOnlyCacheableConditions() const
+{
+	for (TBSkinElementState *state_element = m_state_elements.GetFirst(); state_element; state_element = state_element->GetNext())
+		for (TBSkinCondition *condition = state_element->conditions.GetFirst(); condition; condition = condition->GetNext())
+			if (!condition->IsCacheable())
+				return false;
+	return true;
+}
+
 void TBSkinElementStateList::Load(TBNode *n)
 {
 	if (!n)
@@ -96,6 +96,15 @@ public:
 
 	/** Return true if the condition is true for the given context. */
 	bool GetCondition(TBSkinConditionContext &context) const;
+
+	/** Return true if the condition only depends on the context itself, and not on any
+		other object (f.ex the parent, siblings, hover, capture, focus or active window). */
+	bool IsLocal() const;
+
+	/** Return true if the result may be cached until the skin states of the context are
+		invalidated. Conditions on the value can't be cached, since SetValue doesn't
+		invalidate skin states. */
+	bool IsCacheable() const { return m_info.prop != PROPERTY_VALUE; }
 private:
 	TARGET m_target;
 	CONDITION_INFO m_info;
@@ -155,6 +164,12 @@ public:
 	bool HasStateElements() const { return m_state_elements.HasLinks(); }
 	const TBSkinElementState *GetFirstElement() const { return m_state_elements.GetFirst(); }
 
+	/** Return true if all conditions of all state elements are local (See TBSkinCondition::IsLocal). */
+	bool HasOnlyLocalConditions() const;
+
+	/** Return true if all conditions of all state elements are cacheable (See TBSkinCondition::IsCacheable). */
+	bool HasOnlyCacheableConditions() const;
+
 	void Load(TBNode *n);
 private:
 	TBLinkListOf<TBSkinElementState> m_state_elements;
@@ -321,6 +336,24 @@ public:
 		Returns nullptr if there's no match. */
 	TBSkinElement *GetSkinElementStrongOverride(const TBID &skin_id, SKIN_STATE state, TBSkinConditionContext &context) const;
 
+	/** Return true if the strong overrides of the given skin (and the skins they refer to)
+		have any condition that isn't local (See TBSkinCondition::IsLocal). If false, the
+		element returned by GetSkinElementStrongOverride can only change if the state or
+		properties of the context itself changes. */
+	bool IsStrongOverrideDependingOnOthers(const TBID &skin_id) const;
+
+	/** Return true if the element returned by GetSkinElementStrongOverride may be cached
+		until the skin states of the context are invalidated (See TBSkinCondition::IsCacheable). */
+	bool IsStrongOverrideCacheable(const TBID &skin_id) const;
+
+	/** Get a number that changes whenever something changes that may affect which element
+		GetSkinElementStrongOverride returns for any object (f.ex when the skin is loaded).
+		This can be used to detect if a cached element is outdated. It's never 0. */
+	uint32 GetStateGeneration() const { return m_state_generation; }
+
+	/** Change the number returned by GetStateGeneration, so all cached elements are updated. */
+	void InvalidateStateGeneration();
+
 	/** Get the default text color for all skin elements */
 	TBColor GetDefaultTextColor() const { return m_default_text_color; }
 
@@ -397,6 +430,8 @@ private:
 	float m_default_disabled_opacity;					///< Disabled opacity
 	float m_default_placeholder_opacity;				///< Placeholder opacity
 	int16 m_default_spacing;							///< Default layout spacing
+	uint32 m_state_generation;							///< See GetStateGeneration
+	bool HasStrongOverrideConditionsMatching(const TBID &skin_id, bool (TBSkinElementStateList::*has_only)() const) const;
 	bool LoadInternal(const char *skin_file);
 	bool ReloadBitmapsInternal();
 	void PaintElement(const TBRect &dst_rect, TBSkinElement *element);
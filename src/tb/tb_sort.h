@@ -6,6 +6,9 @@
 #ifndef TB_SORT_H
 #define TB_SORT_H
 
+#include <stdlib.h>
+#include <string.h>
+
 namespace tb {
 
 template<class CONTEXT, class TYPE>
@@ -21,6 +24,157 @@ static void insertion_sort(TYPE *elements, size_t element_count, CONTEXT context
 	}
 }
 
+/** Merge the sorted runs [start, mid) and [mid, end) of elements, using tmp for the
+	smaller of them. Used by merge_sort. */
+template<class CONTEXT, class TYPE>
+static void merge_runs(TYPE *elements, size_t start, size_t mid, size_t end, TYPE *tmp,
+						CONTEXT context, int(*cmp)(CONTEXT context, const TYPE *a, const TYPE *b))
+{
+	// Nothing to do if the runs are already in order.
+	if (cmp(context, &elements[mid], &elements[mid - 1]) >= 0)
+		return;
+	if (mid - start <= end - mid)
+	{
+		// Copy the left run and merge forward. Take from the left on equal elements, to be stable.
+		size_t left_count = mid - start;
+		memcpy(tmp, &elements[start], left_count * sizeof(TYPE));
+		size_t left = 0, right = mid, dst = start;
+		while (left < left_count && right < end)
+			elements[dst++] = cmp(context, &elements[right], &tmp[left]) < 0 ? elements[right++] : tmp[left++];
+		while (left < left_count)
+			elements[dst++] = tmp[left++];
+	}
+	else
+	{
+		// Copy the right run and merge backward. Take from the right on equal elements, to be stable.
+		size_t right = end - mid;
+		memcpy(tmp, &elements[mid], right * sizeof(TYPE));
+		size_t left = mid, dst = end;
+		while (left > start && right > 0)
+			elements[--dst] = cmp(context, &tmp[right - 1], &elements[left - 1]) < 0 ? elements[--left] : tmp[--right];
+		while (right > 0)
+			elements[--dst] = tmp[--right];
+	}
+}
+
+/** Sort elements with a stable merge sort in O(n log n) time.
+	Runs of elements that are already in order (or in strictly reverse order) are
+	found first and then merged, like in TimSort, so nearly sorted elements are
+	sorted in close to linear time.
+
+	TYPE must be a type that can be copied with memcpy. Temporary memory is needed
+	for half of the elements. If it can't be allocated, insertion_sort is used instead. */
+template<class CONTEXT, class TYPE>
+static void merge_sort(TYPE *elements, size_t element_count, CONTEXT context, int(*cmp)(CONTEXT context, const TYPE *a, const TYPE *b))
+{
+	// Short runs are extended to this length with insertion_sort, which is faster for few elements.
+	const size_t min_run = 32;
+	if (element_count <= min_run)
+	{
+		insertion_sort(elements, element_count, context, cmp);
+		return;
+	}
+	size_t *runs = (size_t *) malloc((element_count / min_run + 2) * sizeof(size_t));
+	TYPE *tmp = (TYPE *) malloc((element_count / 2 + 1) * sizeof(TYPE));
+	if (!runs || !tmp)
+	{
+		free(runs);
+		free(tmp);
+		insertion_sort(elements, element_count, context, cmp);
+		return;
+	}
+
+	// Find the runs. All runs except the last one have at least min_run elements.
+	size_t num_runs = 0;
+	for (size_t start = 0; start < element_count; )
+	{
+		size_t end = start + 1;
+		if (end < element_count && cmp(context, &elements[end], &elements[start]) < 0)
+		{
+			while (end + 1 < element_count && cmp(context, &elements[end + 1], &elements[end]) < 0)
+				end++;
+			end++;
+			for (size_t a = start, b = end - 1; a < b; a++, b--)
+			{
+				TYPE value = elements[a];
+				elements[a] = elements[b];
+				elements[b] = value;
+			}
+		}
+		else
+		{
+			while (end < element_count && cmp(context, &elements[end], &elements[end - 1]) >= 0)
+				end++;
+		}
+		if (end - start < min_run)
+		{
+			end = start + min_run < element_count ? start + min_run : element_count;
+			insertion_sort(elements + start, end - start, context, cmp);
+		}
+		runs[num_runs++] = start;
+		start = end;
+	}
+	runs[num_runs] = element_count;
+
+	// Merge pairs of neighbour runs until there is only one.
+	while (num_runs > 1)
+	{
+		size_t num_merged = 0;
+		for (size_t i = 0; i < num_runs; i += 2)
+		{
+			if (i + 1 < num_runs)
+				merge_runs(elements, runs[i], runs[i + 1], runs[i + 2], tmp, context, cmp);
+			runs[num_merged++] = runs[i];
+		}
+		runs[num_merged] = element_count;
+		num_runs = num_merged;
+	}
+	free(runs);
+	free(tmp);
+}
+
+/** Sort elements like merge_sort, but get a key for each element once before sorting,
+	and compare the keys instead of the elements. This is much faster when getting the
+	value to compare is expensive, such as getting the string of a item from a
+	TBSelectItemSource.
+
+	TYPE and KEY must be types that can be copied with memcpy.
+	Returns false if out of memory, leaving the elements unsorted. */
+template<class CONTEXT, class TYPE, class KEY>
+static bool merge_sort_by_key(TYPE *elements, size_t element_count, CONTEXT context,
+								KEY(*get_key)(CONTEXT context, const TYPE *element),
+								int(*cmp)(CONTEXT context, const KEY *a, const KEY *b))
+{
+	struct ENTRY
+	{
+		KEY key;
+		TYPE element;
+	};
+	struct ENTRY_CONTEXT
+	{
+		CONTEXT context;
+		int(*cmp)(CONTEXT context, const KEY *a, const KEY *b);
+		static int Compare(const ENTRY_CONTEXT *entry_context, const ENTRY *a, const ENTRY *b)
+		{
+			return entry_context->cmp(entry_context->context, &a->key, &b->key);
+		}
+	};
+	ENTRY *entries = (ENTRY *) malloc(element_count * sizeof(ENTRY));
+	if (!entries && element_count)
+		return false;
+	for (size_t i = 0; i < element_count; i++)
+	{
+		entries[i].key = get_key(context, &elements[i]);
+		entries[i].element = elements[i];
+	}
+	ENTRY_CONTEXT entry_context = { context, cmp };
+	merge_sort<const ENTRY_CONTEXT *, ENTRY>(entries, element_count, &entry_context, ENTRY_CONTEXT::Compare);
+	for (size_t i = 0; i < element_count; i++)
+		elements[i] = entries[i].element;
+	free(entries);
+	return true;
+}
+
 } // namespace tb
 
 #endif // TB_SORT_H
@@ -850,22 +850,27 @@ int TBBlock::GetStartIndentation(TBFontFace *font, int first_line_len) const
 	// indent to the same as the beginning when wrapped.
 	int indentation = 0;
 	int i = 0;
-	while (i < first_line_len)
+	utf8::span_decoder decoder(str, first_line_len);
+	UCS4 uc;
+	while (decoder.next(uc))
 	{
+		// All characters that indent are one byte, except the bullet.
 		const char *current_str = str.CStr() + i;
-		UCS4 uc = utf8::decode_next(str, &i, first_line_len);
 		switch (uc)
 		{
 		case '\t':
 			indentation += CalculateTabWidth(font, indentation);
+			i++;
 			continue;
 		case ' ':
 		case '-':
 		case '*':
 			indentation += CalculateStringWidth(font, current_str, 1);
+			i++;
 			continue;
 		case 0x2022: // BULLET
 			indentation += CalculateStringWidth(font, current_str, 3);
+			i += 3;
 			continue;
 		}
 		break;
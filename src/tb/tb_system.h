@@ -79,6 +79,59 @@ public:
 	virtual size_t Read(void *buf, size_t elemSize, size_t count) = 0;
 };
 
+/** TBThread is a porting interface for running a function on another thread.
+	Turbo Badger is not thread safe, so the function must not use anything that
+	isn't protected by a TBMutex. */
+class TBThread
+{
+public:
+	typedef void (*TBThreadFunc)(void *data);
+
+	/** Start a new thread calling func with data. Returns nullptr on failure. */
+	static TBThread *Start(TBThreadFunc func, void *data);
+
+	/** Deleting the thread waits until its function has returned. */
+	virtual ~TBThread() {}
+};
+
+/** TBMutex is a porting interface for a lock that only one thread can hold at a time. */
+class TBMutex
+{
+public:
+	/** Create a new unlocked mutex. Returns nullptr on failure. */
+	static TBMutex *Create();
+
+	virtual ~TBMutex() {}
+	virtual void Lock() = 0;
+	virtual void Unlock() = 0;
+};
+
+/** TBMutexLocker locks a TBMutex during its lifetime. */
+class TBMutexLocker
+{
+public:
+	TBMutexLocker(TBMutex *mutex) : m_mutex(mutex) { m_mutex->Lock(); }
+	~TBMutexLocker() { m_mutex->Unlock(); }
+private:
+	TBMutex *m_mutex;
+};
+
+/** TBSemaphore is a porting interface for a counting semaphore, used to wake up a waiting thread. */
+class TBSemaphore
+{
+public:
+	/** Create a new semaphore with count 0. Returns nullptr on failure. */
+	static TBSemaphore *Create();
+
+	virtual ~TBSemaphore() {}
+
+	/** Increase the count, waking up a thread waiting in Wait. */
+	virtual void Post() = 0;
+
+	/** Wait until the count is above 0, and decrease it. */
+	virtual void Wait() = 0;
+};
+
 } // namespace tb
 
 #endif // TB_SYSTEM_H
@@ -40,6 +40,7 @@ TBTabContainer::TBTabContainer()
 	, m_current_page(0)
 	, m_align(TB_ALIGN_TOP)
 {
+	RequestProcess();
 	AddChild(&m_root_layout);
 	// Put the tab layout on top of the content in Z order so their skin can make
 	// a seamless overlap over the border. Control which side they are layouted
@@ -71,6 +72,8 @@ void TBTabContainer::SetAxis(AXIS axis)
 	m_tab_layout.SetAxis(axis == AXIS_X ? AXIS_Y : AXIS_X);
 	m_tab_layout.SetSkinBg(axis == AXIS_X ? TBIDC("TBTabContainer.tablayout_y") :
 											TBIDC("TBTabContainer.tablayout_x"));
+	// GetAxis returns the axis of the root layout, which skin conditions may check.
+	InvalidateSkinStates();
 }
 
 void TBTabContainer::SetValue(int index)
@@ -112,6 +115,8 @@ void TBTabContainer::SetAlignment(TB_ALIGN align)
 	m_root_layout.SetLayoutOrder(reverse ? LAYOUT_ORDER_TOP_TO_BOTTOM : LAYOUT_ORDER_BOTTOM_TO_TOP);
 	m_tab_layout.SetLayoutPosition(reverse ? LAYOUT_POSITION_RIGHT_BOTTOM : LAYOUT_POSITION_LEFT_TOP);
 	m_align = align;
+	// The tabs may have skin conditions on the alignment.
+	InvalidateSkinStates();
 }
 
 bool TBTabContainer::OnEvent(const TBWidgetEvent &ev)
@@ -0,0 +1,532 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#include "tb_table_view.h"
+#include "tb_widget_skin_condition_context.h"
+#include "tb_font_renderer.h"
+#include "tb_renderer.h"
+#include "tb_system.h"
+#include "tb_sort.h"
+#include <assert.h>
+#include <string.h>
+
+namespace tb {
+
+/** Horizontal space between the cell edges and the text, in dp. */
+#define CELL_PADDING_DP 4
+
+/** Vertical space above and below the text in rows, in dp. */
+#define ROW_PADDING_DP 2
+
+/** How close to the edge of a column header that dragging resizes the column, in dp. */
+#define RESIZE_EDGE_DP 4
+
+/** The minimum width of a column when resized by dragging, in dp. */
+#define MIN_COLUMN_WIDTH_DP 16
+
+/** The default column width, in dp. */
+#define DEFAULT_COLUMN_WIDTH_DP 100
+
+/** The number of rows (excluding the header) in the preferred height. */
+#define PREFERRED_NUM_ROWS 10
+
+/** The max number of rows passed to TBTableSource::PrepareColumn at once. */
+#define PREPARE_COLUMN_ROWS 64
+
+static int DpToPx(int dp) { return g_tb_skin->GetDimensionConverter()->DpToPx(dp); }
+
+// == TBTableSource ===============================================================================
+
+TBTableSource::~TBTableSource()
+{
+	// If this assert trig, you are deleting a source that's still set on some
+	// TBTableView. That might be dangerous.
+	assert(!m_views.HasLinks());
+}
+
+int TBTableSource::CompareCells(int column, int row_a, int row_b)
+{
+	return strcmp(GetCellString(column, row_a), GetCellString(column, row_b));
+}
+
+void TBTableSource::InvokeRowsChanged()
+{
+	TBLinkListOf<TBTableViewLink>::Iterator iter = m_views.IterateForward();
+	while (TBTableViewLink *link = iter.GetAndStep())
+		static_cast<TBTableView *>(link)->OnSourceRowsChanged();
+}
+
+void TBTableSource::InvokeCellsChanged()
+{
+	TBLinkListOf<TBTableViewLink>::Iterator iter = m_views.IterateForward();
+	while (TBTableViewLink *link = iter.GetAndStep())
+		static_cast<TBTableView *>(link)->OnSourceCellsChanged();
+}
+
+// == TBTableView =================================================================================
+
+TBTableView::TBTableView()
+	: m_source(nullptr)
+	, m_num_column_widths(0)
+	, m_default_column_width(DpToPx(DEFAULT_COLUMN_WIDTH_DP))
+	, m_row_height(0)
+	, m_sort_column(-1)
+	, m_sort(TB_SORT_NONE)
+	, m_num_sorted_rows(0)
+	, m_rows_valid(false)
+	, m_value(-1)
+	, m_resize_column(-1)
+	, m_resize_pointer_x(0)
+	, m_resize_width(0)
+{
+	SetIsFocusable(true);
+	AddChild(&m_scrollbar_x);
+	AddChild(&m_scrollbar_y);
+	m_scrollbar_x.SetGravity(WIDGET_GRAVITY_BOTTOM | WIDGET_GRAVITY_LEFT_RIGHT);
+	m_scrollbar_y.SetGravity(WIDGET_GRAVITY_RIGHT | WIDGET_GRAVITY_TOP_BOTTOM);
+	m_scrollbar_y.SetAxis(AXIS_Y);
+	int scrollbar_y_w = m_scrollbar_y.GetPreferredSize().pref_w;
+	int scrollbar_x_h = m_scrollbar_x.GetPreferredSize().pref_h;
+	m_scrollbar_x.SetRect(TBRect(0, - scrollbar_x_h, - scrollbar_y_w, scrollbar_x_h));
+	m_scrollbar_y.SetRect(TBRect(- scrollbar_y_w, 0, scrollbar_y_w, 0));
+	m_scrollbar_x.SetOpacity(0);
+	SetSkinBg(TBIDC("TBTableView"), WIDGET_INVOKE_INFO_NO_CALLBACKS);
+}
+
+TBTableView::~TBTableView()
+{
+	SetSource(nullptr);
+	RemoveChild(&m_scrollbar_y);
+	RemoveChild(&m_scrollbar_x);
+}
+
+void TBTableView::SetSource(TBTableSource *source)
+{
+	if (m_source == source)
+		return;
+	if (m_source)
+		m_source->m_views.Remove(this);
+	m_source = source;
+	if (m_source)
+		m_source->m_views.AddLast(this);
+	m_value = -1;
+	OnSourceRowsChanged();
+}
+
+void TBTableView::OnSourceRowsChanged()
+{
+	m_rows_valid = false;
+	if (!m_source || m_value >= m_source->GetNumRows())
+		m_value = -1;
+	UpdateScrollbars();
+	Invalidate();
+}
+
+void TBTableView::OnSourceCellsChanged()
+{
+	Invalidate();
+}
+
+void TBTableView::SetColumnWidth(int column, int width)
+{
+	if (column < 0 || GetColumnWidth(column) == width)
+		return;
+	if (column >= m_num_column_widths)
+	{
+		if (!m_column_widths.Reserve((column + 1) * sizeof(int)))
+			return;
+		int *widths = (int *) m_column_widths.GetData();
+		for (int i = m_num_column_widths; i < column; i++)
+			widths[i] = 0;
+		m_num_column_widths = column + 1;
+	}
+	((int *) m_column_widths.GetData())[column] = MAX(width, 0);
+	UpdateScrollbars();
+	Invalidate();
+}
+
+int TBTableView::GetColumnWidth(int column) const
+{
+	int width = column >= 0 && column < m_num_column_widths ? ((int *) m_column_widths.GetData())[column] : 0;
+	return width ? width : m_default_column_width;
+}
+
+void TBTableView::SetDefaultColumnWidth(int width)
+{
+	if (m_default_column_width == width)
+		return;
+	m_default_column_width = MAX(width, 1);
+	UpdateScrollbars();
+	Invalidate();
+}
+
+int TBTableView::GetContentWidth() const
+{
+	int width = 0;
+	const int num_columns = m_source ? m_source->GetNumColumns() : 0;
+	for (int i = 0; i < num_columns; i++)
+		width += GetColumnWidth(i);
+	return width;
+}
+
+void TBTableView::SetRowHeight(int height)
+{
+	if (m_row_height == height)
+		return;
+	m_row_height = height;
+	UpdateScrollbars();
+	Invalidate();
+}
+
+int TBTableView::GetRowHeight()
+{
+	if (m_row_height > 0)
+		return m_row_height;
+	return GetFont()->GetHeight() + DpToPx(ROW_PADDING_DP) * 2;
+}
+
+void TBTableView::SetSort(int column, TB_SORT sort)
+{
+	if (column < 0)
+		sort = TB_SORT_NONE;
+	if (sort == TB_SORT_NONE)
+		column = -1;
+	if (m_sort_column == column && m_sort == sort)
+		return;
+	m_sort_column = column;
+	m_sort = sort;
+	m_rows_valid = false;
+	Invalidate();
+}
+
+// static
+int TBTableView::CompareRows(TBTableView *table, const int *a, const int *b)
+{
+	int value = table->m_source->CompareCells(table->m_sort_column, *a, *b);
+	return table->m_sort == TB_SORT_DESCENDING ? -value : value;
+}
+
+void TBTableView::ValidateRows()
+{
+	if (m_rows_valid)
+		return;
+	m_rows_valid = true;
+	m_num_sorted_rows = 0;
+	if (!m_source || m_sort == TB_SORT_NONE || m_sort_column >= m_source->GetNumColumns())
+		return;
+
+	// Sort a list of the row indexes, and make the inverse list with the position of each
+	// row. Unsorted rows don't need them, since the position of each row is the row index.
+	const int num_rows = m_source->GetNumRows();
+	if (!m_sorted_rows.Reserve(num_rows * sizeof(int)) ||
+		!m_row_positions.Reserve(num_rows * sizeof(int)))
+		return; // Out of memory. Show the rows unsorted.
+	int *sorted_rows = (int *) m_sorted_rows.GetData();
+	for (int i = 0; i < num_rows; i++)
+		sorted_rows[i] = i;
+	merge_sort<TBTableView*, int>(sorted_rows, num_rows, this, CompareRows);
+	int *row_positions = (int *) m_row_positions.GetData();
+	for (int i = 0; i < num_rows; i++)
+		row_positions[sorted_rows[i]] = i;
+	m_num_sorted_rows = num_rows;
+}
+
+int TBTableView::GetRowAtPosition(int position)
+{
+	if (!m_source || position < 0 || position >= m_source->GetNumRows())
+		return -1;
+	ValidateRows();
+	return m_num_sorted_rows ? ((int *) m_sorted_rows.GetData())[position] : position;
+}
+
+int TBTableView::GetPositionOfRow(int row)
+{
+	if (!m_source || row < 0 || row >= m_source->GetNumRows())
+		return -1;
+	ValidateRows();
+	return m_num_sorted_rows ? ((int *) m_row_positions.GetData())[row] : row;
+}
+
+TBRect TBTableView::GetVisibleRect()
+{
+	TBRect rect = GetPaddingRect();
+	rect.w -= m_scrollbar_y.GetRect().w;
+	if (m_scrollbar_x.GetOpacity())
+		rect.h -= m_scrollbar_x.GetRect().h;
+	return rect;
+}
+
+TBRect TBTableView::GetBodyRect()
+{
+	TBRect rect = GetVisibleRect();
+	const int header_h = MIN(GetRowHeight(), rect.h);
+	rect.y += header_h;
+	rect.h -= header_h;
+	return rect;
+}
+
+void TBTableView::UpdateScrollbars()
+{
+	// Show the horizontal scrollbar only if the columns don't fit.
+	const int content_w = GetContentWidth();
+	m_scrollbar_x.SetOpacity(content_w > GetPaddingRect().w - m_scrollbar_y.GetRect().w ? 1.f : 0.f);
+
+	const TBRect body_rect = GetBodyRect();
+	const double content_h = (double) GetRowHeight() * (m_source ? m_source->GetNumRows() : 0);
+	m_scrollbar_x.SetLimits(0, content_w - body_rect.w, body_rect.w);
+	m_scrollbar_y.SetLimits(0, content_h - body_rect.h, body_rect.h);
+}
+
+int TBTableView::GetRowAtPoint(int x, int y)
+{
+	TBRect body_rect = GetBodyRect();
+	if (!body_rect.Contains(TBPoint(x, y)))
+		return -1;
+	return GetRowAtPosition((y - body_rect.y + m_scrollbar_y.GetValue()) / GetRowHeight());
+}
+
+int TBTableView::GetHeaderColumnAt(int x, bool &on_edge)
+{
+	on_edge = false;
+	if (!m_source)
+		return -1;
+	const int edge = DpToPx(RESIZE_EDGE_DP);
+	const int num_columns = m_source->GetNumColumns();
+	int column_x = GetVisibleRect().x - m_scrollbar_x.GetValue();
+	for (int column = 0; column < num_columns; column++)
+	{
+		const int column_right = column_x + GetColumnWidth(column);
+		if (x >= column_right - edge && x <= column_right + edge)
+		{
+			on_edge = true;
+			return column;
+		}
+		if (x >= column_x && x < column_right)
+			return column;
+		column_x = column_right;
+	}
+	return -1;
+}
+
+void TBTableView::ScrollToRow(int row)
+{
+	int position = GetPositionOfRow(row);
+	if (position == -1)
+		return;
+	const int row_h = GetRowHeight();
+	const int body_h = GetBodyRect().h;
+	const int y = position * row_h;
+	if (y < m_scrollbar_y.GetValue())
+		m_scrollbar_y.SetValue(y);
+	else if (y + row_h > m_scrollbar_y.GetValue() + body_h)
+		m_scrollbar_y.SetValue(y + row_h - body_h);
+}
+
+void TBTableView::SetValue(int value)
+{
+	if (!m_source || value < 0 || value >= m_source->GetNumRows())
+		value = -1;
+	if (value == m_value)
+		return;
+	m_value = value;
+	ScrollToRow(m_value);
+	Invalidate();
+
+	TBWidgetEvent ev(EVENT_TYPE_CHANGED);
+	InvokeEvent(ev);
+}
+
+bool TBTableView::ChangeValue(SPECIAL_KEY key)
+{
+	const int num_rows = m_source ? m_source->GetNumRows() : 0;
+	if (!num_rows)
+		return false;
+	const int page = MAX(GetBodyRect().h / GetRowHeight(), 1);
+	int position = GetPositionOfRow(m_value);
+	switch (key)
+	{
+	case TB_KEY_UP:			position = position == -1 ? 0 : position - 1; break;
+	case TB_KEY_DOWN:		position++; break;
+	case TB_KEY_PAGE_UP:	position -= page; break;
+	case TB_KEY_PAGE_DOWN:	position = position == -1 ? page - 1 : position + page; break;
+	case TB_KEY_HOME:		position = 0; break;
+	case TB_KEY_END:		position = num_rows - 1; break;
+	default:
+		return false;
+	}
+	position = CLAMP(position, 0, num_rows - 1);
+	SetValue(GetRowAtPosition(position));
+	return true;
+}
+
+void TBTableView::ScrollTo(int x, int y)
+{
+	m_scrollbar_x.SetValue(x);
+	m_scrollbar_y.SetValue(y);
+}
+
+TBWidget::ScrollInfo TBTableView::GetScrollInfo()
+{
+	ScrollInfo info;
+	info.min_x = static_cast<int>(m_scrollbar_x.GetMinValue());
+	info.min_y = static_cast<int>(m_scrollbar_y.GetMinValue());
+	info.max_x = static_cast<int>(m_scrollbar_x.GetMaxValue());
+	info.max_y = static_cast<int>(m_scrollbar_y.GetMaxValue());
+	info.x = m_scrollbar_x.GetValue();
+	info.y = m_scrollbar_y.GetValue();
+	return info;
+}
+
+bool TBTableView::OnEvent(const TBWidgetEvent &ev)
+{
+	if (ev.type == EVENT_TYPE_CHANGED && (ev.target == &m_scrollbar_x || ev.target == &m_scrollbar_y))
+	{
+		Invalidate();
+		OnScroll(m_scrollbar_x.GetValue(), m_scrollbar_y.GetValue());
+		return true;
+	}
+	else if (ev.type == EVENT_TYPE_WHEEL && ev.modifierkeys == TB_MODIFIER_NONE)
+	{
+		int old_val = m_scrollbar_y.GetValue();
+		m_scrollbar_y.SetValue(old_val + ev.delta_y * TBSystem::GetPixelsPerLine());
+		return m_scrollbar_y.GetValue() != old_val;
+	}
+	else if (ev.type == EVENT_TYPE_POINTER_DOWN && ev.target == this)
+	{
+		if (ev.target_y < GetBodyRect().y)
+		{
+			// Start resizing the column if pressing the edge of its header, or sort by it.
+			bool on_edge;
+			int column = GetHeaderColumnAt(ev.target_x, on_edge);
+			if (column != -1 && on_edge)
+			{
+				m_resize_column = column;
+				m_resize_pointer_x = ev.target_x;
+				m_resize_width = GetColumnWidth(column);
+			}
+			else if (column != -1)
+				SetSort(column, m_sort_column == column && m_sort == TB_SORT_ASCENDING ? TB_SORT_DESCENDING : TB_SORT_ASCENDING);
+		}
+		else
+		{
+			int row = GetRowAtPoint(ev.target_x, ev.target_y);
+			if (row != -1)
+				SetValue(row);
+		}
+		return true;
+	}
+	else if (ev.type == EVENT_TYPE_POINTER_MOVE && ev.target == this && m_resize_column != -1)
+	{
+		int width = m_resize_width + ev.target_x - m_resize_pointer_x;
+		SetColumnWidth(m_resize_column, MAX(width, DpToPx(MIN_COLUMN_WIDTH_DP)));
+		return true;
+	}
+	else if (ev.type == EVENT_TYPE_POINTER_UP && ev.target == this && m_resize_column != -1)
+	{
+		m_resize_column = -1;
+		return true;
+	}
+	else if (ev.type == EVENT_TYPE_KEY_DOWN)
+	{
+		return ChangeValue(ev.special_key);
+	}
+	return false;
+}
+
+void TBTableView::OnPaint(const PaintProps &paint_props)
+{
+	if (!m_source)
+		return;
+	ValidateRows();
+
+	TBFontFace *font = GetFont();
+	const TBRect visible_rect = GetVisibleRect();
+	const TBRect body_rect = GetBodyRect();
+	const TBRect header_rect(visible_rect.x, visible_rect.y, visible_rect.w, body_rect.y - visible_rect.y);
+	const int row_h = GetRowHeight();
+	const int scroll_x = m_scrollbar_x.GetValue();
+	const int scroll_y = m_scrollbar_y.GetValue();
+	const int cell_padding = DpToPx(CELL_PADDING_DP);
+	const int text_ofs_y = (row_h - font->GetHeight()) / 2;
+	const int num_columns = m_source->GetNumColumns();
+	TBWidgetSkinConditionContext context(this);
+
+	// Only the rows in view are painted.
+	const int first_position = scroll_y / row_h;
+	const int end_position = MIN(m_source->GetNumRows(), (scroll_y + body_rect.h + row_h - 1) / row_h);
+
+	TBRect old_clip_rect = g_renderer->SetClipRect(body_rect, true);
+	const TBRect body_clip_rect = body_rect.Clip(old_clip_rect);
+	const TBRect header_clip_rect = header_rect.Clip(old_clip_rect);
+	const int value_position = GetPositionOfRow(m_value);
+	if (value_position >= first_position && value_position < end_position)
+	{
+		TBRect row_rect(body_rect.x, body_rect.y + value_position * row_h - scroll_y, body_rect.w, row_h);
+		g_tb_skin->PaintSkin(row_rect, TBIDC("TBTableView.selection"), SKIN_STATE_NONE, context);
+	}
+
+	// Paint one column at a time, so the clipping of the cell text only changes once per column.
+	int column_x = visible_rect.x - scroll_x;
+	for (int column = 0; column < num_columns && column_x < visible_rect.x + visible_rect.w; column++)
+	{
+		const int column_w = GetColumnWidth(column);
+		if (column_x + column_w > visible_rect.x)
+		{
+			const TBRect text_rect(column_x + cell_padding, visible_rect.y, column_w - cell_padding * 2, visible_rect.h);
+			g_renderer->SetClipRect(text_rect.Clip(body_clip_rect), false);
+			for (int position = first_position; position < end_position; position += PREPARE_COLUMN_ROWS)
+			{
+				int rows[PREPARE_COLUMN_ROWS];
+				const int num_rows = MIN(end_position - position, PREPARE_COLUMN_ROWS);
+				for (int i = 0; i < num_rows; i++)
+					rows[i] = m_num_sorted_rows ? ((int *) m_sorted_rows.GetData())[position + i] : position + i;
+				m_source->PrepareColumn(column, rows, num_rows);
+				for (int i = 0; i < num_rows; i++)
+					font->DrawString(text_rect.x, body_rect.y + (position + i) * row_h - scroll_y + text_ofs_y,
+									paint_props.text_color, m_source->GetCellString(column, rows[i]));
+			}
+
+			g_renderer->SetClipRect(header_clip_rect, false);
+			const TBRect column_header_rect(column_x, header_rect.y, column_w, header_rect.h);
+			g_tb_skin->PaintSkin(column_header_rect, TBIDC("TBTableView.header"), SKIN_STATE_NONE, context);
+			g_renderer->SetClipRect(text_rect.Clip(header_clip_rect), false);
+			font->DrawString(text_rect.x, header_rect.y + text_ofs_y, paint_props.text_color, m_source->GetColumnTitle(column));
+			if (column == m_sort_column)
+			{
+				TBID arrow_id = m_sort == TB_SORT_ASCENDING ? TBIDC("arrow.up") : TBIDC("arrow.down");
+				if (TBSkinElement *arrow = g_tb_skin->GetSkinElement(arrow_id))
+				{
+					int arrow_w = arrow->GetIntrinsicWidth(), arrow_h = arrow->GetIntrinsicHeight();
+					TBRect arrow_rect(text_rect.x + text_rect.w - arrow_w, header_rect.y + (header_rect.h - arrow_h) / 2, arrow_w, arrow_h);
+					g_tb_skin->PaintSkin(arrow_rect, arrow, SKIN_STATE_NONE, context);
+				}
+			}
+		}
+		column_x += column_w;
+	}
+	g_renderer->SetClipRect(old_clip_rect, false);
+}
+
+void TBTableView::OnResized(int old_w, int old_h)
+{
+	// Make the scrollbars move
+	TBWidget::OnResized(old_w, old_h);
+	UpdateScrollbars();
+}
+
+void TBTableView::OnFontChanged()
+{
+	UpdateScrollbars();
+}
+
+PreferredSize TBTableView::OnCalculatePreferredContentSize(const SizeConstraints &constraints)
+{
+	PreferredSize ps;
+	ps.pref_w = GetContentWidth() + m_scrollbar_y.GetPreferredSize().pref_w;
+	ps.pref_h = GetRowHeight() * (PREFERRED_NUM_ROWS + 1);
+	return ps;
+}
+
+} // namespace tb
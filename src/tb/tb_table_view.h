@@ -0,0 +1,173 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#ifndef TB_TABLE_VIEW_H
+#define TB_TABLE_VIEW_H
+
+#include "tb_widgets.h"
+#include "tb_widgets_common.h"
+#include "tb_select_item.h"
+#include "tb_tempbuffer.h"
+
+namespace tb {
+
+class TBTableView;
+
+/** TBTableViewLink should never be created or subclassed anywhere except in TBTableView.
+	It's only purpose is to add a extra typed link for TBTableView, so TBTableSource can
+	keep a list of the views showing it. */
+class TBTableViewLink : public TBLinkOf<TBTableViewLink> { };
+
+/** TBTableSource provides the data of a TBTableView.
+
+	Cells are only asked for when they are painted or sorted, so the data may be
+	computed or loaded when it's needed. Views paint one column at a time, and call
+	PrepareColumn with the rows in view before getting the strings of its cells, so
+	a source storing its data by column can read them together. If the data changes, call InvokeRowsChanged
+	or InvokeCellsChanged to update the views. */
+class TBTableSource
+{
+public:
+	TBTableSource() {}
+	virtual ~TBTableSource();
+
+	/** Get the number of rows. */
+	virtual int GetNumRows() = 0;
+
+	/** Get the number of columns. */
+	virtual int GetNumColumns() = 0;
+
+	/** Get the title shown in the header of the column. */
+	virtual const char *GetColumnTitle(int column) = 0;
+
+	/** Get the string of the cell at the given column and row. */
+	virtual const char *GetCellString(int column, int row) = 0;
+
+	/** Called before GetCellString is called for the given rows of the column.
+		The rows are in the order they're shown, which is not the order of their
+		indexes if the view is sorted. Does nothing by default. */
+	virtual void PrepareColumn(int column, const int *rows, int num_rows) {}
+
+	/** Compare the cells of two rows in the given column, when sorting by it.
+		Return a negative value if row_a should be before row_b, a positive value if
+		it should be after, and 0 if they are equal.
+		By default, the cell strings are compared with strcmp, so the string of row_a must
+		stay valid while getting the string of row_b. */
+	virtual int CompareCells(int column, int row_a, int row_b);
+
+	/** Invoke on all views when rows have been added, removed or changed. */
+	void InvokeRowsChanged();
+
+	/** Invoke on all views when cell strings have changed, without changing the
+		number of rows or the sort order. */
+	void InvokeCellsChanged();
+private:
+	friend class TBTableView;
+	TBLinkListOf<TBTableViewLink> m_views;
+};
+
+/** TBTableView shows rows and columns of text provided by a TBTableSource.
+
+	It has no widgets for its cells. Only the rows in view are painted, and the cell
+	strings are drawn directly with the font, so the cost of scrolling doesn't depend
+	on the number of rows.
+
+	Columns can be resized by dragging the edge of their header, and clicking a header
+	sorts the rows by that column. Sorting only reorders a list of row indexes, so the
+	source is never changed.
+
+	The value of the table is the selected source row, or -1. */
+class TBTableView : public TBWidget, private TBTableViewLink
+{
+public:
+	// For safe typecasting
+	TBOBJECT_SUBCLASS(TBTableView, TBWidget);
+
+	TBTableView();
+	~TBTableView();
+
+	/** Set the source which should provide the data for this table.
+		This source needs to live longer than this table.
+		Set nullptr to unset currently set source. */
+	void SetSource(TBTableSource *source);
+	TBTableSource *GetSource() const { return m_source; }
+
+	/** Set the width of the given column, in pixels. */
+	void SetColumnWidth(int column, int width);
+	int GetColumnWidth(int column) const;
+
+	/** Set the width of all columns that have no width set. */
+	void SetDefaultColumnWidth(int width);
+	int GetDefaultColumnWidth() const { return m_default_column_width; }
+
+	/** Set the height of the rows and the header. If 0 (default), the height is
+		calculated from the font. */
+	void SetRowHeight(int height);
+	int GetRowHeight();
+
+	/** Sort the rows by the given column. Use TB_SORT_NONE (or column -1) to show the
+		rows in source order. */
+	void SetSort(int column, TB_SORT sort);
+	int GetSortColumn() const { return m_sort_column; }
+	TB_SORT GetSort() const { return m_sort; }
+
+	/** Get the source row shown at the given position (from the top), or -1. */
+	int GetRowAtPosition(int position);
+
+	/** Get the position (from the top) of the given source row, or -1. */
+	int GetPositionOfRow(int row);
+
+	/** Get the source row at the given coordinate relative to this widget, or -1. */
+	int GetRowAtPoint(int x, int y);
+
+	/** Scroll so the given source row is visible. */
+	void ScrollToRow(int row);
+
+	/** Set the selected source row, or -1 for no selection. */
+	virtual void SetValue(int value);
+	virtual int GetValue() { return m_value; }
+
+	virtual void ScrollTo(int x, int y);
+	virtual TBWidget::ScrollInfo GetScrollInfo();
+	virtual bool OnEvent(const TBWidgetEvent &ev);
+	virtual void OnPaint(const PaintProps &paint_props);
+	virtual void OnResized(int old_w, int old_h);
+	virtual void OnFontChanged();
+	virtual PreferredSize OnCalculatePreferredContentSize(const SizeConstraints &constraints);
+private:
+	friend class TBTableSource;
+	void OnSourceRowsChanged();
+	void OnSourceCellsChanged();
+	void ValidateRows();
+	void UpdateScrollbars();
+	TBRect GetVisibleRect();
+	TBRect GetBodyRect();
+	int GetContentWidth() const;
+	int GetHeaderColumnAt(int x, bool &on_edge);
+	bool ChangeValue(SPECIAL_KEY key);
+	static int CompareRows(TBTableView *table, const int *a, const int *b);
+
+	TBScrollBar m_scrollbar_x;
+	TBScrollBar m_scrollbar_y;
+	TBTableSource *m_source;
+	TBTempBuffer m_column_widths;	///< Widths of the first m_num_column_widths columns.
+	int m_num_column_widths;
+	int m_default_column_width;
+	int m_row_height;
+	int m_sort_column;
+	TB_SORT m_sort;
+	TBTempBuffer m_sorted_rows;		///< Row indexes in sort order, if sorted.
+	TBTempBuffer m_row_positions;	///< The position of each row, if sorted (the inverse of m_sorted_rows).
+	int m_num_sorted_rows;			///< 0 if the rows are shown in source order.
+	bool m_rows_valid;
+	int m_value;
+	int m_resize_column;			///< The column being resized, or -1.
+	int m_resize_pointer_x;
+	int m_resize_width;
+};
+
+} // namespace tb
+
+#endif // TB_TABLE_VIEW_H
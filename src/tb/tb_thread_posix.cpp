@@ -0,0 +1,119 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#include "tb_system.h"
+
+#ifdef TB_THREAD_POSIX
+
+#include <pthread.h>
+
+namespace tb {
+
+// == TBThread ====================================================================================
+
+class TBPosixThread : public TBThread
+{
+public:
+	TBPosixThread(TBThreadFunc func, void *data) : m_func(func), m_data(data), m_started(false) {}
+	virtual ~TBPosixThread()
+	{
+		if (m_started)
+			pthread_join(m_thread, nullptr);
+	}
+	bool Start()
+	{
+		m_started = pthread_create(&m_thread, nullptr, ThreadMain, this) == 0;
+		return m_started;
+	}
+private:
+	static void *ThreadMain(void *thread)
+	{
+		TBPosixThread *posix_thread = (TBPosixThread *) thread;
+		posix_thread->m_func(posix_thread->m_data);
+		return nullptr;
+	}
+	TBThreadFunc m_func;
+	void *m_data;
+	pthread_t m_thread;
+	bool m_started;
+};
+
+// static
+TBThread *TBThread::Start(TBThreadFunc func, void *data)
+{
+	TBPosixThread *thread = new TBPosixThread(func, data);
+	if (thread && !thread->Start())
+	{
+		delete thread;
+		return nullptr;
+	}
+	return thread;
+}
+
+// == TBMutex =====================================================================================
+
+class TBPosixMutex : public TBMutex
+{
+public:
+	TBPosixMutex() { pthread_mutex_init(&m_mutex, nullptr); }
+	virtual ~TBPosixMutex() { pthread_mutex_destroy(&m_mutex); }
+	virtual void Lock() { pthread_mutex_lock(&m_mutex); }
+	virtual void Unlock() { pthread_mutex_unlock(&m_mutex); }
+private:
+	pthread_mutex_t m_mutex;
+};
+
+// static
+TBMutex *TBMutex::Create()
+{
+	return new TBPosixMutex;
+}
+
+// == TBSemaphore =================================================================================
+
+/** Unnamed posix semaphores are not supported everywhere (MacOSX), so use a condition variable. */
+class TBPosixSemaphore : public TBSemaphore
+{
+public:
+	TBPosixSemaphore() : m_count(0)
+	{
+		pthread_mutex_init(&m_mutex, nullptr);
+		pthread_cond_init(&m_cond, nullptr);
+	}
+	virtual ~TBPosixSemaphore()
+	{
+		pthread_cond_destroy(&m_cond);
+		pthread_mutex_destroy(&m_mutex);
+	}
+	virtual void Post()
+	{
+		pthread_mutex_lock(&m_mutex);
+		m_count++;
+		pthread_cond_signal(&m_cond);
+		pthread_mutex_unlock(&m_mutex);
+	}
+	virtual void Wait()
+	{
+		pthread_mutex_lock(&m_mutex);
+		while (!m_count)
+			pthread_cond_wait(&m_cond, &m_mutex);
+		m_count--;
+		pthread_mutex_unlock(&m_mutex);
+	}
+private:
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_cond;
+	int m_count;
+};
+
+// static
+TBSemaphore *TBSemaphore::Create()
+{
+	return new TBPosixSemaphore;
+}
+
+} // namespace tb
+
+#endif // TB_THREAD_POSIX
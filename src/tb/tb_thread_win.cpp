@@ -0,0 +1,104 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#include "tb_system.h"
+
+#ifdef TB_THREAD_WINDOWS
+
+#include <Windows.h>
+#include <limits.h>
+
+namespace tb {
+
+// == TBThread ====================================================================================
+
+class TBWinThread : public TBThread
+{
+public:
+	TBWinThread(TBThreadFunc func, void *data) : m_func(func), m_data(data), m_handle(nullptr) {}
+	virtual ~TBWinThread()
+	{
+		if (m_handle)
+		{
+			WaitForSingleObject(m_handle, INFINITE);
+			CloseHandle(m_handle);
+		}
+	}
+	bool Start()
+	{
+		m_handle = CreateThread(nullptr, 0, ThreadMain, this, 0, nullptr);
+		return m_handle != nullptr;
+	}
+private:
+	static DWORD WINAPI ThreadMain(LPVOID thread)
+	{
+		TBWinThread *win_thread = (TBWinThread *) thread;
+		win_thread->m_func(win_thread->m_data);
+		return 0;
+	}
+	TBThreadFunc m_func;
+	void *m_data;
+	HANDLE m_handle;
+};
+
+// static
+TBThread *TBThread::Start(TBThreadFunc func, void *data)
+{
+	TBWinThread *thread = new TBWinThread(func, data);
+	if (thread && !thread->Start())
+	{
+		delete thread;
+		return nullptr;
+	}
+	return thread;
+}
+
+// == TBMutex =====================================================================================
+
+class TBWinMutex : public TBMutex
+{
+public:
+	TBWinMutex() { InitializeCriticalSection(&m_section); }
+	virtual ~TBWinMutex() { DeleteCriticalSection(&m_section); }
+	virtual void Lock() { EnterCriticalSection(&m_section); }
+	virtual void Unlock() { LeaveCriticalSection(&m_section); }
+private:
+	CRITICAL_SECTION m_section;
+};
+
+// static
+TBMutex *TBMutex::Create()
+{
+	return new TBWinMutex;
+}
+
+// == TBSemaphore =================================================================================
+
+class TBWinSemaphore : public TBSemaphore
+{
+public:
+	TBWinSemaphore(HANDLE handle) : m_handle(handle) {}
+	virtual ~TBWinSemaphore() { CloseHandle(m_handle); }
+	virtual void Post() { ReleaseSemaphore(m_handle, 1, nullptr); }
+	virtual void Wait() { WaitForSingleObject(m_handle, INFINITE); }
+private:
+	HANDLE m_handle;
+};
+
+// static
+TBSemaphore *TBSemaphore::Create()
+{
+	HANDLE handle = CreateSemaphore(nullptr, 0, LONG_MAX, nullptr);
+	if (!handle)
+		return nullptr;
+	TBWinSemaphore *semaphore = new TBWinSemaphore(handle);
+	if (!semaphore)
+		CloseHandle(handle);
+	return semaphore;
+}
+
+} // namespace tb
+
+#endif // TB_THREAD_WINDOWS
@@ -68,6 +68,13 @@ void TBSection::SetValue(int value)
 	m_toggle_container.SetValue(value);
 }
 
+void TBSection::SetPendingScrollIntoView(bool pending_scroll)
+{
+	m_pending_scroll = pending_scroll;
+	if (pending_scroll)
+		RequestProcess();
+}
+
 void TBSection::OnProcessAfterChildren()
 {
 	if (m_pending_scroll)
@@ -94,7 +94,7 @@ public:
 	TBToggleContainer *GetContainer() { return &m_toggle_container; }
 
 	/** Set if the section should be scrolled into view after next layout. */
-	void SetPendingScrollIntoView(bool pending_scroll) { m_pending_scroll = pending_scroll; }
+	void SetPendingScrollIntoView(bool pending_scroll);
 
 	/** Set the text of the text field. */
 	virtual bool SetText(const char *text) { return m_header.SetText(text); }
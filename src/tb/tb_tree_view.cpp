@@ -0,0 +1,601 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#include "tb_tree_view.h"
+#include "tb_layout.h"
+#include "tb_widgets_common.h"
+#include "tb_skin.h"
+#include <assert.h>
+
+namespace tb {
+
+/** Number of rows above and below the viewport that get widgets. */
+#define OVERSCAN_ROWS 4
+
+/** The indentation of each level of children, in dp. */
+#define INDENT_DP 16
+
+/** The width of the expand arrow, in dp. */
+#define EXPANDER_WIDTH_DP 10
+
+static int DpToPx(int dp) { return g_tb_skin->GetDimensionConverter()->DpToPx(dp); }
+
+// == TBTreeViewRow ===============================================================================
+
+/** TBTreeViewRow is the widget of a row, showing the expand arrow, image and string of a node. */
+class TBTreeViewRow : public TBLayout
+{
+public:
+	// For safe typecasting
+	TBOBJECT_SUBCLASS(TBTreeViewRow, TBLayout);
+
+	TBTreeViewRow();
+	~TBTreeViewRow();
+
+	/** Set the content of the row. */
+	void Bind(int depth, bool has_children, bool expanded, TBID image, const char *str);
+
+	TBWidget m_indent;
+	TBSkinImage m_expander;
+	TBSkinImage m_image;
+	TBTextField m_textfield;
+};
+
+TBTreeViewRow::TBTreeViewRow()
+{
+	SetSkinBg(TBIDC("TBSelectItem"));
+	SetLayoutDistribution(LAYOUT_DISTRIBUTION_AVAILABLE);
+	SetPaintOverflowFadeout(false);
+
+	m_indent.SetIgnoreInput(true);
+	m_image.SetIgnoreInput(true);
+	m_textfield.SetTextAlign(TB_TEXT_ALIGN_LEFT);
+	m_textfield.SetIgnoreInput(true);
+	LayoutParams lp;
+	lp.SetWidth(DpToPx(EXPANDER_WIDTH_DP));
+	m_expander.SetLayoutParams(lp);
+	AddChild(&m_indent);
+	AddChild(&m_expander);
+	AddChild(&m_textfield);
+}
+
+TBTreeViewRow::~TBTreeViewRow()
+{
+	m_textfield.RemoveFromParent();
+	m_image.RemoveFromParent();
+	m_expander.RemoveFromParent();
+	m_indent.RemoveFromParent();
+}
+
+void TBTreeViewRow::Bind(int depth, bool has_children, bool expanded, TBID image, const char *str)
+{
+	LayoutParams lp;
+	lp.SetWidth(depth * DpToPx(INDENT_DP));
+	m_indent.SetLayoutParams(lp);
+	m_expander.SetSkinBg(has_children ? (expanded ? TBIDC("arrow.down") : TBIDC("arrow.right")) : TBID());
+
+	m_image.RemoveFromParent();
+	if (image)
+	{
+		m_image.SetSkinBg(image);
+		AddChildRelative(&m_image, WIDGET_Z_REL_BEFORE, &m_textfield);
+	}
+	m_textfield.SetText(str);
+}
+
+// == TBTreeSource ================================================================================
+
+TBTreeSource::~TBTreeSource()
+{
+	// If this assert trig, you are deleting a source that's still set on some
+	// TBTreeView. That might be dangerous.
+	assert(!m_views.HasLinks());
+}
+
+void TBTreeSource::InvokeTreeChanged()
+{
+	TBLinkListOf<TBTreeViewLink>::Iterator iter = m_views.IterateForward();
+	while (TBTreeViewLink *link = iter.GetAndStep())
+		static_cast<TBTreeView *>(link)->OnSourceTreeChanged();
+}
+
+void TBTreeSource::InvokeNodesChanged()
+{
+	TBLinkListOf<TBTreeViewLink>::Iterator iter = m_views.IterateForward();
+	while (TBTreeViewLink *link = iter.GetAndStep())
+		static_cast<TBTreeView *>(link)->OnSourceNodesChanged();
+}
+
+// == TBTreeView ==================================================================================
+
+/** A expanded node. The expanded nodes form a tree of their own, so collapsing a node
+	deletes the expanded nodes below it. */
+struct TBTreeView::EXPANDED_NODE : public TBLinkOf<EXPANDED_NODE>
+{
+	EXPANDED_NODE(EXPANDED_NODE *parent, void *node, int index)
+		: parent(parent), node(node), index(index), depth(parent ? parent->depth + 1 : -1), num_visible(0) {}
+	EXPANDED_NODE *parent;
+	void *node;
+	int index;			///< The index of the node among the children of its parent.
+	int depth;			///< The depth of the node. The root has depth -1.
+	int num_visible;	///< The number of visible nodes below this node.
+	TBLinkListAutoDeleteOf<EXPANDED_NODE> children;
+};
+
+/** A range of rows showing consecutive children of a expanded node. */
+struct TBTreeView::SEGMENT
+{
+	SEGMENT(EXPANDED_NODE *parent, int first_index, int count, int first_row)
+		: parent(parent), first_index(first_index), count(count), first_row(first_row) {}
+	EXPANDED_NODE *parent;
+	int first_index;	///< The index of the first child shown.
+	int count;			///< The number of children shown. Never 0.
+	int first_row;
+};
+
+TBTreeView::TBTreeView()
+	: m_source(nullptr)
+	, m_root(nullptr)
+	, m_row_height(0)
+	, m_used_row_height(0)
+	, m_value(-1)
+	, m_rows_invalid(false)
+{
+	SetIsFocusable(true);
+	SetSkinBg(TBIDC("TBTreeView"), WIDGET_INVOKE_INFO_NO_CALLBACKS);
+	m_container.SetGravity(WIDGET_GRAVITY_ALL);
+	m_container.SetRect(GetPaddingRect());
+	AddChild(&m_container);
+	m_rows_root.SetGravity(WIDGET_GRAVITY_ALL);
+	m_container.GetContentRoot()->AddChild(&m_rows_root);
+	m_container.SetScrollMode(SCROLL_MODE_Y_AUTO);
+	m_container.SetAdaptContentSize(true);
+	// Poll the scroll position to update the rows that have widgets.
+	SetWantProcessAlways(true);
+}
+
+TBTreeView::~TBTreeView()
+{
+	// Unlink the source without SetSource, which would update the rows.
+	if (m_source)
+		m_source->m_views.Remove(this);
+	m_source = nullptr;
+	m_segments.DeleteAll();
+	delete m_root;
+	m_rows_root.DeleteAllChildren();
+	m_rows_root.RemoveFromParent();
+	m_container.RemoveFromParent();
+}
+
+void TBTreeView::SetSource(TBTreeSource *source)
+{
+	if (m_source == source)
+		return;
+	if (m_source)
+		m_source->m_views.Remove(this);
+	m_source = source;
+	if (m_source)
+		m_source->m_views.AddLast(this);
+	OnSourceTreeChanged();
+}
+
+void TBTreeView::OnSourceTreeChanged()
+{
+	m_segments.DeleteAll();
+	delete m_root;
+	m_root = nullptr;
+	m_value = -1;
+	if (m_source && (m_root = new EXPANDED_NODE(nullptr, nullptr, 0)))
+	{
+		int num_children = m_source->GetNumChildren(nullptr);
+		SEGMENT *segment = nullptr;
+		if (num_children > 0 && (segment = new SEGMENT(m_root, 0, num_children, 0)))
+		{
+			if (m_segments.Add(segment))
+				m_root->num_visible = num_children;
+			else
+				delete segment;
+		}
+	}
+	m_rows_invalid = true;
+	UpdateRows();
+}
+
+void TBTreeView::OnSourceNodesChanged()
+{
+	m_rows_invalid = true;
+	UpdateRows();
+}
+
+void TBTreeView::SetRowHeight(int height)
+{
+	if (height == m_row_height)
+		return;
+	m_row_height = height;
+	RecycleRowWidgets();
+	UpdateRows();
+}
+
+int TBTreeView::GetRowHeight()
+{
+	if (m_row_height)
+		return m_row_height;
+	if (!m_used_row_height)
+	{
+		// Use the preferred height of a row widget with a expand arrow. It's measured
+		// outside the tree, with the font the rows would inherit.
+		TBTreeViewRow widget;
+		widget.SetFontDescription(m_rows_root.GetCalculatedFontDescription());
+		widget.Bind(0, true, false, TBID(), "");
+		m_used_row_height = MAX(widget.GetPreferredSize().pref_h, 1);
+	}
+	return MAX(m_used_row_height, 1);
+}
+
+int TBTreeView::GetNumRows() const
+{
+	return m_root ? m_root->num_visible : 0;
+}
+
+int TBTreeView::FindSegment(int row) const
+{
+	if (row < 0 || row >= GetNumRows())
+		return -1;
+	// Find the last segment starting at or before the row.
+	int low = 0, high = m_segments.GetNumItems() - 1;
+	while (low < high)
+	{
+		int mid = (low + high + 1) / 2;
+		if (m_segments[mid]->first_row <= row)
+			low = mid;
+		else
+			high = mid - 1;
+	}
+	return low;
+}
+
+void TBTreeView::ShiftSegments(int first_segment, int delta)
+{
+	for (int i = first_segment; i < m_segments.GetNumItems(); i++)
+		m_segments[i]->first_row += delta;
+}
+
+void *TBTreeView::GetNodeAtRow(int row)
+{
+	int i = FindSegment(row);
+	if (i == -1)
+		return nullptr;
+	SEGMENT *segment = m_segments[i];
+	return m_source->GetChild(segment->parent->node, segment->first_index + row - segment->first_row);
+}
+
+int TBTreeView::GetRowDepth(int row) const
+{
+	int i = FindSegment(row);
+	return i == -1 ? -1 : m_segments[i]->parent->depth + 1;
+}
+
+int TBTreeView::GetParentRow(int row) const
+{
+	int i = FindSegment(row);
+	if (i == -1)
+		return -1;
+	// The first children of a node are in the segment right after its row.
+	EXPANDED_NODE *parent = m_segments[i]->parent;
+	for (; i >= 0; i--)
+		if (m_segments[i]->parent == parent && m_segments[i]->first_index == 0)
+			return m_segments[i]->first_row - 1;
+	return -1;
+}
+
+bool TBTreeView::GetExpanded(int row) const
+{
+	// A expanded node is followed by a segment of its first children.
+	int i = FindSegment(row);
+	int next = FindSegment(row + 1);
+	if (i == -1 || next == -1 || next == i)
+		return false;
+	EXPANDED_NODE *expanded = m_segments[next]->parent;
+	return expanded->parent == m_segments[i]->parent &&
+		expanded->index == m_segments[i]->first_index + row - m_segments[i]->first_row;
+}
+
+bool TBTreeView::SetExpanded(int row, bool expanded)
+{
+	if (expanded == GetExpanded(row))
+		return true;
+	if (expanded)
+		return Expand(row);
+	Collapse(row);
+	return true;
+}
+
+bool TBTreeView::Expand(int row)
+{
+	int i = FindSegment(row);
+	if (i == -1)
+		return false;
+	SEGMENT *segment = m_segments[i];
+	const int index = segment->first_index + row - segment->first_row;
+	void *node = m_source->GetChild(segment->parent->node, index);
+	const int num_children = m_source->GetNumChildren(node);
+	if (num_children <= 0)
+		return false;
+
+	// Split the segment after the row, and insert a segment of the children in between.
+	const int num_after = segment->first_index + segment->count - index - 1;
+	if (!m_segments.Reserve(m_segments.GetNumItems() + 2))
+		return false;
+	EXPANDED_NODE *expanded_node = new EXPANDED_NODE(segment->parent, node, index);
+	SEGMENT *children = new SEGMENT(expanded_node, 0, num_children, row + 1);
+	SEGMENT *after = num_after ? new SEGMENT(segment->parent, index + 1, num_after, row + 1) : nullptr;
+	if (!expanded_node || !children || (num_after && !after))
+	{
+		delete expanded_node;
+		delete children;
+		delete after;
+		return false;
+	}
+	segment->count -= num_after;
+	m_segments.Add(children, i + 1);
+	if (after)
+		m_segments.Add(after, i + 2);
+	ShiftSegments(i + 2, num_children);
+
+	segment->parent->children.AddLast(expanded_node);
+	expanded_node->num_visible = num_children;
+	for (EXPANDED_NODE *parent = segment->parent; parent; parent = parent->parent)
+		parent->num_visible += num_children;
+
+	// Keep the same node selected.
+	if (m_value > row)
+		m_value += num_children;
+	m_rows_invalid = true;
+	UpdateRows();
+	return true;
+}
+
+void TBTreeView::Collapse(int row)
+{
+	// Remove the segments of the rows below the node. They are followed by a segment
+	// of the later siblings of the node, if any, which is joined with the segment of the node.
+	int first = FindSegment(row + 1);
+	EXPANDED_NODE *expanded_node = m_segments[first]->parent;
+	const int num_removed = expanded_node->num_visible;
+	while (first < m_segments.GetNumItems() && m_segments[first]->first_row <= row + num_removed)
+		m_segments.Delete(first);
+	ShiftSegments(first, -num_removed);
+	if (first > 0 && first < m_segments.GetNumItems())
+	{
+		SEGMENT *segment = m_segments[first - 1];
+		SEGMENT *after = m_segments[first];
+		if (after->parent == segment->parent && after->first_index == segment->first_index + segment->count)
+		{
+			segment->count += after->count;
+			m_segments.Delete(first);
+		}
+	}
+
+	for (EXPANDED_NODE *parent = expanded_node->parent; parent; parent = parent->parent)
+		parent->num_visible -= num_removed;
+	expanded_node->parent->children.Delete(expanded_node);
+
+	m_rows_invalid = true;
+	if (m_value > row + num_removed)
+		m_value -= num_removed;
+	else if (m_value > row)
+	{
+		// The selected node is hidden, so select the collapsed node instead.
+		m_value = -1;
+		SetValue(row);
+	}
+	UpdateRows();
+}
+
+TBWidget *TBTreeView::GetRowWidget(int row)
+{
+	if (row == -1)
+		return nullptr;
+	const int row_height = GetRowHeight();
+	for (TBWidget *child = m_rows_root.GetFirstChild(); child; child = child->GetNext())
+		if (child->GetRect().y / row_height == row)
+			return child;
+	return nullptr;
+}
+
+void TBTreeView::RecycleRowWidgets()
+{
+	while (TBWidget *child = m_rows_root.GetFirstChild())
+	{
+		child->RemoveFromParent();
+		m_row_pool.Recycle(child, TBIDC("TBTreeView.row"));
+	}
+}
+
+void TBTreeView::BindRowWidget(TBWidget *widget, int row)
+{
+	void *node = GetNodeAtRow(row);
+	static_cast<TBTreeViewRow *>(widget)->Bind(GetRowDepth(row), m_source->HasChildren(node), GetExpanded(row),
+												m_source->GetNodeImage(node), m_source->GetNodeString(node));
+	widget->SetState(WIDGET_STATE_SELECTED, row == m_value);
+}
+
+void TBTreeView::UpdateRows()
+{
+	// Size the content from the number of rows, so the scroll range is right.
+	const int num_rows = GetNumRows();
+	const int row_height = GetRowHeight();
+	const int content_h = num_rows * row_height;
+	const LayoutParams *old_lp = m_rows_root.GetLayoutParams();
+	if (!old_lp || old_lp->pref_h != content_h)
+	{
+		LayoutParams lp;
+		lp.SetHeight(content_h);
+		m_rows_root.SetLayoutParams(lp);
+	}
+
+	// Find the rows intersecting the viewport.
+	const int scroll_y = m_container.GetScrollInfo().y;
+	const int visible_h = m_container.GetPaddingRect().h;
+	const int last_row = MIN((scroll_y + visible_h + row_height - 1) / row_height + OVERSCAN_ROWS, num_rows);
+	const int first_row = MIN(MAX(scroll_y / row_height - OVERSCAN_ROWS, 0), last_row);
+
+	TBWidgetUpdateBlocker update_blocker(&m_rows_root);
+
+	// Recycle widgets for rows outside the range, and bind the others again if the rows
+	// have changed. The widgets are positioned by row, and kept in the same order.
+	for (TBWidget *child = m_rows_root.GetFirstChild(), *next; child; child = next)
+	{
+		next = child->GetNext();
+		int row = child->GetRect().y / row_height;
+		if (row < first_row || row >= last_row)
+		{
+			child->RemoveFromParent();
+			m_row_pool.Recycle(child, TBIDC("TBTreeView.row"));
+		}
+		else if (m_rows_invalid)
+			BindRowWidget(child, row);
+	}
+	m_rows_invalid = false;
+
+	// Add widgets for the rows in range that don't have one, and update the size of the others.
+	const int row_w = m_rows_root.GetRect().w;
+	TBWidget *child = m_rows_root.GetFirstChild();
+	for (int row = first_row; row < last_row; row++)
+	{
+		if (child && child->GetRect().y / row_height == row)
+		{
+			child->SetRect(TBRect(0, row * row_height, row_w, row_height));
+			child = child->GetNext();
+			continue;
+		}
+		TBWidget *widget = m_row_pool.Get(TBIDC("TBTreeView.row"));
+		if (!widget && !(widget = new TBTreeViewRow))
+			continue;
+		BindRowWidget(widget, row);
+		m_rows_root.AddChildRelative(widget, child ? WIDGET_Z_REL_BEFORE : WIDGET_Z_REL_AFTER, child);
+		// Rows are positioned by us, so they shouldn't move when the content is resized.
+		widget->SetGravity(WIDGET_GRAVITY_LEFT_RIGHT | WIDGET_GRAVITY_TOP);
+		widget->SetRect(TBRect(0, row * row_height, row_w, row_height));
+	}
+}
+
+void TBTreeView::ScrollToRow(int row)
+{
+	if (row < 0 || row >= GetNumRows())
+		return;
+	const int row_height = GetRowHeight();
+	m_container.ScrollIntoView(TBRect(0, row * row_height, m_rows_root.GetRect().w, row_height));
+	UpdateRows();
+}
+
+void TBTreeView::SetValue(int value)
+{
+	if (value < 0 || value >= GetNumRows())
+		value = -1;
+	if (value == m_value)
+		return;
+
+	if (TBWidget *widget = GetRowWidget(m_value))
+		widget->SetState(WIDGET_STATE_SELECTED, false);
+	m_value = value;
+	ScrollToRow(m_value);
+	if (TBWidget *widget = GetRowWidget(m_value))
+		widget->SetState(WIDGET_STATE_SELECTED, true);
+
+	TBWidgetEvent ev(EVENT_TYPE_CHANGED);
+	InvokeEvent(ev);
+}
+
+bool TBTreeView::ChangeValue(SPECIAL_KEY key)
+{
+	const int num_rows = GetNumRows();
+	if (!num_rows)
+		return false;
+	int row = m_value;
+	if (key == TB_KEY_HOME || (row == -1 && key == TB_KEY_DOWN))
+		row = 0;
+	else if (key == TB_KEY_END || (row == -1 && key == TB_KEY_UP))
+		row = num_rows - 1;
+	else if (row == -1)
+		return false;
+	else if (key == TB_KEY_UP || key == TB_KEY_DOWN)
+		row += key == TB_KEY_UP ? -1 : 1;
+	else if (key == TB_KEY_LEFT)
+	{
+		if (GetExpanded(row))
+			return SetExpanded(row, false);
+		row = GetParentRow(row);
+	}
+	else if (key == TB_KEY_RIGHT)
+	{
+		if (!GetExpanded(row))
+			return SetExpanded(row, true);
+		row++;
+	}
+	else
+		return false;
+	if (row < 0 || row >= num_rows || row == m_value)
+		return false;
+	SetValue(row);
+	return true;
+}
+
+void TBTreeView::OnSkinChanged()
+{
+	m_container.SetRect(GetPaddingRect());
+}
+
+void TBTreeView::OnFontChanged()
+{
+	// The row widgets inherit the font, so the row height may have changed.
+	m_used_row_height = 0;
+	RecycleRowWidgets();
+	UpdateRows();
+}
+
+void TBTreeView::OnProcessAfterChildren()
+{
+	UpdateRows();
+}
+
+bool TBTreeView::OnEvent(const TBWidgetEvent &ev)
+{
+	if ((ev.type == EVENT_TYPE_CLICK || ev.type == EVENT_TYPE_POINTER_DOWN) &&
+		ev.target != &m_rows_root && m_rows_root.IsAncestorOf(ev.target))
+	{
+		TBWidget *widget = ev.target;
+		while (widget->GetParent() != &m_rows_root)
+			widget = widget->GetParent();
+		TBTreeViewRow *row_widget = static_cast<TBTreeViewRow *>(widget);
+		const int row = widget->GetRect().y / GetRowHeight();
+		const bool on_expander = ev.target == &row_widget->m_expander;
+
+		// Clicking the arrow, or double clicking the row, toggles if it's expanded.
+		if (ev.type == EVENT_TYPE_POINTER_DOWN)
+		{
+			if (ev.count == 2 && !on_expander)
+				SetExpanded(row, !GetExpanded(row));
+			return false;
+		}
+		if (on_expander)
+			SetExpanded(row, !GetExpanded(row));
+		else
+			SetValue(row);
+		return true;
+	}
+	else if (ev.type == EVENT_TYPE_KEY_DOWN)
+	{
+		if (ChangeValue(ev.special_key))
+			return true;
+
+		// Give the scroll container a chance to handle the key so it may scroll.
+		if (m_container.OnEvent(ev))
+			return true;
+	}
+	return false;
+}
+
+} // namespace tb
@@ -0,0 +1,167 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#ifndef TB_TREE_VIEW_H
+#define TB_TREE_VIEW_H
+
+#include "tb_widgets.h"
+#include "tb_scroll_container.h"
+#include "tb_select_item.h"
+
+namespace tb {
+
+class TBTreeView;
+
+/** TBTreeViewLink should never be created or subclassed anywhere except in TBTreeView.
+	It's only purpose is to add a extra typed link for TBTreeView, so TBTreeSource can
+	keep a list of the views showing it. */
+class TBTreeViewLink : public TBLinkOf<TBTreeViewLink> { };
+
+/** TBTreeSource provides the nodes of a TBTreeView.
+
+	Nodes are identified by handles chosen by the source (typically pointers to its own
+	objects), and nullptr is the root. The children of a node are only asked for when it's
+	expanded, and only the nodes of the rows in view are asked for, so the tree may be
+	loaded lazily. If the tree changes, call InvokeTreeChanged or InvokeNodesChanged
+	to update the views. */
+class TBTreeSource
+{
+public:
+	TBTreeSource() {}
+	virtual ~TBTreeSource();
+
+	/** Get the number of children of the given node, or of the root if node is nullptr. */
+	virtual int GetNumChildren(void *node) = 0;
+
+	/** Get the child at index of the given node, or of the root if node is nullptr. */
+	virtual void *GetChild(void *node, int index) = 0;
+
+	/** Return true if the given node has children, so it can be expanded.
+		The default uses GetNumChildren. Override it if counting the children is
+		expensive, since it's called for each row shown. */
+	virtual bool HasChildren(void *node) { return GetNumChildren(node) > 0; }
+
+	/** Get the string of the given node. */
+	virtual const char *GetNodeString(void *node) = 0;
+
+	/** Get the skin image shown before the string of the given node, or 0 for none. */
+	virtual TBID GetNodeImage(void *node) { return TBID(); }
+
+	/** Invoke on all views when nodes have been added or removed.
+		All nodes are collapsed. */
+	void InvokeTreeChanged();
+
+	/** Invoke on all views when the strings or images of nodes have changed. */
+	void InvokeNodesChanged();
+private:
+	friend class TBTreeView;
+	TBLinkListOf<TBTreeViewLink> m_views;
+};
+
+/** TBTreeView shows the nodes of a TBTreeSource as rows that can be expanded and collapsed.
+
+	The rows are the visible nodes in a flattened list, kept as a sorted list of segments
+	of consecutive siblings. Expanding a node only splits the segment it's in, so it costs
+	the same regardless of the number of children, and finding the node of a row is a
+	binary search among the segments.
+
+	Like a virtualized TBSelectList, it only has widgets for the rows in view (and a few
+	rows above and below), and all rows have the same height.
+
+	The value of the tree is the selected row, or -1. The selected node stays selected
+	when rows above it are expanded or collapsed. */
+class TBTreeView : public TBWidget, private TBTreeViewLink
+{
+public:
+	// For safe typecasting
+	TBOBJECT_SUBCLASS(TBTreeView, TBWidget);
+
+	TBTreeView();
+	~TBTreeView();
+
+	/** Set the source which should provide the nodes for this tree.
+		This source needs to live longer than this tree.
+		Set nullptr to unset currently set source. */
+	void SetSource(TBTreeSource *source);
+	TBTreeSource *GetSource() const { return m_source; }
+
+	/** Set the height of the rows. If 0 (default), it's the preferred height of a row. */
+	void SetRowHeight(int height);
+	int GetRowHeight();
+
+	/** Get the number of rows, which is the number of visible nodes. */
+	int GetNumRows() const;
+
+	/** Get the node shown at the given row, or nullptr. */
+	void *GetNodeAtRow(int row);
+
+	/** Get the depth of the node at the given row. Children of the root have depth 0. */
+	int GetRowDepth(int row) const;
+
+	/** Get the row of the parent of the node at the given row, or -1 if it's a child of the root. */
+	int GetParentRow(int row) const;
+
+	/** Expand or collapse the node at the given row.
+		Returns false if it has no children, or on OOM. */
+	bool SetExpanded(int row, bool expanded);
+	bool GetExpanded(int row) const;
+
+	/** Get the widget of the given row, or nullptr if the row is not in view. */
+	TBWidget *GetRowWidget(int row);
+
+	/** Scroll so the given row is visible. */
+	void ScrollToRow(int row);
+
+	/** Set the selected row, or -1 for no selection. */
+	virtual void SetValue(int value);
+	virtual int GetValue() { return m_value; }
+
+	/** Get the node of the selected row, or nullptr. */
+	void *GetSelectedNode() { return GetNodeAtRow(m_value); }
+
+	/** Change the value to another row. Returns true if it was changed.
+		Valid keys:
+			TB_KEY_UP, TB_KEY_DOWN - Previous or next row.
+			TB_KEY_HOME, TB_KEY_END - First or last row.
+			TB_KEY_LEFT - Collapse the row, or select its parent if it's collapsed.
+			TB_KEY_RIGHT - Expand the row, or select its first child if it's expanded. */
+	bool ChangeValue(SPECIAL_KEY key);
+
+	/** Return the scrollcontainer used in this tree. */
+	TBScrollContainer *GetScrollContainer() { return &m_container; }
+
+	virtual void OnSkinChanged();
+	virtual void OnFontChanged();
+	virtual void OnProcessAfterChildren();
+	virtual bool OnEvent(const TBWidgetEvent &ev);
+private:
+	friend class TBTreeSource;
+	struct EXPANDED_NODE;
+	struct SEGMENT;
+	void OnSourceTreeChanged();
+	void OnSourceNodesChanged();
+	int FindSegment(int row) const;
+	void ShiftSegments(int first_segment, int delta);
+	bool Expand(int row);
+	void Collapse(int row);
+	void RecycleRowWidgets();
+	void BindRowWidget(TBWidget *widget, int row);
+	void UpdateRows();
+
+	TBScrollContainer m_container;
+	TBWidget m_rows_root;				///< Parent of the row widgets.
+	TBItemWidgetPool m_row_pool;		///< Row widgets kept for reuse.
+	TBTreeSource *m_source;
+	EXPANDED_NODE *m_root;				///< The root, which is always expanded.
+	TBListAutoDeleteOf<SEGMENT> m_segments;	///< Segments of the visible rows, in row order.
+	int m_row_height;					///< Row height set by SetRowHeight.
+	int m_used_row_height;				///< The row height used, or 0 if not calculated yet.
+	int m_value;
+	bool m_rows_invalid;				///< If the row widgets must be bound again.
+};
+
+} // namespace tb
+
+#endif // TB_TREE_VIEW_H
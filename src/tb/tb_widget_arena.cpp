@@ -0,0 +1,145 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#include "tb_widget_arena.h"
+#include <stdlib.h>
+#include <assert.h>
+
+namespace tb {
+
+/** Size of normal blocks. Larger allocations get a block of their own. */
+#define ARENA_BLOCK_SIZE (32 * 1024)
+
+/** Alignment of all allocations. */
+#define ARENA_ALIGNMENT 16
+
+static size_t ArenaAlign(size_t size) { return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1); }
+
+struct TBWidgetArena::BLOCK
+{
+	BLOCK *next;
+	char *pos;		///< Start of the free space.
+	char *end;		///< End of the block.
+	char *GetData() { return (char *) this + ArenaAlign(sizeof(BLOCK)); }
+};
+
+TBWidgetArena *TBWidgetArena::s_current = nullptr;
+TBWidgetArena *TBWidgetArena::s_first = nullptr;
+
+// == TBWidgetArena ===============================================================================
+
+TBWidgetArena::TBWidgetArena()
+	: m_blocks(nullptr)
+	, m_min(nullptr)
+	, m_max(nullptr)
+	, m_num_allocations(0)
+	, m_released(false)
+	, m_next(s_first)
+{
+	s_first = this;
+}
+
+TBWidgetArena::~TBWidgetArena()
+{
+	assert(!m_num_allocations);
+	assert(s_current != this);
+	TBWidgetArena **link = &s_first;
+	while (*link != this)
+		link = &(*link)->m_next;
+	*link = m_next;
+	while (BLOCK *block = m_blocks)
+	{
+		m_blocks = block->next;
+		free(block);
+	}
+}
+
+void TBWidgetArena::Release()
+{
+	assert(!m_released);
+	if (s_current == this)
+		s_current = nullptr;
+	m_released = true;
+	if (!m_num_allocations)
+		delete this;
+}
+
+void *TBWidgetArena::AllocateInternal(size_t size)
+{
+	size = ArenaAlign(size);
+	BLOCK *block = m_blocks;
+	if (!block || (size_t)(block->end - block->pos) < size)
+	{
+		const size_t data_size = size > ARENA_BLOCK_SIZE / 4 ? size : ARENA_BLOCK_SIZE - ArenaAlign(sizeof(BLOCK));
+		if (!(block = (BLOCK *) malloc(ArenaAlign(sizeof(BLOCK)) + data_size)))
+			return nullptr;
+		block->pos = block->GetData();
+		block->end = block->pos + data_size;
+		// Keep the block with most free space first, so a large allocation with
+		// its own block doesn't waste the space left in the current one.
+		if (m_blocks && data_size == size)
+		{
+			block->next = m_blocks->next;
+			m_blocks->next = block;
+		}
+		else
+		{
+			block->next = m_blocks;
+			m_blocks = block;
+		}
+		if (!m_min || (char *) block < m_min)
+			m_min = (char *) block;
+		if (!m_max || block->end > m_max)
+			m_max = block->end;
+	}
+	void *p = block->pos;
+	block->pos += size;
+	m_num_allocations++;
+	return p;
+}
+
+bool TBWidgetArena::Contains(const void *p) const
+{
+	if ((const char *) p < m_min || (const char *) p >= m_max)
+		return false;
+	for (BLOCK *block = m_blocks; block; block = block->next)
+		if ((const char *) p >= block->GetData() && (const char *) p < block->end)
+			return true;
+	return false;
+}
+
+// static
+void *TBWidgetArena::Allocate(size_t size)
+{
+	if (s_current)
+		return s_current->AllocateInternal(size);
+	return malloc(size);
+}
+
+// static
+void TBWidgetArena::Free(void *p)
+{
+	if (!p)
+		return;
+	if (TBWidgetArena *arena = Find(p))
+	{
+		assert(arena->m_num_allocations > 0);
+		if (--arena->m_num_allocations == 0 && arena->m_released)
+			delete arena;
+		return;
+	}
+	free(p);
+}
+
+// static
+TBWidgetArena *TBWidgetArena::Find(const void *p)
+{
+	for (TBWidgetArena *arena = s_first; arena; arena = arena->m_next)
+		if (arena->Contains(p))
+			return arena;
+	return nullptr;
+}
+
+} // namespace tb
@@ -0,0 +1,76 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#ifndef TB_WIDGET_ARENA_H
+#define TB_WIDGET_ARENA_H
+
+#include "tb_types.h"
+#include <stddef.h>
+
+namespace tb {
+
+/** TBWidgetArena is a memory arena for widgets (and some of their internal data) that are
+	created together and mostly deleted together, such as the widgets inflated from a
+	resource into a TBWindow. See TBWindow::SetArenaEnabled.
+
+	Memory is allocated from large blocks, and isn't reused when single allocations are freed.
+	All blocks are freed at once when the owner has called Release and all allocations
+	from the arena have been freed.
+
+	Widgets are allocated from the current arena (See TBWidgetArenaScope) if there is one,
+	and from the heap otherwise. */
+class TBWidgetArena
+{
+public:
+	TBWidgetArena();
+
+	/** Release the arena. It will be deleted when all allocations from it have been freed,
+		which may be immediately. The arena must not be used by the caller after this. */
+	void Release();
+
+	/** Allocate size bytes from the current arena, or from the heap if there is no
+		current arena. Returns nullptr on OOM. */
+	static void *Allocate(size_t size);
+
+	/** Free memory allocated by Allocate. */
+	static void Free(void *p);
+
+	/** Get the arena that p was allocated from, or nullptr if it was allocated from the heap. */
+	static TBWidgetArena *Find(const void *p);
+
+	/** Get the arena that allocations are currently made from, or nullptr. */
+	static TBWidgetArena *GetCurrent() { return s_current; }
+
+	/** Get the number of allocations from this arena that haven't been freed. */
+	int GetNumAllocations() const { return m_num_allocations; }
+private:
+	friend class TBWidgetArenaScope;
+	struct BLOCK;
+	~TBWidgetArena();
+	void *AllocateInternal(size_t size);
+	bool Contains(const void *p) const;
+	BLOCK *m_blocks;		///< Linked list of blocks, the block with free space first.
+	char *m_min, *m_max;	///< Address range covering all blocks.
+	int m_num_allocations;
+	bool m_released;
+	TBWidgetArena *m_next;	///< Next arena in the list of all arenas.
+	static TBWidgetArena *s_current;
+	static TBWidgetArena *s_first;
+};
+
+/** TBWidgetArenaScope makes the given arena current during its lifetime.
+	It may be nullptr to allocate from the heap in a scope where an arena is current. */
+class TBWidgetArenaScope
+{
+public:
+	TBWidgetArenaScope(TBWidgetArena *arena) : m_old_current(TBWidgetArena::s_current) { TBWidgetArena::s_current = arena; }
+	~TBWidgetArenaScope() { TBWidgetArena::s_current = m_old_current; }
+private:
+	TBWidgetArena *m_old_current;
+};
+
+} // namespace tb
+
+#endif // TB_WIDGET_ARENA_H
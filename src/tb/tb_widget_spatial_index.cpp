@@ -0,0 +1,186 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#include "tb_widget_spatial_index.h"
+#include "tb_sort.h"
+#include <math.h>
+
+namespace tb {
+
+/** Max number of cells in each axis. */
+#define SPATIAL_INDEX_MAX_CELLS 256
+
+static int child_index_cmp(void *, const int *a, const int *b)
+{
+	return *a - *b;
+}
+
+// == TBWidgetSpatialIndex ========================================================================
+
+TBWidgetSpatialIndex::TBWidgetSpatialIndex()
+	: m_num_children(0)
+	, m_num_result(0)
+	, m_cell_w(1), m_cell_h(1)
+	, m_cols(0), m_rows(0)
+	, m_stamp(0)
+	, m_valid(false)
+	, m_result_valid(false)
+{
+}
+
+void TBWidgetSpatialIndex::GetCellRange(const TBRect &rect, int &x0, int &y0, int &x1, int &y1) const
+{
+	x0 = Clamp((rect.x - m_bounds.x) / m_cell_w, 0, m_cols - 1);
+	y0 = Clamp((rect.y - m_bounds.y) / m_cell_h, 0, m_rows - 1);
+	x1 = Clamp((rect.x + rect.w - 1 - m_bounds.x) / m_cell_w, 0, m_cols - 1);
+	y1 = Clamp((rect.y + rect.h - 1 - m_bounds.y) / m_cell_h, 0, m_rows - 1);
+}
+
+bool TBWidgetSpatialIndex::Rebuild(TBWidget *widget)
+{
+	m_result_valid = false;
+
+	int num_children = 0;
+	for (TBWidget *child = widget->GetFirstChild(); child; child = child->GetNext())
+		num_children++;
+	if (!m_children.Reserve(sizeof(TBWidget *) * num_children) ||
+		!m_stamps.Reserve(sizeof(uint32) * num_children) ||
+		!m_result_index.Reserve(sizeof(int) * num_children) ||
+		!m_result.Reserve(sizeof(TBWidget *) * num_children))
+		return false;
+
+	TBWidget **children = (TBWidget **) m_children.GetData();
+	m_num_children = 0;
+	m_bounds.Set(0, 0, 0, 0);
+	for (TBWidget *child = widget->GetFirstChild(); child; child = child->GetNext())
+	{
+		children[m_num_children++] = child;
+		const TBRect &rect = child->GetRect();
+		if (!rect.IsEmpty())
+			m_bounds = m_bounds.IsEmpty() ? rect : m_bounds.Union(rect);
+	}
+	memset(m_stamps.GetData(), 0, sizeof(uint32) * m_num_children);
+	m_stamp = 0;
+
+	// Aim for about one child per cell, with cells shaped like the bounds.
+	m_cols = m_rows = 0;
+	if (!m_bounds.IsEmpty())
+	{
+		float cols = sqrtf((float) m_num_children * m_bounds.w / m_bounds.h);
+		m_cols = Clamp((int) cols, 1, SPATIAL_INDEX_MAX_CELLS);
+		m_rows = Clamp(m_num_children / m_cols, 1, SPATIAL_INDEX_MAX_CELLS);
+		m_cell_w = (m_bounds.w + m_cols - 1) / m_cols;
+		m_cell_h = (m_bounds.h + m_rows - 1) / m_rows;
+	}
+
+	// Count the children in each cell, and make that the start of the following cell.
+	const int num_cells = m_cols * m_rows;
+	if (!m_cell_start.Reserve(sizeof(int) * (num_cells + 1)))
+		return false;
+	int *cell_start = (int *) m_cell_start.GetData();
+	memset(cell_start, 0, sizeof(int) * (num_cells + 1));
+	int x0, y0, x1, y1;
+	for (int i = 0; i < m_num_children && num_cells; i++)
+	{
+		if (children[i]->GetRect().IsEmpty())
+			continue;
+		GetCellRange(children[i]->GetRect(), x0, y0, x1, y1);
+		for (int y = y0; y <= y1; y++)
+			for (int x = x0; x <= x1; x++)
+				cell_start[y * m_cols + x + 1]++;
+	}
+	for (int c = 0; c < num_cells; c++)
+		cell_start[c + 1] += cell_start[c];
+
+	// Fill in the cells. Children are added in z order, so each cell is sorted.
+	if (!m_cell_items.Reserve(sizeof(int) * Max(cell_start[num_cells], 1)))
+		return false;
+	int *cell_items = (int *) m_cell_items.GetData();
+	TBTempBuffer fill_pos_buffer;
+	if (!fill_pos_buffer.Reserve(sizeof(int) * Max(num_cells, 1)))
+		return false;
+	int *fill_pos = (int *) fill_pos_buffer.GetData();
+	memcpy(fill_pos, cell_start, sizeof(int) * num_cells);
+	for (int i = 0; i < m_num_children && num_cells; i++)
+	{
+		if (children[i]->GetRect().IsEmpty())
+			continue;
+		GetCellRange(children[i]->GetRect(), x0, y0, x1, y1);
+		for (int y = y0; y <= y1; y++)
+			for (int x = x0; x <= x1; x++)
+				cell_items[fill_pos[y * m_cols + x]++] = i;
+	}
+	m_valid = true;
+	return true;
+}
+
+int TBWidgetSpatialIndex::GetChildrenInRect(TBWidget *widget, const TBRect &rect, TBWidget **&children)
+{
+	if (!m_valid && !Rebuild(widget))
+		return -1;
+	TBWidget **all_children = (TBWidget **) m_children.GetData();
+	if (m_result_valid && rect.Equals(m_result_rect))
+	{
+		children = (TBWidget **) m_result.GetData();
+		return m_num_result;
+	}
+	m_result_valid = false;
+
+	if (!rect.Intersects(m_bounds))
+	{
+		children = all_children;
+		return 0;
+	}
+
+	// If most of the grid is covered, checking all children is cheaper than collecting them.
+	int x0, y0, x1, y1;
+	GetCellRange(rect, x0, y0, x1, y1);
+	if ((x1 - x0 + 1) * (y1 - y0 + 1) * 2 > m_cols * m_rows)
+	{
+		children = all_children;
+		return m_num_children;
+	}
+
+	// Collect the children from all cells, skipping those already found in another cell.
+	if (++m_stamp == 0)
+	{
+		memset(m_stamps.GetData(), 0, sizeof(uint32) * m_num_children);
+		m_stamp = 1;
+	}
+	uint32 *stamps = (uint32 *) m_stamps.GetData();
+	const int *cell_start = (const int *) m_cell_start.GetData();
+	const int *cell_items = (const int *) m_cell_items.GetData();
+	int *result_index = (int *) m_result_index.GetData();
+	int num_result = 0;
+	for (int y = y0; y <= y1; y++)
+		for (int x = x0; x <= x1; x++)
+		{
+			const int cell = y * m_cols + x;
+			for (int i = cell_start[cell]; i < cell_start[cell + 1]; i++)
+			{
+				const int child_index = cell_items[i];
+				if (stamps[child_index] != m_stamp)
+				{
+					stamps[child_index] = m_stamp;
+					result_index[num_result++] = child_index;
+				}
+			}
+		}
+
+	// Each cell is sorted already, so this is mostly merging a few runs.
+	insertion_sort<void *, int>(result_index, num_result, nullptr, child_index_cmp);
+
+	TBWidget **result = (TBWidget **) m_result.GetData();
+	for (int i = 0; i < num_result; i++)
+		result[i] = all_children[result_index[i]];
+
+	m_num_result = num_result;
+	m_result_rect = rect;
+	m_result_valid = true;
+	children = result;
+	return num_result;
+}
+
+} // namespace tb
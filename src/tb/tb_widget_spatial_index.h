@@ -0,0 +1,56 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#ifndef TB_WIDGET_SPATIAL_INDEX_H
+#define TB_WIDGET_SPATIAL_INDEX_H
+
+#include "tb_widgets.h"
+#include "tb_tempbuffer.h"
+
+namespace tb {
+
+/** TBWidgetSpatialIndex is a uniform grid over the children of a widget, used to find the
+	children that may intersect a rect without checking all of them.
+	See TBWidget::SetSpatialIndexEnabled.
+
+	The grid is rebuilt lazily on the next query after it has been invalidated (when
+	children are added, removed, reordered or change rect). */
+class TBWidgetSpatialIndex
+{
+public:
+	TBWidgetSpatialIndex();
+
+	/** Mark the index as out of date. It will be rebuilt on the next query. */
+	void Invalidate() { m_valid = false; }
+
+	/** Get the children of widget that may intersect rect (in the coordinate space of the
+		children), bottom to top in z order. Returns the number of children in the array
+		returned in children. The array is valid until the next call or invalidation.
+		Returns -1 if the index could not be built (OOM). */
+	int GetChildrenInRect(TBWidget *widget, const TBRect &rect, TBWidget **&children);
+private:
+	bool Rebuild(TBWidget *widget);
+	void GetCellRange(const TBRect &rect, int &x0, int &y0, int &x1, int &y1) const;
+
+	TBTempBuffer m_children;	///< All children in z order (TBWidget *).
+	TBTempBuffer m_cell_start;	///< Start in m_cell_items for each cell, and the end of the last (int).
+	TBTempBuffer m_cell_items;	///< Child indices for all cells, ascending per cell (int).
+	TBTempBuffer m_stamps;		///< Query stamp per child, to skip children already found (uint32).
+	TBTempBuffer m_result_index;///< Child indices found by the last query (int).
+	TBTempBuffer m_result;		///< The result of the last query (TBWidget *).
+	int m_num_children;
+	int m_num_result;
+	TBRect m_bounds;			///< Union of all child rects.
+	TBRect m_result_rect;		///< The rect of the last query.
+	int m_cell_w, m_cell_h;
+	int m_cols, m_rows;
+	uint32 m_stamp;
+	bool m_valid;
+	bool m_result_valid;
+};
+
+} // namespace tb
+
+#endif // TB_WIDGET_SPATIAL_INDEX_H
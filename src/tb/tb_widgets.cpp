@@ -12,6 +12,8 @@
 #include "tb_system.h"
 #include "tb_scroller.h"
 #include "tb_font_renderer.h"
+#include "tb_widget_spatial_index.h"
+#include "tb_widget_arena.h"
 #include <assert.h>
 #ifdef TB_ALWAYS_SHOW_EDIT_FOCUS
 #include "tb_editfield.h"
@@ -29,11 +31,20 @@ int TBWidget::pointer_move_widget_x = 0;
 int TBWidget::pointer_move_widget_y = 0;
 bool TBWidget::cancel_click = false;
 bool TBWidget::update_widget_states = true;
-bool TBWidget::update_skin_states = true;
 bool TBWidget::show_focus_state = false;
 
 static TBHashTableAutoDeleteOf<TBWidget::TOUCH_INFO> s_touch_info;
 
+/** Widgets that have skin conditions depending on other widgets. They are marked
+	for skin update whenever any widget calls InvalidateSkinStates. */
+static TBListOf<TBWidget> s_skin_dependents;
+
+static void SetSkinDependentsDirty()
+{
+	for (int i = 0; i < s_skin_dependents.GetNumItems(); i++)
+		s_skin_dependents.Get(i)->InvalidateSkinStatesLocal();
+}
+
 TBWidget::TOUCH_INFO *TBWidget::GetTouchInfo(uint32 id)
 {
 	return s_touch_info.Get(id);
@@ -73,6 +84,378 @@ private:
 	bool m_touch;
 };
 
+// == TBWidgetIDIndex ==================================================================
+
+/** Return true if widget a comes before widget b in tree order (the order
+	GetWidgetByID would search them). */
+static bool IsBeforeInTreeOrder(TBWidget *a, TBWidget *b)
+{
+	if (a->IsAncestorOf(b))
+		return true;
+	if (b->IsAncestorOf(a))
+		return false;
+	// Find the children of the closest common ancestor that contain a and b,
+	// and check which one comes first among the siblings.
+	for (TBWidget *a_branch = a; a_branch->GetParent(); a_branch = a_branch->GetParent())
+	{
+		TBWidget *common_parent = a_branch->GetParent();
+		if (!common_parent->IsAncestorOf(b))
+			continue;
+		TBWidget *b_branch = b;
+		while (b_branch->GetParent() != common_parent)
+			b_branch = b_branch->GetParent();
+		for (TBWidget *tmp = a_branch->GetNext(); tmp; tmp = tmp->GetNext())
+			if (tmp == b_branch)
+				return true;
+		return false;
+	}
+	return false;
+}
+
+/** TBWidgetIDIndex maps ids to the widgets with that id, in the subtree of the widget owning it.
+	Widgets with id 0 are not indexed. */
+class TBWidgetIDIndex
+{
+public:
+	TBWidgetIDIndex() : m_valid(true) {}
+
+	/** Add the widget and all its children. */
+	void AddSubtree(TBWidget *widget)
+	{
+		Add(widget);
+		for (TBWidget *child = widget->GetFirstChild(); child; child = child->GetNext())
+			AddSubtree(child);
+	}
+
+	/** Remove the widget and all its children. */
+	void RemoveSubtree(TBWidget *widget)
+	{
+		Remove(widget);
+		for (TBWidget *child = widget->GetFirstChild(); child; child = child->GetNext())
+			RemoveSubtree(child);
+	}
+
+	void Add(TBWidget *widget)
+	{
+		if (!widget->GetID())
+			return;
+		TBListOf<TBWidget> *list = m_widgets.Get(widget->GetID());
+		if (!list && (list = new TBListOf<TBWidget>) && !m_widgets.Add(widget->GetID(), list))
+		{
+			delete list;
+			list = nullptr;
+		}
+		// If we fail, the index is incomplete and can't be used anymore.
+		if (!list || !list->Add(widget))
+			m_valid = false;
+	}
+
+	void Remove(TBWidget *widget)
+	{
+		if (!widget->GetID())
+			return;
+		if (TBListOf<TBWidget> *list = m_widgets.Get(widget->GetID()))
+		{
+			int index = list->Find(widget);
+			if (index != -1)
+				list->RemoveFast(index);
+			if (!list->GetNumItems())
+				m_widgets.Delete(widget->GetID());
+		}
+	}
+
+	/** Return true if the index is complete and can be used for lookups. */
+	bool IsValid() const { return m_valid; }
+
+	/** Get the first widget in tree order with the given id and type (if type_id is
+		not nullptr), that is root or a child of root. */
+	TBWidget *Find(TBWidget *root, const TBID &id, const TB_TYPE_ID type_id) const
+	{
+		TBWidget *found = nullptr;
+		if (TBListOf<TBWidget> *list = m_widgets.Get(id))
+		{
+			for (int i = 0; i < list->GetNumItems(); i++)
+			{
+				TBWidget *widget = list->Get(i);
+				if ((!type_id || widget->IsOfTypeId(type_id)) && root->IsAncestorOf(widget) &&
+					(!found || IsBeforeInTreeOrder(widget, found)))
+					found = widget;
+			}
+		}
+		return found;
+	}
+private:
+	TBHashTableAutoDeleteOf<TBListOf<TBWidget>> m_widgets;
+	bool m_valid;
+};
+
+// == TBWidgetChildIndex ================================================================
+
+/** Children walked by GetChildFromIndex or GetIndexFromChild before a TBWidgetChildIndex
+	is created for the widget. Small containers never get an index. */
+#define CHILD_INDEX_MIN_CHILDREN 32
+
+/** TBWidgetChildIndex is an array of the children of a widget, with a hash table from
+	child to index, making TBWidget::GetChildFromIndex and GetIndexFromChild constant time.
+
+	It's rebuilt lazily on the next lookup after it has been invalidated (when children are
+	added, removed or reordered). */
+class TBWidgetChildIndex
+{
+public:
+	TBWidgetChildIndex() : m_num_children(0), m_table_mask(0), m_valid(false) {}
+
+	/** Mark the index as out of date. It will be rebuilt on the next lookup. */
+	void Invalidate() { m_valid = false; }
+
+	/** Get the child at index, or nullptr. Returns false if the index could not be built (OOM). */
+	bool GetChild(const TBWidget *widget, int index, TBWidget *&child)
+	{
+		if (!m_valid && !Rebuild(widget))
+			return false;
+		child = index >= 0 && index < m_num_children ? GetChildren()[index] : nullptr;
+		return true;
+	}
+
+	/** Get the index of child, or -1. Returns false if the index could not be built (OOM). */
+	bool GetIndex(const TBWidget *widget, const TBWidget *child, int &index)
+	{
+		if (!m_valid && !Rebuild(widget))
+			return false;
+		TBWidget **children = GetChildren();
+		const int *table = (const int *) m_table.GetData();
+		for (uint32 slot = Hash(child) & m_table_mask; table[slot] != -1; slot = (slot + 1) & m_table_mask)
+			if (children[table[slot]] == child)
+			{
+				index = table[slot];
+				return true;
+			}
+		index = -1;
+		return true;
+	}
+private:
+	static uint32 Hash(const TBWidget *child)
+	{
+		// Widgets are at least pointer aligned, so skip the low bits.
+		size_t key = ((size_t) child) >> 3;
+		return (uint32) (key ^ (key >> 16)) * 2654435761u;
+	}
+
+	TBWidget **GetChildren() const { return (TBWidget **) m_children.GetData(); }
+
+	bool Rebuild(const TBWidget *widget)
+	{
+		int num_children = 0;
+		for (TBWidget *child = widget->GetFirstChild(); child; child = child->GetNext())
+			num_children++;
+
+		// Keep the table at most half full.
+		uint32 table_size = 16;
+		while (table_size < (uint32) num_children * 2)
+			table_size *= 2;
+		if (!m_children.Reserve(sizeof(TBWidget *) * num_children) ||
+			!m_table.Reserve(sizeof(int) * table_size))
+			return false;
+
+		TBWidget **children = GetChildren();
+		int *table = (int *) m_table.GetData();
+		memset(table, 0xff, sizeof(int) * table_size);
+		m_table_mask = table_size - 1;
+		m_num_children = 0;
+		for (TBWidget *child = widget->GetFirstChild(); child; child = child->GetNext())
+		{
+			uint32 slot = Hash(child) & m_table_mask;
+			while (table[slot] != -1)
+				slot = (slot + 1) & m_table_mask;
+			table[slot] = m_num_children;
+			children[m_num_children++] = child;
+		}
+		m_valid = true;
+		return true;
+	}
+
+	TBTempBuffer m_children;	///< All children in order (TBWidget *).
+	TBTempBuffer m_table;		///< Open addressing hash table of child indices, -1 if unused (int).
+	int m_num_children;
+	uint32 m_table_mask;
+	bool m_valid;
+};
+
+// == TBWidgetUpdateBatch ===============================================================
+
+/** TBWidgetUpdateBatch collects the invalidations and listener notifications that are
+	delayed until TBWidget::EndUpdate. */
+class TBWidgetUpdateBatch
+{
+public:
+	TBWidgetUpdateBatch()
+		: update_count(1)
+		, invalidate(false)
+		, invalidate_layout(false)
+		, invalidate_layout_recursive(false)
+		, invalidate_skin_states(false) {}
+
+	int update_count;
+	bool invalidate;
+	bool invalidate_layout;
+	bool invalidate_layout_recursive;
+	bool invalidate_skin_states;
+	/** Children added but not yet notified to TBWidgetListener. Entries are set to
+		nullptr if the child is removed or deleted before it's notified. */
+	TBListOf<TBWidget> added;
+};
+
+/** All update batches, so pending children can be found when deleted. */
+static TBListOf<TBWidgetUpdateBatch> s_update_batches;
+
+/** Forget the pending notification for the given child (See TBWidget::is_pending_added). */
+static void RemovePendingAdded(TBWidget *child)
+{
+	for (int i = 0; i < s_update_batches.GetNumItems(); i++)
+	{
+		TBListOf<TBWidget> &added = s_update_batches[i]->added;
+		int index = added.Find(child);
+		if (index != -1)
+		{
+			added.Set(nullptr, index);
+			return;
+		}
+	}
+}
+
+// == TBPreferredSizeCache ==============================================================
+
+/** Number of preferred sizes kept by a TBPreferredSizeCache. */
+#define PS_CACHE_SIZE 3
+
+/** TBPreferredSizeCache keeps the preferred sizes a widget calculated for its recent
+	constraints, other than the most recent one which is kept in TBWidget.
+
+	Layouts may ask a widget for its size with a few different constraints in turn (f.ex
+	a TBScrollContainer with and without scrollbars). Widgets with a size that depends on
+	the constraints (SIZE_DEP) would otherwise recalculate it each time. It's only created
+	for those widgets. */
+class TBPreferredSizeCache
+{
+public:
+	TBPreferredSizeCache() : num_entries(0) {}
+
+	/** Add ps calculated for sc as the most recently used entry. The least recently used
+		entry is dropped if the cache is full. */
+	void Add(const PreferredSize &ps, const SizeConstraints &sc)
+	{
+		num_entries = MIN(num_entries + 1, PS_CACHE_SIZE);
+		for (int i = num_entries - 1; i > 0; i--)
+		{
+			this->ps[i] = this->ps[i - 1];
+			this->sc[i] = this->sc[i - 1];
+		}
+		this->ps[0] = ps;
+		this->sc[0] = sc;
+	}
+
+	/** Remove the entry at index. */
+	void Remove(int index)
+	{
+		num_entries--;
+		for (int i = index; i < num_entries; i++)
+		{
+			ps[i] = ps[i + 1];
+			sc[i] = sc[i + 1];
+		}
+	}
+
+	PreferredSize ps[PS_CACHE_SIZE];
+	SizeConstraints sc[PS_CACHE_SIZE];
+	int num_entries;	///< Number of valid entries, the most recently used first.
+};
+
+/** Return true if ps, calculated with the constraints cached_sc, is also the preferred
+	size with the constraints sc. Only the constraints it depends on need to be the same. */
+static bool IsPreferredSizeValidFor(const PreferredSize &ps, const SizeConstraints &cached_sc, const SizeConstraints &sc)
+{
+	if ((ps.size_dependency & SIZE_DEP_WIDTH_DEPEND_ON_HEIGHT) && cached_sc.available_h != sc.available_h)
+		return false;
+	if ((ps.size_dependency & SIZE_DEP_HEIGHT_DEPEND_ON_WIDTH) && cached_sc.available_w != sc.available_w)
+		return false;
+	return true;
+}
+
+// == TBWidgetExtension =================================================================
+
+/** TBWidgetExtension holds the fields of TBWidget that most widgets never use.
+	It's allocated the first time any of them is needed, and lives until the
+	widget is deleted. See TBWidget::GetExtension. */
+class TBWidgetExtension
+{
+public:
+	TBWidgetExtension()
+		: has_layout_params(false)
+		, scroller(nullptr)
+		, long_click_timer(nullptr)
+		, id_index(nullptr)
+		, spatial_index(nullptr)
+		, child_index(nullptr)
+		, update_batch(nullptr)
+		, ps_cache(nullptr) {}
+
+	static void *operator new(size_t size) throw() { return TBWidgetArena::Allocate(size); }
+	static void operator delete(void *p) { TBWidgetArena::Free(p); }
+
+	TBID group_id;							///< ID for button groups (such as TBRadioButton)
+	TBWidgetValueConnection connection;		///< TBWidget value connection
+	TBLinkListOf<TBWidgetListener> listeners;	///< List of listeners
+	LayoutParams layout_params;				///< Layout params, if has_layout_params.
+	bool has_layout_params;
+	TBScroller *scroller;
+	TBLongClickTimer *long_click_timer;
+	TBWidgetIDIndex *id_index;				///< Index of ids in this subtree, or nullptr. See SetIDIndexEnabled.
+	TBWidgetSpatialIndex *spatial_index;	///< Index of child rects, or nullptr. See SetSpatialIndexEnabled.
+	TBWidgetChildIndex *child_index;		///< Index of children, or nullptr. See GetChildFromIndex.
+	TBWidgetUpdateBatch *update_batch;		///< Delayed invalidations, or nullptr. See BeginUpdate.
+	TBPreferredSizeCache *ps_cache;			///< Older preferred sizes, or nullptr. See GetPreferredSize.
+};
+
+/** Listener list used by widgets without extension. */
+static TBLinkListOf<TBWidgetListener> s_no_listeners;
+
+// == TBChildrenInRect ==================================================================
+
+/** Iterates the children of a widget that may intersect a rect (See TBWidget::GetChildrenInRect),
+	or all children if the widget doesn't know. */
+class TBChildrenInRect
+{
+public:
+	TBChildrenInRect(const TBWidget *widget, const TBRect &rect, bool top_to_bottom)
+		: m_top_to_bottom(top_to_bottom)
+	{
+		m_num = widget->GetChildrenInRect(rect, m_children);
+		if (m_num == -1)
+			m_next = top_to_bottom ? widget->GetLastChild() : widget->GetFirstChild();
+		else
+			m_index = top_to_bottom ? m_num - 1 : 0;
+	}
+	TBWidget *GetNext()
+	{
+		if (m_num == -1)
+		{
+			TBWidget *widget = m_next;
+			if (widget)
+				m_next = m_top_to_bottom ? widget->GetPrev() : widget->GetNext();
+			return widget;
+		}
+		if (m_index < 0 || m_index >= m_num)
+			return nullptr;
+		return m_children[m_top_to_bottom ? m_index-- : m_index++];
+	}
+private:
+	TBWidget **m_children;
+	TBWidget *m_next;
+	int m_num;
+	int m_index;
+	bool m_top_to_bottom;
+};
+
 // == TBWidget::PaintProps ==============================================================
 
 TBWidget::PaintProps::PaintProps()
@@ -86,12 +469,14 @@ TBWidget::PaintProps::PaintProps()
 
 TBWidget::TBWidget()
 	: m_parent(nullptr)
+	, m_skin_bg_element(nullptr)
+	, m_skin_bg_element_generation(0)
 	, m_opacity(1.f)
 	, m_state(WIDGET_STATE_NONE)
 	, m_gravity(WIDGET_GRAVITY_DEFAULT)
-	, m_layout_params(nullptr)
-	, m_scroller(nullptr)
-	, m_long_click_timer(nullptr)
+	, m_font(nullptr)
+	, m_font_generation(0)
+	, m_ext(nullptr)
 	, m_packed_init(0)
 {
 #ifdef TB_RUNTIME_DEBUG_INFO
@@ -126,12 +511,47 @@ TBWidget::~TBWidget()
 	TBWidgetListener::InvokeWidgetDelete(this);
 	DeleteAllChildren();
 
-	delete m_scroller;
-	delete m_layout_params;
-
+	SetSkinDependsOnOthers(false);
 	StopLongClickTimer();
 
-	assert(!m_listeners.HasLinks()); // There's still listeners added to this widget!
+	if (m_packed.is_pending_added)
+		RemovePendingAdded(this);
+
+	if (m_ext)
+	{
+		delete m_ext->scroller;
+		delete m_ext->id_index;
+		delete m_ext->spatial_index;
+		delete m_ext->child_index;
+		delete m_ext->ps_cache;
+
+		assert(!m_ext->update_batch); // BeginUpdate without EndUpdate!
+		if (m_ext->update_batch)
+		{
+			s_update_batches.RemoveFast(s_update_batches.Find(m_ext->update_batch));
+			delete m_ext->update_batch;
+		}
+
+		assert(!m_ext->listeners.HasLinks()); // There's still listeners added to this widget!
+		delete m_ext;
+	}
+}
+
+void *TBWidget::operator new(size_t size) throw()
+{
+	return TBWidgetArena::Allocate(size);
+}
+
+void TBWidget::operator delete(void *p)
+{
+	TBWidgetArena::Free(p);
+}
+
+TBWidgetExtension *TBWidget::GetExtension() const
+{
+	if (!m_ext)
+		m_ext = new TBWidgetExtension;
+	return m_ext;
 }
 
 void TBWidget::SetRect(const TBRect &rect)
@@ -142,14 +562,25 @@ void TBWidget::SetRect(const TBRect &rect)
 	TBRect old_rect = m_rect;
 	m_rect = rect;
 
+	if (m_parent && m_parent->m_ext && m_parent->m_ext->spatial_index)
+		m_parent->m_ext->spatial_index->Invalidate();
+
 	if (old_rect.w != m_rect.w || old_rect.h != m_rect.h)
 		OnResized(old_rect.w, old_rect.h);
 
+	if (m_parent)
+		m_parent->OnChildRectChanged(this);
+
 	Invalidate();
 }
 
 void TBWidget::Invalidate()
 {
+	if (m_ext && m_ext->update_batch)
+	{
+		m_ext->update_batch->invalidate = true;
+		return;
+	}
 	if (!GetVisibilityCombined() && !m_rect.IsEmpty())
 		return;
 	TBWidget *tmp = this;
@@ -157,6 +588,11 @@ void TBWidget::Invalidate()
 	{
 		tmp->OnInvalid();
 		tmp = tmp->m_parent;
+		if (tmp && tmp->m_ext && tmp->m_ext->update_batch)
+		{
+			tmp->m_ext->update_batch->invalidate = true;
+			break;
+		}
 	}
 }
 
@@ -168,7 +604,35 @@ void TBWidget::InvalidateStates()
 
 void TBWidget::InvalidateSkinStates()
 {
-	update_skin_states = true;
+	InvalidateSkinStatesLocal();
+	if (TBWidgetUpdateBatch *batch = GetUpdateBatch())
+		batch->invalidate_skin_states = true;
+	else
+		SetSkinDependentsDirty();
+}
+
+void TBWidget::InvalidateSkinStatesLocal()
+{
+	m_skin_bg_element_generation = 0;
+	m_packed.skin_states_dirty = 1;
+	// Mark the path to the root, so InvokeProcess can find this widget. If a parent is
+	// already marked, so are all its parents.
+	for (TBWidget *tmp = m_parent; tmp && !tmp->m_packed.skin_states_dirty_children; tmp = tmp->m_parent)
+		tmp->m_packed.skin_states_dirty_children = 1;
+}
+
+void TBWidget::SetSkinDependsOnOthers(bool depends)
+{
+	if (depends == !!m_packed.skin_depends_on_others)
+		return;
+	if (depends)
+	{
+		if (!s_skin_dependents.Add(this))
+			return;
+	}
+	else
+		s_skin_dependents.RemoveFast(s_skin_dependents.Find(this));
+	m_packed.skin_depends_on_others = depends;
 }
 
 void TBWidget::Die()
@@ -186,12 +650,30 @@ void TBWidget::Die()
 }
 
 TBWidget *TBWidget::GetWidgetByIDInternal(const TBID &id, const TB_TYPE_ID type_id)
+{
+	// Use the id index of the closest widget that has one.
+	if (id)
+	{
+		for (TBWidget *tmp = this; tmp; tmp = tmp->m_parent)
+		{
+			if (tmp->m_ext && tmp->m_ext->id_index)
+			{
+				if (tmp->m_ext->id_index->IsValid())
+					return tmp->m_ext->id_index->Find(this, id, type_id);
+				break;
+			}
+		}
+	}
+	return GetWidgetByIDSearch(id, type_id);
+}
+
+TBWidget *TBWidget::GetWidgetByIDSearch(const TBID &id, const TB_TYPE_ID type_id)
 {
 	if (m_id == id && (!type_id || IsOfTypeId(type_id)))
 		return this;
 	for (TBWidget *child = GetFirstChild(); child; child = child->GetNext())
 	{
-		if (TBWidget *sub_child = child->GetWidgetByIDInternal(id, type_id))
+		if (TBWidget *sub_child = child->GetWidgetByIDSearch(id, type_id))
 			return sub_child;
 	}
 	return nullptr;
@@ -213,10 +695,32 @@ int TBWidget::GetValueByID(const TBID &id)
 
 void TBWidget::SetID(const TBID &id)
 {
+	for (TBWidget *tmp = this; tmp; tmp = tmp->m_parent)
+		if (tmp->m_ext && tmp->m_ext->id_index)
+			tmp->m_ext->id_index->Remove(this);
 	m_id = id;
+	for (TBWidget *tmp = this; tmp; tmp = tmp->m_parent)
+		if (tmp->m_ext && tmp->m_ext->id_index)
+			tmp->m_ext->id_index->Add(this);
 	InvalidateSkinStates();
 }
 
+bool TBWidget::SetIDIndexEnabled(bool enable)
+{
+	if (enable == GetIDIndexEnabled())
+		return true;
+	if (enable)
+	{
+		if (!GetExtension() || !(m_ext->id_index = new TBWidgetIDIndex))
+			return false;
+		m_ext->id_index->AddSubtree(this);
+		return m_ext->id_index->IsValid();
+	}
+	delete m_ext->id_index;
+	m_ext->id_index = nullptr;
+	return true;
+}
+
 void TBWidget::SetStateRaw(WIDGET_STATE state)
 {
 	if (m_state == state)
@@ -255,7 +759,10 @@ void TBWidget::SetAutoFocusState(bool on)
 		return;
 	show_focus_state = on;
 	if (focused_widget)
+	{
 		focused_widget->Invalidate();
+		focused_widget->InvalidateSkinStates();
+	}
 }
 
 void TBWidget::SetOpacity(float opacity)
@@ -329,6 +836,19 @@ void TBWidget::AddChildRelative(TBWidget *child, WIDGET_Z_REL z, TBWidget *refer
 	assert(!child->m_parent);
 	child->m_parent = this;
 
+	// Make sure skin updates needed in the added subtree are found from the new root.
+	if (child->m_packed.skin_states_dirty || child->m_packed.skin_states_dirty_children)
+		for (TBWidget *tmp = this; tmp && !tmp->m_packed.skin_states_dirty_children; tmp = tmp->m_parent)
+			tmp->m_packed.skin_states_dirty_children = 1;
+
+	if (child->m_packed.process_requested || child->m_packed.process_requested_children)
+		for (TBWidget *tmp = this; tmp && !tmp->m_packed.process_requested_children; tmp = tmp->m_parent)
+			tmp->m_packed.process_requested_children = 1;
+
+	// The font may be inherited from a different parent now.
+	if (child->m_font_desc.GetFontFaceID() == 0)
+		child->InvalidateFontRecursive();
+
 	if (reference)
 	{
 		if (z == WIDGET_Z_REL_BEFORE)
@@ -344,11 +864,23 @@ void TBWidget::AddChildRelative(TBWidget *child, WIDGET_Z_REL z, TBWidget *refer
 			m_children.AddLast(child);
 	}
 
+	for (TBWidget *tmp = this; tmp; tmp = tmp->m_parent)
+		if (tmp->m_ext && tmp->m_ext->id_index)
+			tmp->m_ext->id_index->AddSubtree(child);
+	if (m_ext && m_ext->spatial_index)
+		m_ext->spatial_index->Invalidate();
+	if (m_ext && m_ext->child_index)
+		m_ext->child_index->Invalidate();
+
 	if (info == WIDGET_INVOKE_INFO_NORMAL)
 	{
 		OnChildAdded(child);
 		child->OnAdded();
-		TBWidgetListener::InvokeWidgetAdded(this, child);
+		TBWidgetUpdateBatch *batch = GetUpdateBatch();
+		if (batch && batch->added.Add(child))
+			child->m_packed.is_pending_added = 1;
+		else
+			TBWidgetListener::InvokeWidgetAdded(this, child);
 	}
 	InvalidateLayout(INVALIDATE_LAYOUT_RECURSIVE);
 	Invalidate();
@@ -368,12 +900,30 @@ void TBWidget::RemoveChild(TBWidget *child, WIDGET_INVOKE_INFO info)
 
 		OnChildRemove(child);
 		child->OnRemove();
-		TBWidgetListener::InvokeWidgetRemove(this, child);
+		// Listeners that were never told about the child shouldn't be told it's removed.
+		if (child->m_packed.is_pending_added)
+		{
+			RemovePendingAdded(child);
+			child->m_packed.is_pending_added = 0;
+		}
+		else
+			TBWidgetListener::InvokeWidgetRemove(this, child);
 	}
 
+	for (TBWidget *tmp = this; tmp; tmp = tmp->m_parent)
+		if (tmp->m_ext && tmp->m_ext->id_index)
+			tmp->m_ext->id_index->RemoveSubtree(child);
+	if (m_ext && m_ext->spatial_index)
+		m_ext->spatial_index->Invalidate();
+	if (m_ext && m_ext->child_index)
+		m_ext->child_index->Invalidate();
+
 	m_children.Remove(child);
 	child->m_parent = nullptr;
 
+	if (!m_packed.is_dying && child->m_font_desc.GetFontFaceID() == 0)
+		child->InvalidateFontRecursive();
+
 	InvalidateLayout(INVALIDATE_LAYOUT_RECURSIVE);
 	Invalidate();
 	InvalidateSkinStates();
@@ -396,9 +946,21 @@ void TBWidget::SetZ(WIDGET_Z z)
 		return; // Already at the top
 	if (z == WIDGET_Z_BOTTOM && this == m_parent->m_children.GetFirst())
 		return; // Already at the top
+	// Move it directly in the child list. Removing and adding it again would
+	// also remove and add the whole subtree to any id index.
 	TBWidget *parent = m_parent;
-	parent->RemoveChild(this, WIDGET_INVOKE_INFO_NO_CALLBACKS);
-	parent->AddChild(this, z, WIDGET_INVOKE_INFO_NO_CALLBACKS);
+	parent->m_children.Remove(this);
+	if (z == WIDGET_Z_TOP)
+		parent->m_children.AddLast(this);
+	else
+		parent->m_children.AddFirst(this);
+	if (parent->m_ext && parent->m_ext->spatial_index)
+		parent->m_ext->spatial_index->Invalidate();
+	if (parent->m_ext && parent->m_ext->child_index)
+		parent->m_ext->child_index->Invalidate();
+	parent->InvalidateLayout(INVALIDATE_LAYOUT_RECURSIVE);
+	parent->Invalidate();
+	parent->InvalidateSkinStates();
 }
 
 void TBWidget::SetGravity(WIDGET_GRAVITY g)
@@ -431,9 +993,17 @@ void TBWidget::SetSkinBg(const TBID &skin_bg, WIDGET_INVOKE_INFO info)
 
 TBSkinElement *TBWidget::GetSkinBgElement()
 {
-	TBWidgetSkinConditionContext context(this);
-	WIDGET_STATE state = GetAutoState();
-	return g_tb_skin->GetSkinElementStrongOverride(m_skin_bg, static_cast<SKIN_STATE>(state), context);
+	const uint32 generation = g_tb_skin->GetStateGeneration();
+	if (m_skin_bg_element_generation != generation || m_packed.skin_bg_element_uncacheable)
+	{
+		if (m_skin_bg_element_generation != generation)
+			m_packed.skin_bg_element_uncacheable = !g_tb_skin->IsStrongOverrideCacheable(m_skin_bg);
+		TBWidgetSkinConditionContext context(this);
+		WIDGET_STATE state = GetAutoState();
+		m_skin_bg_element = g_tb_skin->GetSkinElementStrongOverride(m_skin_bg, static_cast<SKIN_STATE>(state), context);
+		m_skin_bg_element_generation = generation;
+	}
+	return m_skin_bg_element;
 }
 
 TBWidget *TBWidget::FindScrollableWidget(bool scroll_x, bool scroll_y)
@@ -455,8 +1025,8 @@ TBScroller *TBWidget::FindStartedScroller()
 	TBWidget *candidate = this;
 	while (candidate)
 	{
-		if (candidate->m_scroller && candidate->m_scroller->IsStarted())
-			return candidate->m_scroller;
+		if (candidate->m_ext && candidate->m_ext->scroller && candidate->m_ext->scroller->IsStarted())
+			return candidate->m_ext->scroller;
 		candidate = candidate->GetParent();
 	}
 	return nullptr;
@@ -474,9 +1044,11 @@ TBScroller *TBWidget::GetReadyScroller(bool scroll_x, bool scroll_y)
 
 TBScroller *TBWidget::GetScroller()
 {
-	if (!m_scroller)
-		m_scroller = new TBScroller(this);
-	return m_scroller;
+	if (!GetExtension())
+		return nullptr;
+	if (!m_ext->scroller)
+		m_ext->scroller = new TBScroller(this);
+	return m_ext->scroller;
 }
 
 void TBWidget::ScrollToSmooth(int x, int y)
@@ -708,43 +1280,81 @@ TBWidget *TBWidget::GetWidgetAt(int x, int y, bool include_children) const
 	x -= child_translation_x;
 	y -= child_translation_y;
 
-	TBWidget *tmp = GetFirstChild();
-	TBWidget *last_match = nullptr;
-	while (tmp)
+	// The topmost child that is hit wins, so check from the top.
+	TBChildrenInRect children(this, TBRect(x, y, 1, 1), true);
+	while (TBWidget *tmp = children.GetNext())
 	{
 		WIDGET_HIT_STATUS hit_status = tmp->GetHitStatus(x - tmp->m_rect.x, y - tmp->m_rect.y);
 		if (hit_status)
 		{
 			if (include_children && hit_status != WIDGET_HIT_STATUS_HIT_NO_CHILDREN)
 			{
-				last_match = tmp->GetWidgetAt(x - tmp->m_rect.x, y - tmp->m_rect.y, include_children);
-				if (!last_match)
-					last_match = tmp;
+				if (TBWidget *sub_child = tmp->GetWidgetAt(x - tmp->m_rect.x, y - tmp->m_rect.y, include_children))
+					return sub_child;
 			}
-			else
-				last_match = tmp;
+			return tmp;
 		}
-		tmp = tmp->GetNext();
 	}
-	return last_match;
+	return nullptr;
+}
+
+int TBWidget::GetChildrenInRect(const TBRect &rect, TBWidget **&children) const
+{
+	if (m_ext && m_ext->spatial_index)
+		return m_ext->spatial_index->GetChildrenInRect(const_cast<TBWidget *>(this), rect, children);
+	return -1;
+}
+
+bool TBWidget::SetSpatialIndexEnabled(bool enable)
+{
+	if (enable == GetSpatialIndexEnabled())
+		return true;
+	if (enable)
+		return GetExtension() && (m_ext->spatial_index = new TBWidgetSpatialIndex) ? true : false;
+	delete m_ext->spatial_index;
+	m_ext->spatial_index = nullptr;
+	return true;
+}
+
+TBWidgetChildIndex *TBWidget::GetChildIndex() const
+{
+	if (!GetExtension())
+		return nullptr;
+	if (!m_ext->child_index)
+		m_ext->child_index = new TBWidgetChildIndex;
+	return m_ext->child_index;
 }
 
 TBWidget *TBWidget::GetChildFromIndex(int index) const
 {
+	TBWidget *child = nullptr;
+	if (m_ext && m_ext->child_index && m_ext->child_index->GetChild(this, index, child))
+		return child;
 	int i = 0;
-	for (TBWidget *child = GetFirstChild(); child; child = child->GetNext())
-		if (i++ == index)
+	for (child = GetFirstChild(); child; child = child->GetNext())
+	{
+		if (i == index)
 			return child;
+		if (++i == CHILD_INDEX_MIN_CHILDREN && !(m_ext && m_ext->child_index) && GetChildIndex())
+			return GetChildFromIndex(index);
+	}
 	return nullptr;
 }
 
 int TBWidget::GetIndexFromChild(TBWidget *child) const
 {
 	assert(child->GetParent() == this);
+	int index;
+	if (m_ext && m_ext->child_index && m_ext->child_index->GetIndex(this, child, index))
+		return index;
 	int i = 0;
-	for (TBWidget *tmp = GetFirstChild(); tmp; tmp = tmp->GetNext(), i++)
+	for (TBWidget *tmp = GetFirstChild(); tmp; tmp = tmp->GetNext())
+	{
 		if (tmp == child)
 			return i;
+		if (++i == CHILD_INDEX_MIN_CHILDREN && !(m_ext && m_ext->child_index) && GetChildIndex())
+			return GetIndexFromChild(child);
+	}
 	return -1; ///< Should not happen!
 }
 
@@ -788,17 +1398,63 @@ TBWindow *TBWidget::GetParentWindow()
 
 void TBWidget::AddListener(TBWidgetListener *listener)
 {
-	m_listeners.AddLast(listener);
+	// FIX: This should return false on OOM.
+	if (GetExtension())
+		m_ext->listeners.AddLast(listener);
 }
 
 void TBWidget::RemoveListener(TBWidgetListener *listener)
 {
-	m_listeners.Remove(listener);
+	if (m_ext)
+		m_ext->listeners.Remove(listener);
 }
 
 bool TBWidget::HasListener(TBWidgetListener *listener) const
 {
-	return m_listeners.ContainsLink(listener);
+	return m_ext && m_ext->listeners.ContainsLink(listener);
+}
+
+TBLinkListOf<TBWidgetListener> &TBWidget::GetListeners() const
+{
+	return m_ext ? m_ext->listeners : s_no_listeners;
+}
+
+void TBWidget::SetGroupID(const TBID &id)
+{
+	if (GetExtension())
+		m_ext->group_id = id;
+}
+
+TBID TBWidget::GetGroupID() const
+{
+	return m_ext ? m_ext->group_id : TBID();
+}
+
+void TBWidget::Connect(TBWidgetValue *value)
+{
+	if (GetExtension())
+		m_ext->connection.Connect(value, this);
+}
+
+void TBWidget::Unconnect()
+{
+	if (m_ext)
+		m_ext->connection.Unconnect();
+}
+
+const LayoutParams *TBWidget::GetLayoutParams() const
+{
+	return m_ext && m_ext->has_layout_params ? &m_ext->layout_params : nullptr;
+}
+
+bool TBWidget::GetIDIndexEnabled() const
+{
+	return m_ext && m_ext->id_index;
+}
+
+bool TBWidget::GetSpatialIndexEnabled() const
+{
+	return m_ext && m_ext->spatial_index;
 }
 
 void TBWidget::OnPaintChildren(const PaintProps &paint_props)
@@ -814,14 +1470,16 @@ void TBWidget::OnPaintChildren(const PaintProps &paint_props)
 	TBRect clip_rect = g_renderer->GetClipRect();
 
 	// Invoke paint on all children that are in the current visible rect.
-	for (TBWidget *child = GetFirstChild(); child; child = child->GetNext())
+	TBChildrenInRect children(this, clip_rect, false);
+	while (TBWidget *child = children.GetNext())
 	{
 		if (clip_rect.Intersects(child->m_rect))
 			child->InvokePaint(paint_props);
 	}
 
 	// Invoke paint of overlay elements on all children that are in the current visible rect.
-	for (TBWidget *child = GetFirstChild(); child; child = child->GetNext())
+	TBChildrenInRect overlay_children(this, clip_rect, false);
+	while (TBWidget *child = overlay_children.GetNext())
 	{
 		if (clip_rect.Intersects(child->m_rect) && child->GetVisibility() == WIDGET_VISIBILITY_VISIBLE)
 		{
@@ -1037,38 +1695,55 @@ PreferredSize TBWidget::OnCalculatePreferredSize(const SizeConstraints &constrai
 PreferredSize TBWidget::GetPreferredSize(const SizeConstraints &in_constraints)
 {
 	SizeConstraints constraints(in_constraints);
-	if (m_layout_params)
-		constraints = constraints.ConstrainByLayoutParams(*m_layout_params);
+	const LayoutParams *layout_params = GetLayoutParams();
+	if (layout_params)
+		constraints = constraints.ConstrainByLayoutParams(*layout_params);
 
-	// Returned cached result if valid and the constraints are the same.
+	// Return a cached result if it's valid for the constraints. The most recent result is
+	// checked first, and then the results for other recent constraints (if any).
 	if (m_packed.is_cached_ps_valid)
 	{
-		if (m_cached_sc == constraints ||
-			m_cached_ps.size_dependency == SIZE_DEP_NONE /*||
-			// FIX: These optimizations would probably be good. Keeping
-			//      disabled for now because it needs testing.
-			// If *only* width depend on height, only the height matter
-			(m_cached_ps.size_dependency == SIZE_DEP_WIDTH_DEPEND_ON_HEIGHT &&
-			m_cached_sc.available_h == constraints.available_h) ||
-			// If *only* height depend on width, only the width matter
-			(m_cached_ps.size_dependency == SIZE_DEP_HEIGHT_DEPEND_ON_WIDTH &&
-			m_cached_sc.available_w == constraints.available_w)*/)
+		if (IsPreferredSizeValidFor(m_cached_ps, m_cached_sc, constraints))
 		{
+			TB_IF_DEBUG_SETTING(LAYOUT_PS_DEBUGGING, g_tb_debug.num_ps_cache_hits++);
 			return m_cached_ps;
 		}
+		TBPreferredSizeCache *cache = m_ext ? m_ext->ps_cache : nullptr;
+		for (int i = 0; cache && i < cache->num_entries; i++)
+			if (IsPreferredSizeValidFor(cache->ps[i], cache->sc[i], constraints))
+			{
+				// Swap with the most recent result.
+				PreferredSize ps = cache->ps[i];
+				SizeConstraints sc = cache->sc[i];
+				cache->Remove(i);
+				cache->Add(m_cached_ps, m_cached_sc);
+				m_cached_ps = ps;
+				m_cached_sc = sc;
+				TB_IF_DEBUG_SETTING(LAYOUT_PS_DEBUGGING, g_tb_debug.num_ps_cache_hits++);
+				return m_cached_ps;
+			}
+
+		// Keep the current result for when the constraints change back.
+		if (!cache && GetExtension())
+			cache = m_ext->ps_cache = new TBPreferredSizeCache;
+		if (cache)
+			cache->Add(m_cached_ps, m_cached_sc);
 	}
+	else if (m_ext && m_ext->ps_cache)
+		m_ext->ps_cache->num_entries = 0;
 
 	// Measure and save to cache
+	TB_IF_DEBUG_SETTING(LAYOUT_PS_DEBUGGING, g_tb_debug.num_ps_cache_misses++);
 	TB_IF_DEBUG_SETTING(LAYOUT_PS_DEBUGGING, last_measure_time = TBSystem::GetTimeMS());
 	m_packed.is_cached_ps_valid = 1;
 	m_cached_ps = OnCalculatePreferredSize(constraints);
 	m_cached_sc = constraints;
 
 	// Override the calculated ps with any specified layout parameter.
-	if (m_layout_params)
+	if (layout_params)
 	{
-		#define LP_OVERRIDE(param)	if (m_layout_params->param != LayoutParams::UNSPECIFIED) \
-										m_cached_ps.param = m_layout_params->param;
+		#define LP_OVERRIDE(param)	if (layout_params->param != LayoutParams::UNSPECIFIED) \
+										m_cached_ps.param = layout_params->param;
 		LP_OVERRIDE(min_w);
 		LP_OVERRIDE(min_h);
 		LP_OVERRIDE(max_w);
@@ -1087,11 +1762,10 @@ PreferredSize TBWidget::GetPreferredSize(const SizeConstraints &in_constraints)
 
 void TBWidget::SetLayoutParams(const LayoutParams &lp)
 {
-	if (!m_layout_params)
-		m_layout_params = new LayoutParams;
-	if (!m_layout_params)
+	if (!GetExtension())
 		return;
-	*m_layout_params = lp;
+	m_ext->layout_params = lp;
+	m_ext->has_layout_params = true;
 	m_packed.is_cached_ps_valid = 0;
 	InvalidateLayout(INVALIDATE_LAYOUT_RECURSIVE);
 }
@@ -1099,8 +1773,15 @@ void TBWidget::SetLayoutParams(const LayoutParams &lp)
 void TBWidget::InvalidateLayout(INVALIDATE_LAYOUT il)
 {
 	m_packed.is_cached_ps_valid = 0;
+	RequestProcess();
 	if (GetVisibility() == WIDGET_VISIBILITY_GONE)
 		return;
+	if (m_ext && m_ext->update_batch)
+	{
+		m_ext->update_batch->invalidate_layout = true;
+		m_ext->update_batch->invalidate_layout_recursive |= il == INVALIDATE_LAYOUT_RECURSIVE;
+		return;
+	}
 	Invalidate();
 	if (il == INVALIDATE_LAYOUT_RECURSIVE && m_parent)
 		m_parent->InvalidateLayout(il);
@@ -1108,42 +1789,150 @@ void TBWidget::InvalidateLayout(INVALIDATE_LAYOUT il)
 
 void TBWidget::InvokeProcess()
 {
-	InvokeSkinUpdatesInternal(false);
+	InvokeSkinUpdatesInternal();
 	InvokeProcessInternal();
 }
 
-void TBWidget::InvokeSkinUpdatesInternal(bool force_update)
+void TBWidget::InvokeSkinUpdatesInternal()
 {
-	if (!update_skin_states && !force_update)
+	const bool update_this = m_packed.skin_states_dirty;
+	const bool update_children = m_packed.skin_states_dirty_children;
+	if (!update_this && !update_children)
 		return;
-	update_skin_states = false;
+	// Clear before updating, so anything marked during the update is found again.
+	m_packed.skin_states_dirty = 0;
+	m_packed.skin_states_dirty_children = 0;
 
 	// Check if the skin we get is different from what we expect. That might happen
 	// if the skin has some strong override dependant a condition that has changed.
 	// If that happens, call OnSkinChanged so the widget can react to that, and
 	// invalidate layout to apply new skin properties.
-	if (TBSkinElement *skin_elm = GetSkinBgElement())
+	if (update_this)
 	{
-		if (skin_elm->id != m_skin_bg_expected)
+		SetSkinDependsOnOthers(g_tb_skin->IsStrongOverrideDependingOnOthers(m_skin_bg));
+		if (TBSkinElement *skin_elm = GetSkinBgElement())
 		{
-			OnSkinChanged();
-			m_skin_bg_expected = skin_elm->id;
-			InvalidateLayout(INVALIDATE_LAYOUT_RECURSIVE);
+			if (skin_elm->id != m_skin_bg_expected)
+			{
+				OnSkinChanged();
+				m_skin_bg_expected = skin_elm->id;
+				InvalidateLayout(INVALIDATE_LAYOUT_RECURSIVE);
+				// Other widgets may have conditions on the skin of this widget.
+				SetSkinDependentsDirty();
+			}
 		}
 	}
 
-	for (TBWidget *child = GetFirstChild(); child; child = child->GetNext())
-		child->InvokeSkinUpdatesInternal(true);
+	if (update_children)
+		for (TBWidget *child = GetFirstChild(); child; child = child->GetNext())
+			child->InvokeSkinUpdatesInternal();
+}
+
+void TBWidget::BeginUpdate()
+{
+	if (m_ext && m_ext->update_batch)
+	{
+		m_ext->update_batch->update_count++;
+		return;
+	}
+	if (!GetExtension())
+		return;
+	TBWidgetUpdateBatch *batch = new TBWidgetUpdateBatch;
+	if (!batch)
+		return;
+	if (!s_update_batches.Add(batch))
+	{
+		delete batch;
+		return;
+	}
+	m_ext->update_batch = batch;
+}
+
+void TBWidget::EndUpdate()
+{
+	TBWidgetUpdateBatch *batch = m_ext ? m_ext->update_batch : nullptr;
+	if (!batch || --batch->update_count > 0)
+		return;
+
+	// Notify listeners about added children, or leave that to the batch of an ancestor
+	// if there is one. The batch is still active while doing so, so any changes made by
+	// listeners are included.
+	TBWidgetUpdateBatch *outer_batch = m_parent ? m_parent->GetUpdateBatch() : nullptr;
+	for (int i = 0; i < batch->added.GetNumItems(); i++)
+		if (TBWidget *child = batch->added[i])
+		{
+			batch->added.Set(nullptr, i);
+			if (outer_batch && outer_batch->added.Add(child))
+				continue;
+			child->m_packed.is_pending_added = 0;
+			TBWidgetListener::InvokeWidgetAdded(child->m_parent, child);
+		}
+
+	m_ext->update_batch = nullptr;
+	s_update_batches.RemoveFast(s_update_batches.Find(batch));
+
+	if (batch->invalidate_layout)
+		InvalidateLayout(batch->invalidate_layout_recursive ? INVALIDATE_LAYOUT_RECURSIVE : INVALIDATE_LAYOUT_TARGET_ONLY);
+	else if (batch->invalidate)
+		Invalidate();
+	if (batch->invalidate_skin_states)
+		InvalidateSkinStates();
+	delete batch;
+}
+
+bool TBWidget::GetIsUpdating() const
+{
+	return m_ext && m_ext->update_batch;
+}
+
+TBWidgetUpdateBatch *TBWidget::GetUpdateBatch() const
+{
+	if (!s_update_batches.GetNumItems())
+		return nullptr;
+	for (const TBWidget *tmp = this; tmp; tmp = tmp->m_parent)
+		if (tmp->m_ext && tmp->m_ext->update_batch)
+			return tmp->m_ext->update_batch;
+	return nullptr;
+}
+
+void TBWidget::RequestProcess()
+{
+	m_packed.process_requested = 1;
+	// Mark the path to the root, so InvokeProcess can find this widget. If a parent is
+	// already marked, so are all its parents.
+	for (TBWidget *tmp = m_parent; tmp && !tmp->m_packed.process_requested_children; tmp = tmp->m_parent)
+		tmp->m_packed.process_requested_children = 1;
+}
+
+void TBWidget::SetWantProcessAlways(bool want_process_always)
+{
+	m_packed.want_process_always = want_process_always;
+	if (want_process_always)
+		RequestProcess();
 }
 
 void TBWidget::InvokeProcessInternal()
 {
-	OnProcess();
+	// Clear before processing, so anything requested during processing is found again.
+	const bool process_this = m_packed.process_requested;
+	m_packed.process_requested = 0;
+	if (process_this)
+		OnProcess();
 
-	for (TBWidget *child = GetFirstChild(); child; child = child->GetNext())
-		child->InvokeProcessInternal();
+	if (m_packed.process_requested_children)
+	{
+		m_packed.process_requested_children = 0;
+		for (TBWidget *child = GetFirstChild(); child; child = child->GetNext())
+			if (child->m_packed.process_requested || child->m_packed.process_requested_children)
+				child->InvokeProcessInternal();
+	}
 
-	OnProcessAfterChildren();
+	if (process_this)
+	{
+		OnProcessAfterChildren();
+		if (m_packed.want_process_always)
+			RequestProcess();
+	}
 }
 
 void TBWidget::InvokeProcessStates(bool force_update)
@@ -1256,7 +2045,8 @@ bool TBWidget::InvokeEvent(TBWidgetEvent &ev)
 	if (ev.type == EVENT_TYPE_CHANGED)
 	{
 		InvalidateSkinStates();
-		m_connection.SyncFromWidget(this);
+		if (m_ext)
+			m_ext->connection.SyncFromWidget(this);
 	}
 
 	if (!this_widget.Get())
@@ -1286,15 +2076,16 @@ bool TBWidget::InvokeEvent(TBWidgetEvent &ev)
 void TBWidget::StartLongClickTimer(bool touch)
 {
 	StopLongClickTimer();
-	m_long_click_timer = new TBLongClickTimer(this, touch);
+	if (GetExtension())
+		m_ext->long_click_timer = new TBLongClickTimer(this, touch);
 }
 
 void TBWidget::StopLongClickTimer()
 {
-	if (!m_long_click_timer)
+	if (!m_ext || !m_ext->long_click_timer)
 		return;
-	delete m_long_click_timer;
-	m_long_click_timer = nullptr;
+	delete m_ext->long_click_timer;
+	m_ext->long_click_timer = nullptr;
 }
 
 bool TBWidget::InvokePointerDown(int x, int y, int click_count, MODIFIER_KEYS modifierkeys, bool touch)
@@ -1324,12 +2115,13 @@ bool TBWidget::InvokePointerDown(int x, int y, int click_count, MODIFIER_KEYS mo
 		TBWidget *tmp = captured_widget;
 		while (tmp)
 		{
-			if (tmp->m_scroller && tmp->m_scroller->IsStarted())
+			if (tmp->m_ext && tmp->m_ext->scroller && tmp->m_ext->scroller->IsStarted())
 			{
 				// When we touch down to stop a scroller, we don't
 				// want the touch to end up causing a click.
 				cancel_click = true;
-				tmp->m_scroller->Stop();
+				captured_widget->InvalidateSkinStates();
+				tmp->m_ext->scroller->Stop();
 				break;
 			}
 			tmp = tmp->GetParent();
@@ -1399,7 +2191,11 @@ void TBWidget::MaybeInvokeLongClickOrContextMenu(bool touch)
 		}
 		// If any event was handled, suppress click when releasing pointer.
 		if (handled)
+		{
 			cancel_click = true;
+			if (captured_widget)
+				captured_widget->InvalidateSkinStates();
+		}
 	}
 }
 
@@ -1467,6 +2263,7 @@ void TBWidget::HandlePanningOnMove(int x, int y)
 			// Scroll delta changed, so we are now panning!
 			captured_widget->m_packed.is_panning = true;
 			cancel_click = true;
+			captured_widget->InvalidateSkinStates();
 
 			// If the captured widget (or its scroll root) has panned, we have to compensate the
 			// pointer down coordinates so we won't accumulate the difference the following pan.
@@ -1787,6 +2584,7 @@ bool TBWidget::SetFontDescription(const TBFontDescription &font_desc)
 
 void TBWidget::InvokeFontChanged()
 {
+	m_font_generation = 0;
 	OnFontChanged();
 
 	// Recurse to children that inherit the font
@@ -1809,7 +2607,21 @@ TBFontDescription TBWidget::GetCalculatedFontDescription() const
 
 TBFontFace *TBWidget::GetFont() const
 {
-	return g_font_manager->GetFontFace(GetCalculatedFontDescription());
+	const uint32 generation = g_font_manager->GetFaceGeneration();
+	if (m_font_generation != generation)
+	{
+		m_font = g_font_manager->GetFontFace(GetCalculatedFontDescription());
+		m_font_generation = generation;
+	}
+	return m_font;
+}
+
+void TBWidget::InvalidateFontRecursive()
+{
+	m_font_generation = 0;
+	for (TBWidget *child = GetFirstChild(); child; child = child->GetNext())
+		if (child->m_font_desc.GetFontFaceID() == 0)
+			child->InvalidateFontRecursive();
 }
 
 } // namespace tb
@@ -22,6 +22,11 @@ class TBFontFace;
 class TBScroller;
 class TBWidgetListener;
 class TBLongClickTimer;
+class TBWidgetIDIndex;
+class TBWidgetSpatialIndex;
+class TBWidgetChildIndex;
+class TBWidgetUpdateBatch;
+class TBWidgetExtension;
 struct INFLATE_INFO;
 
 // == Generic widget stuff =================================================
@@ -366,6 +371,11 @@ public:
 	TBWidget();
 	virtual ~TBWidget();
 
+	/** Widgets are allocated from the current TBWidgetArena if there is one,
+		and from the heap otherwise. */
+	static void *operator new(size_t size) throw();
+	static void operator delete(void *p);
+
 	/** Set the rect for this widget in its parent. The rect is relative to the parent widget.
 		The skin may expand outside this rect to draw f.ex shadows. */
 	void SetRect(const TBRect &rect);
@@ -391,9 +401,17 @@ public:
 
 	/** Call if something changes that might cause any skin to change due to different state
 		or conditions. This is called automatically from InvalidateStates(), when event
-		EVENT_TYPE_CHANGED is invoked, and in various other situations. */
+		EVENT_TYPE_CHANGED is invoked, and in various other situations.
+
+		This marks this widget for a skin update, and any widgets with skin conditions that
+		depend on other widgets (f.ex their parent, siblings or hover). Only marked widgets
+		are updated during InvokeProcess(). */
 	void InvalidateSkinStates();
 
+	/** Like InvalidateSkinStates, but only marks this widget for a skin update. This can be
+		used if the change can't affect the skin conditions of any other widget. */
+	void InvalidateSkinStatesLocal();
+
 	/** Delete the widget with the possibility for some extended life during animations.
 
 		If any widget listener responds true to OnWidgetDying it will be kept as a child and live
@@ -415,16 +433,25 @@ public:
 	/** Set the group id reference for this widgets. This id is 0 by default.
 		All widgets with the same group id under the same group root will
 		be automatically changed when one change its value. */
-	void SetGroupID(const TBID &id) { m_group_id = id; }
-	TBID &GetGroupID() { return m_group_id; }
+	void SetGroupID(const TBID &id);
+	TBID GetGroupID() const;
 
-	/** Get this widget or any child widget with a matching id, or nullptr if none is found. */
+	/** Get this widget or any child widget with a matching id, or nullptr if none is found.
+		If several widgets match, the first one in tree order is returned. */
 	TBWidget *GetWidgetByID(const TBID &id) { return GetWidgetByIDInternal(id); }
 
 	/** Get this widget or any child widget with a matching id and type, or nullptr if none is found. */
 	template<class T> T *GetWidgetByIDAndType(const TBID &id)
 		{ return (T*) GetWidgetByIDInternal(id, GetTypeId<T>()); }
 
+	/** Enable or disable a index of the ids of all widgets in this widget and its children.
+		The index is kept up to date by AddChild, RemoveChild and SetID, so GetWidgetByID (and
+		GetTextByID etc.) on this widget or any of its children doesn't have to search the tree.
+		This is useful on the root widget (or windows) if there are many widgets.
+		Returns false on OOM. */
+	bool SetIDIndexEnabled(bool enable);
+	bool GetIDIndexEnabled() const;
+
 	/** Enable or disable the given state(s). The state affects which skin state is used when drawing.
 		Some states are set automatically on interaction. See GetAutoState(). */
 	void SetState(WIDGET_STATE state, bool on);
@@ -522,7 +549,10 @@ public:
 	/** Return the current skin background, as set by SetSkinBg. */
 	TBID GetSkinBg() const { return m_skin_bg; }
 
-	/** Return the skin background element, or nullptr. */
+	/** Return the skin background element, or nullptr.
+		The element is cached until InvalidateSkinStates is called on this widget
+		(directly or as a dependent of another widget), or the skin is loaded.
+		If the strong overrides of the skin have conditions on the value, it's not cached. */
 	TBSkinElement *GetSkinBgElement();
 
 	/** Set if this widget is a group root. Grouped widgets (such as TBRadioButton) will toggle all other
@@ -534,6 +564,32 @@ public:
 	void SetIsFocusable(bool focusable) { m_packed.is_focusable = focusable; }
 	bool GetIsFocusable() const { return m_packed.is_focusable; }
 
+	/** Request OnProcess and OnProcessAfterChildren to be called on this widget during
+		the next InvokeProcess. This is called automatically by InvalidateLayout.
+		Widgets that have pending work to do in OnProcess should call this. */
+	void RequestProcess();
+
+	/** Begin a batch of changes to this subtree (such as adding many children).
+		Until the matching EndUpdate, InvalidateLayout and Invalidate on this widget or
+		any widget in its subtree will only be recorded, and TBWidgetListener::OnWidgetAdded
+		is delayed for children added in the subtree. EndUpdate then invalidates this
+		widget once, and notifies the listeners in the order the children were added.
+
+		Calls may be nested. See also TBWidgetUpdateBlocker. */
+	void BeginUpdate();
+
+	/** End a batch of changes started by BeginUpdate. */
+	void EndUpdate();
+
+	/** Return true if BeginUpdate has been called on this widget without EndUpdate. */
+	bool GetIsUpdating() const;
+
+	/** Set if OnProcess and OnProcessAfterChildren should be called during every
+		InvokeProcess, even if RequestProcess hasn't been called. This can be used by
+		widgets that poll something, and is more expensive than using RequestProcess. */
+	void SetWantProcessAlways(bool want_process_always);
+	bool GetWantProcessAlways() const { return m_packed.want_process_always; }
+
 	/** Set if this widget should emulate a click when it's focused and pressing enter or space. */
 	void SetClickByKey(bool click_by_key) { m_packed.click_by_key = click_by_key; }
 	bool GetClickByKey() const { return m_packed.click_by_key; }
@@ -576,14 +632,33 @@ public:
 		is true, the search will recurse into the childrens children. */
 	TBWidget *GetWidgetAt(int x, int y, bool include_children) const;
 
+	/** Get the children that may intersect the given rect (relative to the children, so child
+		translation is already applied), bottom to top in z order. This is used to skip children
+		that are not visible when painting, and for hit testing.
+
+		Returns the number of children in the array returned in children. The array is valid until
+		the children change. Returns -1 if all children should be checked (the default, unless a
+		spatial index is enabled).
+
+		Widgets that know where their children are can override this. */
+	virtual int GetChildrenInRect(const TBRect &rect, TBWidget **&children) const;
+
+	/** Enable or disable a spatial index of the children of this widget, so hit testing and
+		painting is fast even if there are thousands of children (not in a layout).
+		The index is rebuilt when needed after children are added, removed or change rect.
+		Children must not have a hit area (See GetHitStatus) outside of their rect.
+		Returns false on OOM. */
+	bool SetSpatialIndexEnabled(bool enable);
+	bool GetSpatialIndexEnabled() const;
+
 	/** Get the child at the given index, or nullptr if there was no child at that index.
-		Note: Avoid calling this in loops since it does iteration. Consider iterating
-		the widgets directly instead! */
+		Widgets with many children build an index of them the first time this is needed,
+		making this constant time until children are added, removed or reordered.
+		Consider iterating the widgets directly when changing children in a loop! */
 	TBWidget *GetChildFromIndex(int index) const;
 
 	/** Get the child index of the given widget (that must be a child of this widget).
-		Note: Avoid calling this in loops since it does iteration. Consider iterating
-		the widgets directly instead! */
+		See GetChildFromIndex about performance. */
 	int GetIndexFromChild(TBWidget *child) const;
 
 	/** Get the text of a child widget with the given id, or an empty string if there was
@@ -623,7 +698,9 @@ public:
 	virtual bool OnEvent(const TBWidgetEvent &ev) { return false; }
 
 	/** Callback for doing anything that might be needed before paint.
-		F.ex Updating invalid layout, formatting text etc. */
+		F.ex Updating invalid layout, formatting text etc.
+		This is only called if RequestProcess has been called since the last time, or
+		if SetWantProcessAlways is set. */
 	virtual void OnProcess() {}
 
 	/** Callback for doing anything that might be needed before paint.
@@ -689,6 +766,9 @@ public:
 	/** Called when a child widget is about to be removed from this widget (before calling OnRemove on child). */
 	virtual void OnChildRemove(TBWidget *child) {}
 
+	/** Called when the rect of a child widget has changed (after calling OnResized on child). */
+	virtual void OnChildRectChanged(TBWidget *child) {}
+
 	/** Called when this widget has been added to a parent (after calling OnChildAdded on parent). */
 	virtual void OnAdded() {}
 
@@ -725,7 +805,8 @@ public:
 
 	/** Get if skin condition applies to this widget. This is called when a skin condition has the property
 		PROPERTY_CUSTOM (not a generic one known by skin and the default widget condition context).
-		This can be used to extend the skin conditions support with properties specific to different widgets. */
+		This can be used to extend the skin conditions support with properties specific to different widgets.
+		Call InvalidateSkinStates when the result may have changed. */
 	virtual bool GetCustomSkinCondition(const TBSkinCondition::CONDITION_INFO &info) { return false; }
 
 	/** Get this widget or a child widget that should be root for other children. This is useful
@@ -849,10 +930,10 @@ public:
 
 		On connection, the value of this widget will be updated to the value of the
 		given TBWidgetValue. */
-	void Connect(TBWidgetValue *value) { m_connection.Connect(value, this); }
+	void Connect(TBWidgetValue *value);
 
 	/** Unconnect, if this widget is connected to a TBWidgetValue. */
-	void Unconnect() { m_connection.Unconnect(); }
+	void Unconnect();
 
 	/** Get the rectangle inside any padding, relative to this widget. This is the
 		rectangle in which the content should be rendered.
@@ -872,7 +953,10 @@ public:
 	virtual PreferredSize OnCalculatePreferredSize(const SizeConstraints &constraints);
 
 	/** Get the PreferredSize for this widget.
-		This returns cached data if valid, or calls OnCalculatePreferredSize if needed. */
+		This returns cached data if valid, or calls OnCalculatePreferredSize if needed.
+		The results for a few recent constraints are cached. A result is valid for other
+		constraints as long as those it depends on (See PreferredSize::size_dependency)
+		are the same. */
 	PreferredSize GetPreferredSize(const SizeConstraints &constraints);
 	PreferredSize GetPreferredSize() { return GetPreferredSize(SizeConstraints()); }
 
@@ -901,11 +985,12 @@ public:
 	/** Get layout params, or nullptr if not specified.
 		Note: The layout params has already been applied to the PreferredSize returned
 		from GetPreferredSize so you normally don't need to check these params. */
-	const LayoutParams *GetLayoutParams() const { return m_layout_params; }
+	const LayoutParams *GetLayoutParams() const;
 
 	// == Misc methods for invoking events. Should normally be called only on the root widget ===============
 
-	/** Invoke OnProcess and OnProcessAfterChildren on this widget and its children. */
+	/** Invoke OnProcess and OnProcessAfterChildren on this widget and its children,
+		if they have requested it (See RequestProcess). */
 	void InvokeProcess();
 
 	/** Invoke OnProcessStates on all child widgets, if state processing
@@ -986,46 +1071,55 @@ public:
 	TBFontDescription GetCalculatedFontDescription() const;
 
 	/** Get the TBFontFace for this widget from the current font description (calculated
-		by GetCalculatedFontDescription) */
+		by GetCalculatedFontDescription). The font face is cached until the font of this
+		widget or any parent changes, the widget is moved to another parent, or a font
+		face is created. */
 	TBFontFace *GetFont() const;
 
 private:
-	friend class TBWidgetListener;	///< It does iteration of m_listeners for us.
+	friend class TBWidgetListener;	///< It does iteration of GetListeners for us.
 	TBWidget *m_parent;				///< The parent of this widget
 	TBRect m_rect;					///< The rectangle of this widget, relative to the parent. See SetRect.
 	TBID m_id;						///< ID for GetWidgetByID and others.
-	TBID m_group_id;				///< ID for button groups (such as TBRadioButton)
 	TBID m_skin_bg;					///< ID for the background skin (0 for no skin).
 	TBID m_skin_bg_expected;		///< ID for the background skin after strong override,
 									///< used to indirect skin changes because of condition changes.
+	TBSkinElement *m_skin_bg_element;	///< Cached result of GetSkinBgElement.
+	uint32 m_skin_bg_element_generation;///< Skin state generation of m_skin_bg_element, or 0 if invalid.
 	TBLinkListOf<TBWidget> m_children;///< List of child widgets
-	TBWidgetValueConnection m_connection; ///< TBWidget value connection
-	TBLinkListOf<TBWidgetListener> m_listeners;	///< List of listeners
 	float m_opacity;				///< Opacity 0-1. See SetOpacity.
 	WIDGET_STATE m_state;			///< The widget state (excluding any auto states)
 	WIDGET_GRAVITY m_gravity;		///< The layout gravity setting.
 	TBFontDescription m_font_desc;	///< The font description.
-	PreferredSize m_cached_ps;		///< Cached preferred size.
-	SizeConstraints m_cached_sc;	///< Cached size constraints.
-	LayoutParams *m_layout_params;	///< Layout params, or nullptr.
-	TBScroller *m_scroller;
-	TBLongClickTimer *m_long_click_timer;
+	mutable TBFontFace *m_font;		///< Cached result of GetFont.
+	mutable uint32 m_font_generation;///< Font face generation of m_font, or 0 if invalid.
+	PreferredSize m_cached_ps;		///< Cached preferred size (the most recent).
+	SizeConstraints m_cached_sc;	///< Cached size constraints (the most recent).
+	mutable TBWidgetExtension *m_ext;	///< Rarely used fields, or nullptr. See GetExtension.
 	union {
 		struct {
-			uint16 is_group_root : 1;
-			uint16 is_focusable : 1;
-			uint16 click_by_key : 1;
-			uint16 has_key_pressed_state : 1;
-			uint16 ignore_input : 1;
-			uint16 is_dying : 1;
-			uint16 is_cached_ps_valid : 1;
-			uint16 no_automatic_hover_state : 1;
-			uint16 is_panning : 1;
-			uint16 want_long_click : 1;
-			uint16 visibility : 2;
-			uint16 inflate_child_z : 1; // Should have enough bits to hold WIDGET_Z values.
+			uint32 is_group_root : 1;
+			uint32 is_focusable : 1;
+			uint32 click_by_key : 1;
+			uint32 has_key_pressed_state : 1;
+			uint32 ignore_input : 1;
+			uint32 is_dying : 1;
+			uint32 is_cached_ps_valid : 1;
+			uint32 no_automatic_hover_state : 1;
+			uint32 is_panning : 1;
+			uint32 want_long_click : 1;
+			uint32 visibility : 2;
+			uint32 inflate_child_z : 1; // Should have enough bits to hold WIDGET_Z values.
+			uint32 skin_states_dirty : 1;			///< The skin of this widget should be updated.
+			uint32 skin_states_dirty_children : 1;	///< Some widget in the subtree should be updated.
+			uint32 skin_depends_on_others : 1;		///< This widget is in the list of skin dependents.
+			uint32 skin_bg_element_uncacheable : 1;	///< GetSkinBgElement can't use m_skin_bg_element.
+			uint32 process_requested : 1;			///< OnProcess should be called on this widget.
+			uint32 process_requested_children : 1;	///< Some widget in the subtree requested processing.
+			uint32 want_process_always : 1;			///< See SetWantProcessAlways.
+			uint32 is_pending_added : 1;			///< Added during BeginUpdate, and listeners not notified yet.
 		} m_packed;
-		uint16 m_packed_init;
+		uint32 m_packed_init;
 	};
 public:
 	/** This value is free to use for anything. It's not used by TBWidget itself. Initially TYPE_NULL. */
@@ -1047,7 +1141,6 @@ public:
 	static int pointer_move_widget_y;	///< Pointer y position on last pointer event, relative to the captured widget (if any) or hovered widget.
 	static bool cancel_click;			///< true if the pointer up event should not generate a click event.
 	static bool update_widget_states;	///< true if something has called InvalidateStates() and it still hasn't been updated.
-	static bool update_skin_states;		///< true if something has called InvalidateStates() and skin still hasn't been updated.
 	static bool show_focus_state;		///< true if the focused state should be painted automatically.
 	struct TOUCH_INFO {
 		TBWidget *hovered_widget;		///< The currently hovered widget, or nullptr.
@@ -1066,8 +1159,16 @@ private:
 	TBScroller *FindStartedScroller();
 	TBScroller *GetReadyScroller(bool scroll_x, bool scroll_y);
 	TBWidget *GetWidgetByIDInternal(const TBID &id, const TB_TYPE_ID type_id = nullptr);
-	void InvokeSkinUpdatesInternal(bool force_update);
+	TBWidget *GetWidgetByIDSearch(const TBID &id, const TB_TYPE_ID type_id);
+	void SetSkinDependsOnOthers(bool depends);
+	void InvokeSkinUpdatesInternal();
 	void InvokeProcessInternal();
+	void InvalidateFontRecursive();
+	TBWidgetUpdateBatch *GetUpdateBatch() const;
+	TBWidgetChildIndex *GetChildIndex() const;
+	/** Get the extension with rarely used fields, creating it if needed. Returns nullptr on OOM. */
+	TBWidgetExtension *GetExtension() const;
+	TBLinkListOf<TBWidgetListener> &GetListeners() const;
 	static void SetHoveredWidget(TBWidget *widget, bool touch);
 	static void SetCapturedWidget(TBWidget *widget);
 	void HandlePanningOnMove(int x, int y);
@@ -1079,6 +1180,16 @@ private:
 	float CalculateOpacityInternal(WIDGET_STATE state, TBSkinElement *skin_element) const;
 };
 
+/** TBWidgetUpdateBlocker calls TBWidget::BeginUpdate on a widget during its lifetime. */
+class TBWidgetUpdateBlocker
+{
+public:
+	TBWidgetUpdateBlocker(TBWidget *widget) : m_widget(widget) { m_widget->BeginUpdate(); }
+	~TBWidgetUpdateBlocker() { m_widget->EndUpdate(); }
+private:
+	TBWidget *m_widget;
+};
+
 } // namespace tb
 
 #endif // TB_WIDGETS_H
@@ -15,56 +15,54 @@ namespace tb {
 
 TBWidgetString::TBWidgetString()
 	: m_text_align(TB_TEXT_ALIGN_CENTER)
-	, m_width(0)
 	, m_height(0)
 {
 }
 
-void TBWidgetString::ValidatCachedSize(TBWidget *widget)
+TBFontFace *TBWidgetString::ValidateLayout(TBWidget *widget)
 {
-	const TBFontDescription fd = widget->GetCalculatedFontDescription();
-	if (!m_height || fd != m_fd)
+	TBFontFace *font = widget->GetFont();
+	if (m_layout.GetFont() != font)
 	{
-		m_fd = fd;
-		TBFontFace *font = g_font_manager->GetFontFace(fd);
-		m_width = font->GetStringWidth(m_text);
+		font->LayoutString(m_layout, m_text);
 		m_height = font->GetHeight();
 	}
+	return font;
 }
 
 int TBWidgetString::GetWidth(TBWidget *widget)
 {
-	ValidatCachedSize(widget);
-	return m_width;
+	ValidateLayout(widget);
+	return m_layout.GetWidth();
 }
 
 int TBWidgetString::GetHeight(TBWidget *widget)
 {
-	ValidatCachedSize(widget);
+	ValidateLayout(widget);
 	return m_height;
 }
 
 bool TBWidgetString::SetText(const char *text)
 {
 	// Invalidate cache
-	m_height = 0;
+	m_layout.Reset();
 	return m_text.Set(text);
 }
 
 void TBWidgetString::Paint(TBWidget *widget, const TBRect &rect, const TBColor &color)
 {
-	ValidatCachedSize(widget);
-	TBFontFace *font = widget->GetFont();
+	TBFontFace *font = ValidateLayout(widget);
+	const int width = m_layout.GetWidth();
 
 	int x = rect.x;
 	if (m_text_align == TB_TEXT_ALIGN_RIGHT)
-		x += rect.w - m_width;
+		x += rect.w - width;
 	else if (m_text_align == TB_TEXT_ALIGN_CENTER)
-		x += MAX(0, (rect.w - m_width) / 2);
+		x += MAX(0, (rect.w - width) / 2);
 	int y = rect.y + (rect.h - m_height) / 2;
 
-	if (m_width <= rect.w)
-		font->DrawString(x, y, color, m_text);
+	if (width <= rect.w)
+		font->DrawLayout(x, y, color, m_layout);
 	else
 	{
 		// There's not enough room for the entire string
@@ -75,19 +73,11 @@ void TBWidgetString::Paint(TBWidget *widget, const TBRect &rect, const TBColor &
 		const char *end = "...";
 
 		int endw = font->GetStringWidth(end);
-		int startw = 0;
-		int startlen = 0;
-		while (m_text.CStr()[startlen])
-		{
-			int new_startw = font->GetStringWidth(m_text, startlen);
-			if (new_startw + endw > rect.w)
-				break;
-			startw = new_startw;
-			startlen++;
-		}
-		startlen = MAX(0, startlen - 1);
-		font->DrawString(x, y, color, m_text, startlen);
-		font->DrawString(x + startw, y, color, end);
+		int num_glyphs = 0;
+		while (num_glyphs < m_layout.GetNumGlyphs() && m_layout.GetGlyphX(num_glyphs + 1) + endw <= rect.w)
+			num_glyphs++;
+		font->DrawLayout(x, y, color, m_layout, num_glyphs);
+		font->DrawString(x + m_layout.GetGlyphX(num_glyphs), y, color, end);
 	}
 }
 
@@ -9,6 +9,7 @@
 #include "tb_widgets.h"
 #include "tb_layout.h"
 #include "tb_msg.h"
+#include "tb_font_renderer.h"
 
 namespace tb {
 
@@ -19,7 +20,9 @@ enum TB_TEXT_ALIGN {
 	TB_TEXT_ALIGN_CENTER	///< Aligned center
 };
 
-/** TBWidgetString holds a string that can be painted as one line with the set alignment. */
+/** TBWidgetString holds a string that can be painted as one line with the set alignment.
+	The string is laid out once (see TBFontStringLayout) and the layout is reused for
+	measuring and painting until the text or font changes. */
 class TBWidgetString
 {
 public:
@@ -44,9 +47,9 @@ private:
 	TBStr m_text;
 	TB_TEXT_ALIGN m_text_align;
 	// Cached data
-	int m_width, m_height;
-	TBFontDescription m_fd;
-	void ValidatCachedSize(TBWidget *widget);
+	int m_height;
+	TBFontStringLayout m_layout;
+	TBFontFace *ValidateLayout(TBWidget *widget);
 };
 
 /** TBTextField is a one line text field that is not editable. */
@@ -100,7 +103,7 @@ public:
 	~TBButton();
 
 	/** Set along which axis the content should layouted (If the button has more content than the text) */
-	virtual void SetAxis(AXIS axis) { m_layout.SetAxis(axis); }
+	virtual void SetAxis(AXIS axis) { m_layout.SetAxis(axis); InvalidateSkinStates(); }
 	virtual AXIS GetAxis() const { return m_layout.GetAxis(); }
 
 	/** Set if the text field should be allowed to squeeze below its
@@ -164,7 +167,7 @@ public:
 	~TBClickLabel();
 
 	/** Set along which axis the content should layouted (If the label has more content than the text) */
-	virtual void SetAxis(AXIS axis) { m_layout.SetAxis(axis); }
+	virtual void SetAxis(AXIS axis) { m_layout.SetAxis(axis); InvalidateSkinStates(); }
 	virtual AXIS GetAxis() const { return m_layout.GetAxis(); }
 
 	/** Set the text of the label. */
@@ -24,7 +24,7 @@ void TBWidgetListener::RemoveGlobalListener(TBWidgetListener *listener)
 void TBWidgetListener::InvokeWidgetDelete(TBWidget *widget)
 {
 	TBLinkListOf<TBWidgetListenerGlobalLink>::Iterator global_i = g_listeners.IterateForward();
-	TBLinkListOf<TBWidgetListener>::Iterator local_i = widget->m_listeners.IterateForward();
+	TBLinkListOf<TBWidgetListener>::Iterator local_i = widget->GetListeners().IterateForward();
 	while (TBWidgetListener *listener = local_i.GetAndStep())
 		listener->OnWidgetDelete(widget);
 	while (TBWidgetListenerGlobalLink *link = global_i.GetAndStep())
@@ -35,7 +35,7 @@ bool TBWidgetListener::InvokeWidgetDying(TBWidget *widget)
 {
 	bool handled = false;
 	TBLinkListOf<TBWidgetListenerGlobalLink>::Iterator global_i = g_listeners.IterateForward();
-	TBLinkListOf<TBWidgetListener>::Iterator local_i = widget->m_listeners.IterateForward();
+	TBLinkListOf<TBWidgetListener>::Iterator local_i = widget->GetListeners().IterateForward();
 	while (TBWidgetListener *listener = local_i.GetAndStep())
 		handled |= listener->OnWidgetDying(widget);
 	while (TBWidgetListenerGlobalLink *link = global_i.GetAndStep())
@@ -46,7 +46,7 @@ bool TBWidgetListener::InvokeWidgetDying(TBWidget *widget)
 void TBWidgetListener::InvokeWidgetAdded(TBWidget *parent, TBWidget *child)
 {
 	TBLinkListOf<TBWidgetListenerGlobalLink>::Iterator global_i = g_listeners.IterateForward();
-	TBLinkListOf<TBWidgetListener>::Iterator local_i = parent->m_listeners.IterateForward();
+	TBLinkListOf<TBWidgetListener>::Iterator local_i = parent->GetListeners().IterateForward();
 	while (TBWidgetListener *listener = local_i.GetAndStep())
 		listener->OnWidgetAdded(parent, child);
 	while (TBWidgetListenerGlobalLink *link = global_i.GetAndStep())
@@ -56,7 +56,7 @@ void TBWidgetListener::InvokeWidgetAdded(TBWidget *parent, TBWidget *child)
 void TBWidgetListener::InvokeWidgetRemove(TBWidget *parent, TBWidget *child)
 {
 	TBLinkListOf<TBWidgetListenerGlobalLink>::Iterator global_i = g_listeners.IterateForward();
-	TBLinkListOf<TBWidgetListener>::Iterator local_i = parent->m_listeners.IterateForward();
+	TBLinkListOf<TBWidgetListener>::Iterator local_i = parent->GetListeners().IterateForward();
 	while (TBWidgetListener *listener = local_i.GetAndStep())
 		listener->OnWidgetRemove(parent, child);
 	while (TBWidgetListenerGlobalLink *link = global_i.GetAndStep())
@@ -66,7 +66,7 @@ void TBWidgetListener::InvokeWidgetRemove(TBWidget *parent, TBWidget *child)
 void TBWidgetListener::InvokeWidgetFocusChanged(TBWidget *widget, bool focused)
 {
 	TBLinkListOf<TBWidgetListenerGlobalLink>::Iterator global_i = g_listeners.IterateForward();
-	TBLinkListOf<TBWidgetListener>::Iterator local_i = widget->m_listeners.IterateForward();
+	TBLinkListOf<TBWidgetListener>::Iterator local_i = widget->GetListeners().IterateForward();
 	while (TBWidgetListener *listener = local_i.GetAndStep())
 		listener->OnWidgetFocusChanged(widget, focused);
 	while (TBWidgetListenerGlobalLink *link = global_i.GetAndStep())
@@ -77,7 +77,7 @@ bool TBWidgetListener::InvokeWidgetInvokeEvent(TBWidget *widget, const TBWidgetE
 {
 	bool handled = false;
 	TBLinkListOf<TBWidgetListenerGlobalLink>::Iterator global_i = g_listeners.IterateForward();
-	TBLinkListOf<TBWidgetListener>::Iterator local_i = widget->m_listeners.IterateForward();
+	TBLinkListOf<TBWidgetListener>::Iterator local_i = widget->GetListeners().IterateForward();
 	while (TBWidgetListener *listener = local_i.GetAndStep())
 		handled |= listener->OnWidgetInvokeEvent(widget, ev);
 	while (TBWidgetListenerGlobalLink *link = global_i.GetAndStep())
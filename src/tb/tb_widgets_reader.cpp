@@ -8,11 +8,15 @@
 #include "tb_scroll_container.h"
 #include "tb_tab_container.h"
 #include "tb_select.h"
+#include "tb_table_view.h"
+#include "tb_tree_view.h"
 #include "tb_inline_select.h"
 #include "tb_editfield.h"
 #include "tb_node_tree.h"
 #include "tb_font_renderer.h"
 #include "tb_toggle_container.h"
+#include "tb_window.h"
+#include "tb_widget_arena.h"
 #include "image/tb_image_widget.h"
 
 namespace tb {
@@ -22,7 +26,12 @@ void TBWidget::OnInflate(const INFLATE_INFO &info)
 {
 	TBWidgetsReader::SetIDFromNode(GetID(), info.node->GetNode("id"));
 
-	TBWidgetsReader::SetIDFromNode(GetGroupID(), info.node->GetNode("group-id"));
+	if (TBNode *group_id_node = info.node->GetNode("group-id"))
+	{
+		TBID group_id;
+		TBWidgetsReader::SetIDFromNode(group_id, group_id_node);
+		SetGroupID(group_id);
+	}
 
 	if (info.sync_type == TBValue::TYPE_FLOAT)
 		SetValueDouble(info.node->GetValueFloat("value", 0));
@@ -370,6 +379,10 @@ void TBSelectDropdown::OnInflate(const INFLATE_INFO &info)
 	TBWidget::OnInflate(info);
 }
 
+TB_WIDGET_FACTORY(TBTableView, TBValue::TYPE_INT, WIDGET_Z_TOP) {}
+
+TB_WIDGET_FACTORY(TBTreeView, TBValue::TYPE_INT, WIDGET_Z_TOP) {}
+
 TB_WIDGET_FACTORY(TBCheckBox, TBValue::TYPE_INT, WIDGET_Z_TOP) {}
 TB_WIDGET_FACTORY(TBRadioButton, TBValue::TYPE_INT, WIDGET_Z_TOP) {}
 
@@ -489,6 +502,10 @@ bool TBWidgetsReader::LoadData(TBWidget *target, const char *data, int data_len)
 
 void TBWidgetsReader::LoadNodeTree(TBWidget *target, TBNode *node)
 {
+	// Allocate from the arena of the target window, if it has one.
+	TBWindow *window = target->GetParentWindow();
+	TBWidgetArenaScope arena_scope(window ? window->GetArena() : nullptr);
+
 	// Iterate through all nodes and create widgets
 	for (TBNode *child = node->GetFirstChild(); child; child = child->GetNext())
 		CreateWidget(target, child);
@@ -108,7 +108,7 @@ public:
 	Resource name:		TBWidget property:			Values:
 
 	id					TBWidget::m_id				TBID (string or int)
-	group-id			TBWidget::m_group_id		TBID (string or int)
+	group-id			TBWidget::SetGroupID		TBID (string or int)
 	value				TBWidget::SetValue			integer
 	data				TBWidget::m_data			integer
 	is-group-root		TBWidget::SetIsGroupRoot	boolean
@@ -4,6 +4,7 @@
 // ================================================================================
 
 #include "tb_window.h"
+#include "tb_widget_arena.h"
 #include <assert.h>
 
 namespace tb {
@@ -12,6 +13,7 @@ namespace tb {
 
 TBWindow::TBWindow()
 	: m_settings(WINDOW_SETTINGS_DEFAULT)
+	, m_arena(nullptr)
 {
 	SetSkinBg(TBIDC("TBWindow"), WIDGET_INVOKE_INFO_NO_CALLBACKS);
 	AddChild(&m_mover);
@@ -32,6 +34,18 @@ TBWindow::~TBWindow()
 	m_mover.RemoveFromParent();
 	m_close_button.RemoveFromParent();
 	m_textfield.RemoveFromParent();
+	SetArenaEnabled(false);
+}
+
+bool TBWindow::SetArenaEnabled(bool enable)
+{
+	if (enable == (m_arena ? true : false))
+		return true;
+	if (enable)
+		return (m_arena = new TBWidgetArena) ? true : false;
+	m_arena->Release();
+	m_arena = nullptr;
+	return true;
 }
 
 TBRect TBWindow::GetResizeToFitContentRect(RESIZE_FIT fit)
@@ -11,6 +11,8 @@
 
 namespace tb {
 
+class TBWidgetArena;
+
 enum WINDOW_SETTINGS {
 	WINDOW_SETTINGS_NONE			= 0,	///< Chrome less window without any other settings.
 	WINDOW_SETTINGS_TITLEBAR		= 1,	///< Show a title bar that can also move the window.
@@ -67,6 +69,17 @@ public:
 	void SetSettings(WINDOW_SETTINGS settings);
 	WINDOW_SETTINGS GetSettings() { return m_settings; }
 
+	/** Set if widgets inflated into this window by TBWidgetsReader should be allocated
+		from a TBWidgetArena owned by the window. This makes creating and deleting large
+		windows faster, at the cost of not reusing memory of widgets deleted before the
+		window. The arena is released when the window is deleted or the arena disabled, and
+		the memory is freed when all widgets allocated from it have been deleted.
+		Returns false on OOM. */
+	bool SetArenaEnabled(bool enable);
+
+	/** Get the arena used for this window, or nullptr. See SetArenaEnabled. */
+	TBWidgetArena *GetArena() const { return m_arena; }
+
 	/** RESIZE_FIT specifies how ResizeToFitContent should resize the window. */
 	enum RESIZE_FIT {
 		RESIZE_FIT_PREFERRED,			///< Fit the preferred size of all content
@@ -106,6 +119,7 @@ protected:
 	TBWidget m_close_button;
 	WINDOW_SETTINGS m_settings;
 	TBWidgetSafePointer m_last_focus;
+	TBWidgetArena *m_arena;
 	TBWindow *GetTopMostOtherWindow(bool only_activable_windows);
 	void SetWindowActiveState(bool active);
 	void DeActivate();
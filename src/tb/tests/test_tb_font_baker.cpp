@@ -0,0 +1,176 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#include "tb_test.h"
+#include "tb_font_baker.h"
+#include "tb_font_renderer.h"
+
+#if defined(TB_UNIT_TESTING) && defined(TB_FONT_RENDERER_BAKED)
+
+using namespace tb;
+
+TB_TEST_GROUP(tb_font_baker)
+{
+	/** A renderer with the glyphs 'A' (3x2), 'B' (2x3) and ' ' (empty). The ascent is the
+		font size, so the baked sizes can be told apart. */
+	class TBTestBakeRenderer : public TBFontRenderer
+	{
+	public:
+		TBTestBakeRenderer() : m_size(0) {}
+		virtual TBFontFace *Create(TBFontManager *font_manager, const char *filename,
+									const TBFontDescription &font_desc)
+		{
+			if (strcmp(filename, "test_bake_source") != 0)
+				return nullptr;
+			TBTestBakeRenderer *fr = new TBTestBakeRenderer;
+			fr->m_size = font_desc.GetSize();
+			return new TBFontFace(font_manager->GetGlyphCache(), fr, font_desc);
+		}
+		virtual bool RenderGlyph(TBFontGlyphData *data, UCS4 cp)
+		{
+			static uint8 a_pixels[6] = { 10, 20, 30, 40, 50, 60 };
+			static uint8 b_pixels[6] = { 1, 2, 3, 4, 5, 6 };
+			if (cp != 'A' && cp != 'B')
+				return false;
+			data->data8 = cp == 'A' ? a_pixels : b_pixels;
+			data->w = cp == 'A' ? 3 : 2;
+			data->h = cp == 'A' ? 2 : 3;
+			data->stride = data->w;
+			return true;
+		}
+		virtual void GetGlyphMetrics(TBGlyphMetrics *metrics, UCS4 cp)
+		{
+			metrics->advance = cp == 'A' ? 4 : 3;
+			metrics->x = 1;
+			metrics->y = cp == 'A' ? -2 : -3;
+		}
+		virtual TBFontMetrics GetMetrics()
+		{
+			TBFontMetrics metrics;
+			metrics.ascent = m_size;
+			metrics.descent = 2;
+			metrics.height = m_size + 2;
+			return metrics;
+		}
+		virtual bool HasGlyph(UCS4 cp) { return cp == 'A' || cp == 'B' || cp == ' '; }
+	private:
+		int m_size;
+	};
+
+	TBTestBakeRenderer *source_renderer;
+	TBTempBuffer baked;
+
+	TB_TEST(Init)
+	{
+		source_renderer = new TBTestBakeRenderer;
+		g_font_manager->AddRenderer(source_renderer);
+		g_font_manager->AddFontInfo("test_bake_source", "TBTestBakeSource");
+
+		TBFontBaker baker;
+		baker.AddSize(10);
+		baker.AddSize(20);
+		baker.SetGlyphs("BA C");
+		TB_VERIFY(baker.Bake(TBIDC("TBTestBakeSource"), baked));
+	}
+	TB_TEST(Shutdown)
+	{
+		g_font_manager->RemoveRenderer(source_renderer);
+		delete source_renderer;
+	}
+
+	TBFontFace *Load(const char *data, int data_len)
+	{
+		TBFontDescription fd;
+		fd.SetSize(19);
+		return CreateBakedFontFace(g_font_manager, data, data_len, fd);
+	}
+
+	/** Get a copy of the baked font, with the header and the size that is loaded. */
+	TBBakedFontHeader *CopyBaked(TBTempBuffer &data, TBBakedFontSize **size)
+	{
+		data.ResetAppendPos();
+		data.Append(baked.GetData(), baked.GetAppendPos());
+		*size = (TBBakedFontSize *) (data.GetData() + sizeof(TBBakedFontHeader)) + 1;
+		return (TBBakedFontHeader *) data.GetData();
+	}
+
+	TB_TEST(round_trip)
+	{
+		TBFontFace *font = Load(baked.GetData(), baked.GetAppendPos());
+		TB_VERIFY(font);
+		if (!font)
+			return;
+		TBFontRenderer *fr = font->GetFontRenderer();
+
+		// The closest size is loaded.
+		TB_VERIFY(fr->GetMetrics().ascent == 20);
+		TB_VERIFY(fr->GetMetrics().descent == 2);
+		TB_VERIFY(fr->GetMetrics().height == 22);
+
+		// Glyphs missing in the font are not baked.
+		TB_VERIFY(fr->HasGlyph('A') && fr->HasGlyph('B') && fr->HasGlyph(' '));
+		TB_VERIFY(!fr->HasGlyph('C'));
+
+		TBGlyphMetrics metrics;
+		fr->GetGlyphMetrics(&metrics, 'B');
+		TB_VERIFY(metrics.advance == 3 && metrics.x == 1 && metrics.y == -3);
+
+		TBFontGlyphData data;
+		TB_VERIFY(fr->RenderGlyph(&data, 'A'));
+		TB_VERIFY(data.w == 3 && data.h == 2 && data.data8 && !data.data32);
+		TB_VERIFY(data.data8[0] == 10 && data.data8[2] == 30);
+		TB_VERIFY(data.data8[data.stride] == 40 && data.data8[data.stride + 2] == 60);
+		TB_VERIFY(fr->RenderGlyph(&data, 'B'));
+		TB_VERIFY(data.w == 2 && data.h == 3);
+		TB_VERIFY(data.data8[0] == 1 && data.data8[data.stride * 2 + 1] == 6);
+
+		// The empty glyph has metrics but nothing to render.
+		TB_VERIFY(!fr->RenderGlyph(&data, ' '));
+		delete font;
+	}
+	TB_TEST(truncated)
+	{
+		const int header_size = sizeof(TBBakedFontHeader);
+		TB_VERIFY(!Load(baked.GetData(), header_size - 1));
+		TB_VERIFY(!Load(baked.GetData(), header_size + 2 * sizeof(TBBakedFontSize) - 1));
+		TB_VERIFY(!Load(baked.GetData(), baked.GetAppendPos() - 1));
+	}
+	TB_TEST(oversized)
+	{
+		TBTempBuffer data;
+		TBBakedFontSize *size;
+		TBBakedFontHeader *header = CopyBaked(data, &size);
+		TBFontFace *font = Load(data.GetData(), data.GetAppendPos());
+		TB_VERIFY(font);
+		delete font;
+
+		header->num_sizes = 0x10000000;
+		TB_VERIFY(!Load(data.GetData(), data.GetAppendPos()));
+
+		// The size of the pixel data would overflow to 0 in 32 bit.
+		CopyBaked(data, &size);
+		size->bitmap_w = size->bitmap_h = 0x10000;
+		TB_VERIFY(!Load(data.GetData(), data.GetAppendPos()));
+
+		CopyBaked(data, &size);
+		size->bitmap_w = TB_BAKED_FONT_MAX_BITMAP_SIZE;
+		size->bitmap_h = TB_BAKED_FONT_MAX_BITMAP_SIZE;
+		TB_VERIFY(!Load(data.GetData(), data.GetAppendPos()));
+
+		CopyBaked(data, &size);
+		size->bitmap_h = 0;
+		TB_VERIFY(!Load(data.GetData(), data.GetAppendPos()));
+
+		CopyBaked(data, &size);
+		size->num_glyphs = 0xccccccc;
+		TB_VERIFY(!Load(data.GetData(), data.GetAppendPos()));
+
+		CopyBaked(data, &size);
+		size->glyphs_offset = 0xfffffff0;
+		TB_VERIFY(!Load(data.GetData(), data.GetAppendPos()));
+	}
+}
+
+#endif // TB_UNIT_TESTING && TB_FONT_RENDERER_BAKED
@@ -0,0 +1,357 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#include "tb_test.h"
+#include "tb_font_renderer.h"
+#include "tb_widgets_common.h"
+
+#ifdef TB_UNIT_TESTING
+
+using namespace tb;
+
+TB_TEST_GROUP(tb_font_fallback_chain)
+{
+	/** A renderer for the files "test_chain_a", "test_chain_b" and "test_chain_c".
+		Font a has the glyphs 'a' and 'b', font b has 'b' and 'c', and font c has 'c' and 'd'.
+		The advance of all glyphs is 10 in font a, 20 in font b and 30 in font c, so the
+		string width tells which font a glyph was taken from. */
+	class TBTestChainRenderer : public TBFontRenderer
+	{
+	public:
+		TBTestChainRenderer() : m_font(0) {}
+		virtual TBFontFace *Create(TBFontManager *font_manager, const char *filename,
+									const TBFontDescription &font_desc)
+		{
+			if (strncmp(filename, "test_chain_", 11) != 0)
+				return nullptr;
+			TBTestChainRenderer *fr = new TBTestChainRenderer;
+			fr->m_font = filename[11];
+			return new TBFontFace(font_manager->GetGlyphCache(), fr, font_desc);
+		}
+		virtual bool RenderGlyph(TBFontGlyphData *data, UCS4 cp) { return false; }
+		virtual void GetGlyphMetrics(TBGlyphMetrics *metrics, UCS4 cp)
+		{
+			metrics->advance = (m_font - 'a' + 1) * 10;
+		}
+		virtual TBFontMetrics GetMetrics()
+		{
+			TBFontMetrics metrics;
+			metrics.ascent = metrics.height = 10;
+			return metrics;
+		}
+		virtual bool HasGlyph(UCS4 cp) { return cp == (UCS4) m_font || cp == (UCS4) m_font + 1; }
+	private:
+		char m_font;
+	};
+
+	TBTestChainRenderer *renderer;
+
+	TBFontFace *CreateFontFace(const char *name, int size)
+	{
+		TBFontDescription fd;
+		fd.SetID(TBID(name));
+		fd.SetSize(size);
+		return g_font_manager->CreateFontFace(fd);
+	}
+
+	bool HasFontFace(const char *name, int size)
+	{
+		TBFontDescription fd;
+		fd.SetID(TBID(name));
+		fd.SetSize(size);
+		return g_font_manager->HasFontFace(fd);
+	}
+
+	TB_TEST(Init)
+	{
+		renderer = new TBTestChainRenderer;
+		g_font_manager->AddRenderer(renderer);
+		g_font_manager->AddFontInfo("test_chain_b", "TBTestBFallback");
+		g_font_manager->AddFontInfo("test_chain_c", "TBTestCFallback");
+	}
+	TB_TEST(Shutdown)
+	{
+		g_font_manager->RemoveRenderer(renderer);
+		delete renderer;
+	}
+
+	TB_TEST(missing_codepoint)
+	{
+		g_font_manager->AddFontInfo("test_chain_a", "TBTestChainMissing");
+		TB_VERIFY(g_font_manager->AddFallbackFont(TBIDC("TBTestChainMissing"), TBIDC("TBTestBFallback")));
+		TBFontFace *font = CreateFontFace("TBTestChainMissing", 11);
+		TB_VERIFY(font);
+
+		// 'c' is missing in font a, so it's taken from font b. 'd' is in no font, so font a
+		// renders its replacement glyph.
+		TB_VERIFY(font->GetStringWidth("a") == 10);
+		TB_VERIFY(font->GetStringWidth("c") == 20);
+		TB_VERIFY(font->GetStringWidth("d") == 10);
+		TB_VERIFY(font->GetStringWidth("abcd") == 10 + 10 + 20 + 10);
+		TB_VERIFY(font->GetStringWidth("c") == 20);
+	}
+	TB_TEST(chain_order)
+	{
+		g_font_manager->AddFontInfo("test_chain_a", "TBTestChainOrder");
+		TB_VERIFY(g_font_manager->AddFallbackFont(TBIDC("TBTestChainOrder"), TBIDC("TBTestBFallback")));
+		TB_VERIFY(g_font_manager->AddFallbackFont(TBIDC("TBTestChainOrder"), TBIDC("TBTestCFallback")));
+		TBFontFace *font = CreateFontFace("TBTestChainOrder", 11);
+		TB_VERIFY(font);
+
+		// 'b' is in font a and b, and 'c' is in font b and c. The first font having it wins.
+		TB_VERIFY(font->GetStringWidth("b") == 10);
+		TB_VERIFY(font->GetStringWidth("c") == 20);
+		TB_VERIFY(font->GetStringWidth("d") == 30);
+	}
+	TB_TEST(missing_chain_font)
+	{
+		// A fallback font that isn't added, or that no renderer can create, covers nothing.
+		g_font_manager->AddFontInfo("test_chain_a", "TBTestChainNoFont");
+		g_font_manager->AddFontInfo("test_chain_missing_file", "TBTestChainNoFile");
+		TB_VERIFY(g_font_manager->AddFallbackFont(TBIDC("TBTestChainNoFont"), TBIDC("TBTestChainUnknown")));
+		TB_VERIFY(g_font_manager->AddFallbackFont(TBIDC("TBTestChainNoFont"), TBIDC("TBTestChainNoFile")));
+		TB_VERIFY(g_font_manager->AddFallbackFont(TBIDC("TBTestChainNoFont"), TBIDC("TBTestCFallback")));
+		TBFontFace *font = CreateFontFace("TBTestChainNoFont", 11);
+		TB_VERIFY(font);
+		TB_VERIFY(font->GetStringWidth("a") == 10);
+		TB_VERIFY(font->GetStringWidth("c") == 30);
+		TB_VERIFY(font->GetStringWidth("e") == 10);
+	}
+	TB_TEST(faces_created_up_front)
+	{
+		// Creating a font face creates the font faces of its fallback fonts with the same size.
+		g_font_manager->AddFontInfo("test_chain_a", "TBTestChainFaces");
+		TB_VERIFY(g_font_manager->AddFallbackFont(TBIDC("TBTestChainFaces"), TBIDC("TBTestBFallback")));
+		TB_VERIFY(!HasFontFace("TBTestBFallback", 12));
+		TBFontFace *font = CreateFontFace("TBTestChainFaces", 12);
+		TB_VERIFY(font);
+		TB_VERIFY(HasFontFace("TBTestBFallback", 12));
+
+		// Adding a fallback font creates its font faces for the existing font faces.
+		TB_VERIFY(!HasFontFace("TBTestCFallback", 12));
+		TB_VERIFY(g_font_manager->AddFallbackFont(TBIDC("TBTestChainFaces"), TBIDC("TBTestCFallback")));
+		TB_VERIFY(HasFontFace("TBTestCFallback", 12));
+
+		// So measuring (or drawing) with the chain never creates font faces.
+		const uint32 face_generation = g_font_manager->GetFaceGeneration();
+		TB_VERIFY(font->GetStringWidth("abcd") == 10 + 10 + 20 + 30);
+		TB_VERIFY(g_font_manager->GetFaceGeneration() == face_generation);
+	}
+}
+
+TB_TEST_GROUP(tb_font_drawing)
+{
+	/** A renderer for the file "test_glyphs", with 3x4 glyphs for 'A', 'B' and '.', and an
+		empty ' '. The advance of all glyphs is half the font size. */
+	class TBTestGlyphRenderer : public TBFontRenderer
+	{
+	public:
+		TBTestGlyphRenderer() : m_size(0) {}
+		virtual TBFontFace *Create(TBFontManager *font_manager, const char *filename,
+									const TBFontDescription &font_desc)
+		{
+			if (strcmp(filename, "test_glyphs") != 0)
+				return nullptr;
+			TBTestGlyphRenderer *fr = new TBTestGlyphRenderer;
+			fr->m_size = font_desc.GetSize();
+			return new TBFontFace(font_manager->GetGlyphCache(), fr, font_desc);
+		}
+		virtual bool RenderGlyph(TBFontGlyphData *data, UCS4 cp)
+		{
+			static uint8 pixels[3 * 4] = { 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255 };
+			if (cp != 'A' && cp != 'B' && cp != '.')
+				return false;
+			data->data8 = pixels;
+			data->w = data->stride = 3;
+			data->h = 4;
+			return true;
+		}
+		virtual void GetGlyphMetrics(TBGlyphMetrics *metrics, UCS4 cp)
+		{
+			metrics->advance = m_size / 2;
+			metrics->x = 1;
+			metrics->y = -4;
+		}
+		virtual TBFontMetrics GetMetrics()
+		{
+			TBFontMetrics metrics;
+			metrics.ascent = 8;
+			metrics.descent = 2;
+			metrics.height = 10;
+			return metrics;
+		}
+	private:
+		int m_size;
+	};
+
+	/** A renderer that records the glyph runs and colored bitmap fragments drawn, and
+		passes everything on to the real renderer. */
+	class TBRecordingRenderer : public TBRenderer
+	{
+	public:
+		enum { MAX_GLYPHS = 256 };
+		TBRecordingRenderer(TBRenderer *renderer) : renderer(renderer) { Reset(); }
+		void Reset() { num_runs = num_glyphs = num_colored_fragments = 0; }
+
+		virtual void BeginPaint(int render_target_w, int render_target_h) { renderer->BeginPaint(render_target_w, render_target_h); }
+		virtual void EndPaint() { renderer->EndPaint(); }
+		virtual void Translate(int dx, int dy) { renderer->Translate(dx, dy); }
+		virtual void SetOpacity(float opacity) { renderer->SetOpacity(opacity); }
+		virtual float GetOpacity() { return renderer->GetOpacity(); }
+		virtual TBRect SetClipRect(const TBRect &rect, bool add_to_current) { return renderer->SetClipRect(rect, add_to_current); }
+		virtual TBRect GetClipRect() { return renderer->GetClipRect(); }
+		virtual void DrawBitmap(const TBRect &dst_rect, const TBRect &src_rect, TBBitmapFragment *bitmap_fragment) { renderer->DrawBitmap(dst_rect, src_rect, bitmap_fragment); }
+		virtual void DrawBitmap(const TBRect &dst_rect, const TBRect &src_rect, TBBitmap *bitmap) { renderer->DrawBitmap(dst_rect, src_rect, bitmap); }
+		virtual void DrawBitmapColored(const TBRect &dst_rect, const TBRect &src_rect, const TBColor &color, TBBitmapFragment *bitmap_fragment)
+		{
+			if (num_colored_fragments < MAX_GLYPHS)
+				colored_fragments[num_colored_fragments] = dst_rect;
+			num_colored_fragments++;
+			renderer->DrawBitmapColored(dst_rect, src_rect, color, bitmap_fragment);
+		}
+		virtual void DrawBitmapColored(const TBRect &dst_rect, const TBRect &src_rect, const TBColor &color, TBBitmap *bitmap) { renderer->DrawBitmapColored(dst_rect, src_rect, color, bitmap); }
+		virtual void DrawBitmapTile(const TBRect &dst_rect, TBBitmap *bitmap) { renderer->DrawBitmapTile(dst_rect, bitmap); }
+		virtual void DrawGlyphRun(const GlyphRunItem *run, int run_len, const TBColor &color)
+		{
+			for (int i = 0; i < run_len && num_glyphs < MAX_GLYPHS; i++)
+				glyphs[num_glyphs++] = run[i];
+			num_runs++;
+			renderer->DrawGlyphRun(run, run_len, color);
+		}
+		virtual void FlushBitmapFragment(TBBitmapFragment *bitmap_fragment) { renderer->FlushBitmapFragment(bitmap_fragment); }
+		virtual TBBitmap *CreateBitmap(int width, int height, uint32 *data) { return renderer->CreateBitmap(width, height, data); }
+		virtual void BeginBatchHint(BATCH_HINT hint) { renderer->BeginBatchHint(hint); }
+		virtual void EndBatchHint() { renderer->EndBatchHint(); }
+
+		TBRenderer *renderer;
+		int num_runs;
+		int num_glyphs;
+		GlyphRunItem glyphs[MAX_GLYPHS];
+		int num_colored_fragments;
+		TBRect colored_fragments[MAX_GLYPHS];
+	};
+
+	TBTestGlyphRenderer *font_renderer;
+	TBRecordingRenderer *recorder;
+	TBFontFace *font;
+	TBFontFace *large_font;
+	const TBColor color(255, 255, 255);
+
+	TB_TEST(Init)
+	{
+		font_renderer = new TBTestGlyphRenderer;
+		g_font_manager->AddRenderer(font_renderer);
+		g_font_manager->AddFontInfo("test_glyphs", "TBTestGlyphs");
+		TBFontDescription fd;
+		fd.SetID(TBIDC("TBTestGlyphs"));
+		fd.SetSize(10);
+		TB_VERIFY(font = g_font_manager->CreateFontFace(fd));
+		fd.SetSize(20);
+		TB_VERIFY(large_font = g_font_manager->CreateFontFace(fd));
+		TB_VERIFY(font->RenderGlyphs("AB. "));
+		TB_VERIFY(large_font->RenderGlyphs("AB. "));
+	}
+	TB_TEST(Shutdown)
+	{
+		g_font_manager->RemoveRenderer(font_renderer);
+		delete font_renderer;
+	}
+	TB_TEST(Setup)
+	{
+		recorder = new TBRecordingRenderer(g_renderer);
+		g_renderer = recorder;
+		g_renderer->BeginPaint(100, 100);
+	}
+	TB_TEST(Cleanup)
+	{
+		g_renderer = recorder->renderer;
+		g_renderer->EndPaint();
+		delete recorder;
+	}
+
+	TB_TEST(draw_string_as_run)
+	{
+		// All glyphs are drawn in one run. The space has nothing to draw, and doesn't break it.
+		font->DrawString(10, 20, color, "AB A");
+		TB_VERIFY(recorder->num_runs == 1 && recorder->num_glyphs == 3);
+		TB_VERIFY(recorder->num_colored_fragments == 0);
+		TB_VERIFY(recorder->glyphs[0].x == 10 + 1 && recorder->glyphs[0].y == 20 - 4 + 8);
+		TB_VERIFY(recorder->glyphs[1].x == 10 + 5 + 1);
+		TB_VERIFY(recorder->glyphs[2].x == 10 + 15 + 1);
+		TB_VERIFY(recorder->glyphs[0].fragment == recorder->glyphs[2].fragment);
+		TB_VERIFY(recorder->glyphs[0].fragment != recorder->glyphs[1].fragment);
+	}
+	TB_TEST(long_string)
+	{
+		// Long strings are drawn in runs of a limited size.
+		TBStr str;
+		for (int i = 0; i < 100; i++)
+			str.Append("A");
+		font->DrawString(0, 0, color, str);
+		TB_VERIFY(recorder->num_glyphs == 100 && recorder->num_runs > 1);
+		TB_VERIFY(recorder->glyphs[99].x == 99 * 5 + 1);
+	}
+	TB_TEST(default_draw_glyph_run)
+	{
+		// The default DrawGlyphRun draws each glyph with DrawBitmapColored.
+		font->DrawString(10, 20, color, "AB");
+		TBRenderer::GlyphRunItem run[2] = { recorder->glyphs[0], recorder->glyphs[1] };
+		recorder->TBRenderer::DrawGlyphRun(run, 2, color);
+		TB_VERIFY(recorder->num_colored_fragments == 2);
+		TB_VERIFY(recorder->colored_fragments[0].Equals(TBRect(11, 24, 3, 4)));
+		TB_VERIFY(recorder->colored_fragments[1].Equals(TBRect(16, 24, 3, 4)));
+	}
+	TB_TEST(string_layout)
+	{
+		TBFontStringLayout layout;
+		TB_VERIFY(font->LayoutString(layout, "AB A"));
+		TB_VERIFY(layout.GetFont() == font);
+		TB_VERIFY(layout.GetNumGlyphs() == 4);
+		TB_VERIFY(layout.GetWidth() == font->GetStringWidth("AB A") && layout.GetWidth() == 20);
+		TB_VERIFY(layout.GetGlyphX(3) == 15 && layout.GetGlyphX(4) == 20);
+
+		// Drawing the layout gives the same run as drawing the string.
+		font->DrawLayout(10, 20, color, layout);
+		TB_VERIFY(recorder->num_runs == 1 && recorder->num_glyphs == 3);
+		TB_VERIFY(recorder->glyphs[2].x == 10 + 15 + 1 && recorder->glyphs[2].y == 24);
+
+		// Only some of the glyphs can be drawn.
+		recorder->Reset();
+		font->DrawLayout(10, 20, color, layout, 2);
+		TB_VERIFY(recorder->num_glyphs == 2);
+
+		layout.Reset();
+		TB_VERIFY(!layout.GetFont() && !layout.GetNumGlyphs() && !layout.GetWidth());
+	}
+	TB_TEST(widget_string)
+	{
+		TBWidget widget;
+		TBFontDescription fd = font->GetFontDescription();
+		widget.SetFontDescription(fd);
+		TBWidgetString str;
+		TB_VERIFY(str.SetText("ABAB"));
+		TB_VERIFY(str.GetWidth(&widget) == 20 && str.GetHeight(&widget) == 10);
+
+		// The cached layout follows changes of the text and the font.
+		TB_VERIFY(str.SetText("AB"));
+		TB_VERIFY(str.GetWidth(&widget) == 10);
+		widget.SetFontDescription(large_font->GetFontDescription());
+		TB_VERIFY(str.GetWidth(&widget) == 20);
+		widget.SetFontDescription(fd);
+
+		// Painting in a rect that is too narrow draws the glyphs that fit, and "...".
+		str.SetText("ABABAB");
+		str.Paint(&widget, TBRect(0, 0, 22, 10), color);
+		TB_VERIFY(recorder->num_glyphs == 1 + 3);
+		TB_VERIFY(recorder->glyphs[0].x == 1 && recorder->glyphs[1].x == 5 + 1);
+
+		// Painting again draws the same.
+		recorder->Reset();
+		str.Paint(&widget, TBRect(0, 0, 22, 10), color);
+		TB_VERIFY(recorder->num_glyphs == 1 + 3);
+	}
+}
+
+#endif // TB_UNIT_TESTING
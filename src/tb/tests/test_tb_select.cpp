@@ -0,0 +1,741 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#include "tb_test.h"
+#include "tb_select.h"
+
+#ifdef TB_UNIT_TESTING
+
+using namespace tb;
+
+TB_TEST_GROUP(tb_select_recycle)
+{
+	TBSelectList *list;
+	TBGenericStringItemSource *source;
+
+	/** Return the text of a item widget, or of the first text field in it. */
+	TBStr GetItemText(TBWidget *widget)
+	{
+		if (widget->IsOfType<TBTextField>() || widget->IsOfType<TBButton>())
+			return widget->GetText();
+		for (TBWidget *child = widget->GetFirstChild(); child; child = child->GetNext())
+			if (child->IsOfType<TBTextField>())
+				return child->GetText();
+		return "";
+	}
+
+	/** Return true if all item widgets show the string of the item they represent. */
+	bool AreItemWidgetsCorrect()
+	{
+		for (TBWidget *child = list->GetScrollContainer()->GetContentRoot()->GetFirstChild()->GetContentRoot()->GetFirstChild();
+			child; child = child->GetNext())
+		{
+			int index = child->data.GetInt();
+			if (index == -1)
+				continue; // Header
+			if (!GetItemText(child).Equals(source->GetItemString(index)) || child->GetID() != source->GetItemID(index))
+				return false;
+		}
+		return true;
+	}
+
+	/** Return the number of item widgets in list that are also in the given array.
+		Widgets that are not reused may have been deleted. */
+	int CountReused(TBWidgetSafePointer *old_widgets, int num_old_widgets)
+	{
+		int num_reused = 0;
+		for (int i = 0; i < num_old_widgets; i++)
+			if (old_widgets[i].Get() && old_widgets[i].Get()->GetParent())
+				num_reused++;
+		return num_reused;
+	}
+
+	TB_TEST(Setup)
+	{
+		TB_VERIFY(list = new TBSelectList);
+		source = list->GetDefaultSource();
+		for (int i = 0; i < 100; i++)
+		{
+			TBStr str;
+			str.SetFormatted("item %d", i);
+			source->AddItem(new TBGenericStringItem(str, TBID(i + 1)));
+		}
+		list->ValidateList();
+	}
+	TB_TEST(Cleanup)
+	{
+		delete list;
+	}
+
+	TB_TEST(filter)
+	{
+		TB_VERIFY(AreItemWidgetsCorrect());
+		TBWidgetSafePointer old_widgets[100];
+		for (int i = 0; i < 100; i++)
+			old_widgets[i].Set(list->GetItemWidget(i));
+
+		// "item 5", "item 15", "item 25"... are shown, reusing widgets of other items.
+		list->SetFilter("5");
+		list->ValidateList();
+		TB_VERIFY(AreItemWidgetsCorrect());
+		TB_VERIFY(list->GetItemWidget(5) && list->GetItemWidget(15) && !list->GetItemWidget(0));
+		TB_VERIFY(CountReused(old_widgets, 100) == 19);
+
+		list->SetFilter(nullptr);
+		list->ValidateList();
+		TB_VERIFY(AreItemWidgetsCorrect());
+	}
+	TB_TEST(item_types)
+	{
+		// Items with images need other widgets than string-only items.
+		for (int i = 0; i < 100; i += 2)
+			source->GetItem(i)->SetSkinImage(TBIDC("Icon16"));
+		list->InvalidateList();
+		list->ValidateList();
+		TB_VERIFY(AreItemWidgetsCorrect());
+		TB_VERIFY(list->GetItemWidget(0)->GetClassName() != list->GetItemWidget(1)->GetClassName());
+
+		list->SetFilter("1");
+		list->ValidateList();
+		TB_VERIFY(AreItemWidgetsCorrect());
+	}
+	TB_TEST(item_changed)
+	{
+		TBWidget *widget = list->GetItemWidget(3);
+		list->SelectItem(3, true);
+		source->GetItem(3)->str.Set("changed");
+		source->InvokeItemChanged(3);
+		TB_VERIFY(list->GetItemWidget(3) == widget);
+		TB_VERIFY_STR(widget->GetText(), "changed");
+		TB_VERIFY(widget->GetState(WIDGET_STATE_SELECTED));
+	}
+	TB_TEST(custom_item_widgets)
+	{
+		/** A source that creates its own item widgets, that can't be reused by the default rebind. */
+		class TBCustomItemSource : public TBGenericStringItemSource
+		{
+		public:
+			virtual TBWidget *CreateItemWidget(int index, TBSelectItemViewer *viewer)
+			{
+				TBButton *button = new TBButton;
+				button->SetText(GetItemString(index));
+				button->SetID(GetItemID(index));
+				return button;
+			}
+		};
+		TBCustomItemSource custom_source;
+		for (int i = 0; i < 20; i++)
+			custom_source.AddItem(new TBGenericStringItem(source->GetItemString(i), source->GetItemID(i)));
+		source = &custom_source;
+		list->SetSource(source);
+		list->ValidateList();
+		TB_VERIFY(AreItemWidgetsCorrect());
+
+		list->SetFilter("1");
+		list->ValidateList();
+		TB_VERIFY(AreItemWidgetsCorrect());
+		TB_VERIFY(list->GetItemWidget(1)->IsOfType<TBButton>());
+		list->SetSource(nullptr);
+	}
+	TB_TEST(rebind_failure)
+	{
+		/** A source that can only rebind widgets to the items with even indexes. */
+		class TBEvenRebindItemSource : public TBGenericStringItemSource
+		{
+		public:
+			virtual bool RebindItemWidget(int index, TBWidget *widget, TBSelectItemViewer *viewer)
+			{
+				return index % 2 == 0 && TBGenericStringItemSource::RebindItemWidget(index, widget, viewer);
+			}
+		};
+		TBEvenRebindItemSource even_source;
+		for (int i = 0; i < 4; i++)
+			even_source.AddItem(new TBGenericStringItem(source->GetItemString(i), source->GetItemID(i)));
+		TBItemWidgetPool pool;
+		for (int i = 0; i < 3; i++)
+			pool.Recycle(even_source.CreateItemWidget(i, list), even_source.GetItemWidgetType(i));
+		TB_VERIFY(pool.GetNumWidgets() == 3);
+
+		// Only the widget that failed to rebind is dropped.
+		TB_VERIFY(!pool.GetAndRebind(&even_source, 1, list));
+		TB_VERIFY(pool.GetNumWidgets() == 2);
+		TBWidget *widget = pool.GetAndRebind(&even_source, 2, list);
+		TB_VERIFY(widget);
+		TB_VERIFY_STR(widget->GetText(), "item 2");
+		TB_VERIFY(pool.GetNumWidgets() == 1);
+		delete widget;
+	}
+
+	int num_live_item_widgets = 0;
+
+	/** A text field that counts how many exist. */
+	class TBLiveTextField : public TBTextField
+	{
+	public:
+		TBLiveTextField() { num_live_item_widgets++; }
+		~TBLiveTextField() { num_live_item_widgets--; }
+	};
+
+	/** A source with reusable item widgets that count how many exist. */
+	class TBLiveWidgetItemSource : public TBGenericStringItemSource
+	{
+	public:
+		virtual TBWidget *CreateItemWidget(int index, TBSelectItemViewer *viewer)
+		{
+			TBLiveTextField *textfield = new TBLiveTextField;
+			textfield->SetText(GetItemString(index));
+			return textfield;
+		}
+		virtual TBID GetItemWidgetType(int index) { return TBIDC("TBLiveTextField"); }
+		virtual bool RebindItemWidget(int index, TBWidget *widget, TBSelectItemViewer *viewer)
+		{
+			widget->SetText(GetItemString(index));
+			widget->SetStateRaw(WIDGET_STATE_NONE);
+			return true;
+		}
+	};
+
+	TB_TEST(pool_trimmed_when_narrowed)
+	{
+		TBLiveWidgetItemSource live_source;
+		for (int i = 0; i < 5000; i++)
+		{
+			TBStr str;
+			str.SetFormatted("item %d", i);
+			live_source.AddItem(new TBGenericStringItem(str));
+		}
+		list->SetSource(&live_source);
+		list->ValidateList();
+		TB_VERIFY(num_live_item_widgets == 5000);
+
+		// "item 432" and "item 4320" to "item 4329" are shown after the header. No more
+		// widgets than that are kept for reuse.
+		list->SetFilter("item 432");
+		list->ValidateList();
+		TB_VERIFY(list->GetItemWidget(4321) && !list->GetItemWidget(0));
+		TB_VERIFY(num_live_item_widgets <= 11 + 12);
+
+		// Widgets are still reused when the filter changes.
+		list->SetFilter("item 43");
+		list->ValidateList();
+		TB_VERIFY(list->GetItemWidget(4399) && num_live_item_widgets == 111);
+
+		list->SetSource(nullptr);
+		TB_VERIFY(num_live_item_widgets == 0);
+	}
+}
+
+TB_TEST_GROUP(tb_select_virtual)
+{
+	TBSelectList *list;
+	TBGenericStringItemSource *source;
+	const int num_items = 10000;
+	const int row_h = 20;
+
+	/** Return the number of item widgets in the list. */
+	int GetNumItemWidgets()
+	{
+		int num = 0;
+		for (TBWidget *child = list->GetScrollContainer()->GetContentRoot()->GetFirstChild()->GetFirstChild();
+			child; child = child->GetNext())
+			num++;
+		return num;
+	}
+
+	TB_TEST(Setup)
+	{
+		TB_VERIFY(list = new TBSelectList);
+		source = list->GetDefaultSource();
+		for (int i = 0; i < num_items; i++)
+		{
+			TBStr str;
+			str.SetFormatted("item %d", i);
+			source->AddItem(new TBGenericStringItem(str, TBID(i + 1)));
+		}
+		list->SetVirtualized(true, row_h);
+		list->SetRect(TBRect(0, 0, 200, 200));
+		list->InvokeProcess();
+	}
+	TB_TEST(Cleanup)
+	{
+		delete list;
+	}
+
+	TB_TEST(visible_rows_only)
+	{
+		TB_VERIFY(list->GetVirtualized());
+		TB_VERIFY(GetNumItemWidgets() > 0 && GetNumItemWidgets() < 30);
+		TB_VERIFY(list->GetItemWidget(0) && !list->GetItemWidget(100));
+
+		// The scroll range covers all items.
+		TBWidget::ScrollInfo info = list->GetScrollContainer()->GetScrollInfo();
+		TB_VERIFY(info.max_y + list->GetScrollContainer()->GetPaddingRect().h == num_items * row_h);
+	}
+	TB_TEST(scroll)
+	{
+		list->GetScrollContainer()->ScrollTo(0, 5000 * row_h);
+		list->InvokeProcess();
+		TB_VERIFY(GetNumItemWidgets() < 30);
+		TB_VERIFY(!list->GetItemWidget(0));
+		TBWidget *widget = list->GetItemWidget(5000);
+		TB_VERIFY(widget && widget->GetRect().y == 5000 * row_h && widget->GetRect().h == row_h);
+		TB_VERIFY_STR(widget->GetText(), "item 5000");
+
+		// The same widgets are reused when scrolling back.
+		TBWidget *old_widgets[30];
+		int num_old_widgets = 0;
+		for (TBWidget *child = widget->GetParent()->GetFirstChild(); child; child = child->GetNext())
+			old_widgets[num_old_widgets++] = child;
+		list->GetScrollContainer()->ScrollTo(0, 0);
+		list->InvokeProcess();
+		TB_VERIFY(list->GetItemWidget(0) && !list->GetItemWidget(5000));
+		int num_reused = 0;
+		for (int i = 0; i < num_old_widgets; i++)
+			if (old_widgets[i]->GetParent())
+				num_reused++;
+		TB_VERIFY(num_reused == GetNumItemWidgets());
+	}
+	TB_TEST(keyboard_navigation)
+	{
+		source->GetItem(num_items - 2)->str.Set("-");
+		list->InvalidateList();
+		list->InvokeProcess();
+
+		TB_VERIFY(list->ChangeValue(TB_KEY_END));
+		TB_VERIFY(list->GetValue() == num_items - 1);
+		TBWidget *widget = list->GetItemWidget(num_items - 1);
+		TB_VERIFY(widget && widget->GetState(WIDGET_STATE_SELECTED));
+
+		// The separator is skipped.
+		TB_VERIFY(list->ChangeValue(TB_KEY_UP));
+		TB_VERIFY(list->GetValue() == num_items - 3);
+
+		TB_VERIFY(list->ChangeValue(TB_KEY_HOME));
+		TB_VERIFY(list->GetValue() == 0);
+		TB_VERIFY(!list->ChangeValue(TB_KEY_UP));
+		TB_VERIFY(list->GetItemWidget(0) && !list->GetItemWidget(num_items - 1));
+	}
+	TB_TEST(scroll_to_selected)
+	{
+		list->SetValue(7000);
+		TBWidget *widget = list->GetItemWidget(7000);
+		TB_VERIFY(widget && widget->GetState(WIDGET_STATE_SELECTED));
+		TBWidget::ScrollInfo info = list->GetScrollContainer()->GetScrollInfo();
+		TB_VERIFY(info.y <= 7000 * row_h && info.y + list->GetScrollContainer()->GetPaddingRect().h >= 7001 * row_h);
+	}
+	TB_TEST(filter)
+	{
+		// Row 0 is the header, followed by "item 999", "item 1999"...
+		list->SetFilter("999");
+		list->InvokeProcess();
+		TBWidget *widget = list->GetItemWidget(999);
+		TB_VERIFY(widget && widget->GetRect().y == row_h);
+		TB_VERIFY(list->GetItemWidget(1999)->GetRect().y == 2 * row_h);
+
+		// 19 items contain "999" (999, 1999...9999 and 9990...9998).
+		TBWidget::ScrollInfo info = list->GetScrollContainer()->GetScrollInfo();
+		TB_VERIFY(info.max_y + list->GetScrollContainer()->GetPaddingRect().h == (1 + 19) * row_h);
+	}
+	TB_TEST(estimated_row_height)
+	{
+		list->SetVirtualized(true, 0);
+		list->InvokeProcess();
+		TBWidget *first = list->GetItemWidget(0);
+		TBWidget *second = list->GetItemWidget(1);
+		TB_VERIFY(first && second);
+		TB_VERIFY(first->GetRect().h > 1 && first->GetRect().h == first->GetPreferredSize().pref_h);
+		TB_VERIFY(second->GetRect().y == first->GetRect().h);
+	}
+	TB_TEST(not_virtualized)
+	{
+		list->SetVirtualized(false);
+		list->SetFilter("99");
+		list->InvokeProcess();
+		int num_matching = 0;
+		for (int i = 0; i < num_items; i++)
+			if (source->Filter(i, "99"))
+				num_matching++;
+		TB_VERIFY(GetNumItemWidgets() == 1 + num_matching); // Header and items
+		TB_VERIFY(list->GetItemWidget(9999));
+	}
+}
+
+TB_TEST_GROUP(tb_select_incremental)
+{
+	TBSelectList *list;
+	TBGenericStringItemSource *source;
+
+	/** Return true if the item widgets show the items that match the filter, in sort
+		order, and only the selected item is selected. */
+	bool IsListCorrect()
+	{
+		TBWidget *item_root = list->GetScrollContainer()->GetContentRoot()->GetFirstChild()->GetContentRoot();
+		const char *filter = list->GetFilter();
+		TBWidget *prev = nullptr;
+		int num_shown = 0;
+		for (TBWidget *child = item_root->GetFirstChild(); child; child = child->GetNext())
+		{
+			int index = child->data.GetInt();
+			if (index == -1)
+				continue; // Header
+			if (!child->GetText().Equals(source->GetItemString(index)) || child->GetID() != source->GetItemID(index))
+				return false;
+			if (*filter && !source->Filter(index, filter))
+				return false;
+			if (child->GetState(WIDGET_STATE_SELECTED) != (index == list->GetValue()))
+				return false;
+			if (prev && prev->data.GetInt() != -1)
+			{
+				int prev_index = prev->data.GetInt();
+				int cmp = source->GetSort() == TB_SORT_NONE ? 0 : strcmp(source->GetItemString(prev_index), source->GetItemString(index));
+				if (source->GetSort() == TB_SORT_DESCENDING)
+					cmp = -cmp;
+				if (cmp > 0 || (cmp == 0 && prev_index > index))
+					return false;
+			}
+			// Rows of virtualized lists are positioned by their order.
+			if (prev && list->GetVirtualized() && child->GetRect().y != prev->GetRect().y + prev->GetRect().h)
+				return false;
+			prev = child;
+			num_shown++;
+		}
+		if (list->GetVirtualized())
+			return true;
+		int num_matching = 0;
+		for (int i = 0; i < source->GetNumItems(); i++)
+			if (!*filter || source->Filter(i, filter))
+				num_matching++;
+		return num_shown == num_matching;
+	}
+
+	TB_TEST(Setup)
+	{
+		TB_VERIFY(list = new TBSelectList);
+		source = list->GetDefaultSource();
+		for (int i = 0; i < 100; i++)
+		{
+			TBStr str;
+			str.SetFormatted("item %03d", i);
+			source->AddItem(new TBGenericStringItem(str, TBID(i + 1)));
+		}
+		list->SetRect(TBRect(0, 0, 200, 200));
+		list->InvokeProcess();
+	}
+	TB_TEST(Cleanup)
+	{
+		delete list;
+	}
+
+	TB_TEST(add)
+	{
+		TBWidget *widget = list->GetItemWidget(50);
+		source->AddItem(new TBGenericStringItem("new", TBIDC("new")), 10);
+		TB_VERIFY(list->GetItemWidget(51) == widget);
+		TB_VERIFY_STR(list->GetItemWidget(10)->GetText(), "new");
+		TB_VERIFY(list->GetItemWidget(10)->GetNext() == list->GetItemWidget(11));
+		TB_VERIFY(IsListCorrect());
+	}
+	TB_TEST(remove)
+	{
+		list->SetValue(20);
+		TBWidget *widget = list->GetItemWidget(50);
+		source->DeleteItem(3);
+		TB_VERIFY(list->GetItemWidget(49) == widget);
+		TB_VERIFY(list->GetValue() == 19);
+		TB_VERIFY(IsListCorrect());
+
+		// Removing the selected item unselects it.
+		source->DeleteItem(19);
+		TB_VERIFY(list->GetValue() == -1);
+		TB_VERIFY(IsListCorrect());
+	}
+	TB_TEST(sorted)
+	{
+		source->SetSort(TB_SORT_ASCENDING);
+		list->InvalidateList();
+		list->InvokeProcess();
+
+		source->AddItem(new TBGenericStringItem("item 050b", TBIDC("050b")), 0);
+		TB_VERIFY_STR(list->GetItemWidget(0)->GetPrev()->GetText(), "item 050");
+		TB_VERIFY(IsListCorrect());
+
+		// Equal items are kept in source order.
+		source->AddItem(new TBGenericStringItem("item 050", TBIDC("050")), 0);
+		TB_VERIFY(list->GetItemWidget(0)->GetNext() == list->GetItemWidget(52));
+		TB_VERIFY(IsListCorrect());
+
+		// Changing the string of an item moves it.
+		list->SetValue(0);
+		source->GetItem(0)->str.Set("item 999");
+		source->InvokeItemChanged(0);
+		TB_VERIFY(!list->GetItemWidget(0)->GetNext());
+		TB_VERIFY(IsListCorrect());
+
+		source->SetSort(TB_SORT_DESCENDING);
+		list->InvalidateList();
+		list->InvokeProcess();
+		source->AddItem(new TBGenericStringItem("item 500", TBIDC("500")));
+		TB_VERIFY(list->GetItemWidget(0)->GetNext() == list->GetItemWidget(source->GetNumItems() - 1));
+		TB_VERIFY(IsListCorrect());
+	}
+	TB_TEST(filter)
+	{
+		list->SetFilter("5");
+		list->InvokeProcess();
+		TBWidget *header = list->GetItemWidget(5)->GetPrev();
+		TB_VERIFY(header && header->data.GetInt() == -1);
+		TBStr header_text;
+		header_text.Set(header->GetText());
+
+		source->AddItem(new TBGenericStringItem("abc", TBIDC("abc")));
+		TB_VERIFY(!list->GetItemWidget(100));
+		TB_VERIFY(IsListCorrect());
+
+		source->AddItem(new TBGenericStringItem("x5", TBIDC("x5")));
+		TB_VERIFY(list->GetItemWidget(101));
+		TB_VERIFY(!header->GetText().Equals(header_text));
+		TB_VERIFY(IsListCorrect());
+
+		// Items are shown or hidden when they start or stop matching.
+		source->GetItem(100)->str.Set("abc5");
+		source->InvokeItemChanged(100);
+		TB_VERIFY(list->GetItemWidget(100));
+		source->GetItem(101)->str.Set("x");
+		source->InvokeItemChanged(101);
+		TB_VERIFY(!list->GetItemWidget(101));
+		TB_VERIFY(IsListCorrect());
+	}
+	TB_TEST(scroll_position)
+	{
+		list->GetScrollContainer()->ScrollTo(0, 100);
+		int scroll_y = list->GetScrollContainer()->GetScrollInfo().y;
+		TB_VERIFY(scroll_y > 0);
+		source->AddItem(new TBGenericStringItem("new", TBIDC("new")), 0);
+		source->DeleteItem(50);
+		list->InvokeProcess();
+		TB_VERIFY(list->GetScrollContainer()->GetScrollInfo().y == scroll_y);
+	}
+	TB_TEST(virtualized)
+	{
+		list->SetVirtualized(true, 20);
+		source->SetSort(TB_SORT_ASCENDING);
+		list->SetValue(2);
+		list->InvokeProcess();
+		TBWidget *widget = list->GetItemWidget(3);
+
+		source->AddItem(new TBGenericStringItem("item 001b", TBIDC("001b")), 50);
+		TB_VERIFY(list->GetItemWidget(3) == widget && widget->GetRect().y == 4 * 20);
+		TB_VERIFY(list->GetItemWidget(50)->GetRect().y == 2 * 20);
+		TB_VERIFY(IsListCorrect());
+
+		source->DeleteItem(0);
+		TB_VERIFY(list->GetItemWidget(2) == widget && widget->GetRect().y == 3 * 20);
+		TB_VERIFY(list->GetValue() == 1);
+		TB_VERIFY(IsListCorrect());
+
+		source->GetItem(49)->str.Set("item 000");
+		source->InvokeItemChanged(49);
+		TB_VERIFY(list->GetItemWidget(49)->GetRect().y == 0);
+		TB_VERIFY(IsListCorrect());
+
+		// The rows of the items are still known after the changes, so the keys move from
+		// the selected item in sort order.
+		list->SetValue(49);
+		TB_VERIFY(list->ChangeValue(TB_KEY_DOWN));
+		TB_VERIFY(list->GetValue() == 0);
+		TB_VERIFY(list->ChangeValue(TB_KEY_DOWN));
+		TB_VERIFY(list->GetValue() == 1);
+		list->SetValue(source->GetNumItems() - 1);
+		TB_VERIFY(list->ChangeValue(TB_KEY_UP));
+		TB_VERIFY(list->GetValue() == source->GetNumItems() - 2);
+	}
+	TB_TEST(sort_temporary_strings)
+	{
+		/** A source returning strings that are only valid until the next call to GetItemString. */
+		class TBTemporaryStringItemSource : public TBGenericStringItemSource
+		{
+		public:
+			virtual const char *GetItemString(int index)
+			{
+				str.Set(TBGenericStringItemSource::GetItemString(index));
+				return str;
+			}
+			TBStr str;
+		};
+		TBTemporaryStringItemSource temporary_source;
+		temporary_source.AddItem(new TBGenericStringItem("c"));
+		temporary_source.AddItem(new TBGenericStringItem("a"));
+		temporary_source.AddItem(new TBGenericStringItem("b"));
+		temporary_source.SetSort(TB_SORT_ASCENDING);
+		TBSelectList temporary_list;
+		temporary_list.SetSource(&temporary_source);
+		temporary_list.SetRect(TBRect(0, 0, 200, 200));
+		temporary_list.InvokeProcess();
+		TB_VERIFY(temporary_list.GetItemWidget(1)->GetNext() == temporary_list.GetItemWidget(2));
+		TB_VERIFY(temporary_list.GetItemWidget(2)->GetNext() == temporary_list.GetItemWidget(0));
+	}
+}
+
+TB_TEST_GROUP(tb_select_filter)
+{
+	/** A source that counts calls to Filter. */
+	class TBCountingItemSource : public TBGenericStringItemSource
+	{
+	public:
+		TBCountingItemSource() : num_filter_calls(0) {}
+		virtual bool Filter(int index, const char *filter)
+		{
+			num_filter_calls++;
+			return TBGenericStringItemSource::Filter(index, filter);
+		}
+		virtual bool IsFilterNarrowing() { return true; }
+		int num_filter_calls;
+	};
+
+	/** A source where Filter matches the start of the strings. */
+	class TBPrefixItemSource : public TBGenericStringItemSource
+	{
+	public:
+		virtual bool Filter(int index, const char *filter)
+		{
+			return strncmp(GetItemString(index), filter, strlen(filter)) == 0;
+		}
+	};
+	TBCountingItemSource source;
+	int result[1100];
+	int expected[1100];
+
+	/** Return true if FilterItems on all items gives the same result as stristr. */
+	bool IsFilterCorrect(const char *filter)
+	{
+		int num_expected = 0;
+		for (int i = 0; i < source.GetNumItems(); i++)
+			if (stristr(source.GetItemString(i), filter))
+				expected[num_expected++] = i;
+		int num_results = source.FilterItems(filter, nullptr, 0, result);
+		return num_results == num_expected && memcmp(result, expected, num_results * sizeof(int)) == 0;
+	}
+
+	/** Return true if FilterItems gives the correct result for some different filters. */
+	bool AreFiltersCorrect()
+	{
+		return IsFilterCorrect("1") && IsFilterCorrect("12") && IsFilterCorrect("Item 12") &&
+			IsFilterCorrect("M 9") && IsFilterCorrect("xyz") && IsFilterCorrect("changed");
+	}
+
+	TB_TEST(Setup)
+	{
+		for (int i = 0; i < 1000; i++)
+		{
+			TBStr str;
+			str.SetFormatted("item %d", i);
+			source.AddItem(new TBGenericStringItem(str, TBID(i + 1)));
+		}
+	}
+	TB_TEST(Cleanup)
+	{
+		source.DeleteAllItems();
+	}
+
+	TB_TEST(filter_items)
+	{
+		TB_VERIFY(AreFiltersCorrect());
+
+		// Candidates are checked in their order.
+		int candidates[4] = { 12, 3, 112, 120 };
+		TB_VERIFY(source.FilterItems("12", candidates, 4, result) == 3);
+		TB_VERIFY(result[0] == 12 && result[1] == 112 && result[2] == 120);
+	}
+	TB_TEST(cache)
+	{
+		source.SetFilterCacheEnabled(true);
+		source.num_filter_calls = 0;
+		TB_VERIFY(AreFiltersCorrect());
+		TB_VERIFY(source.num_filter_calls == 0);
+	}
+	TB_TEST(ngram_index)
+	{
+		source.SetFilterCacheEnabled(true, true);
+		TB_VERIFY(AreFiltersCorrect());
+	}
+	TB_TEST(cache_updates)
+	{
+		source.SetFilterCacheEnabled(true, true);
+		TB_VERIFY(AreFiltersCorrect());
+		source.GetItem(500)->str.Set("changed");
+		source.InvokeItemChanged(500);
+		TB_VERIFY(AreFiltersCorrect());
+		source.AddItem(new TBGenericStringItem("Item 12 added"), 3);
+		TB_VERIFY(AreFiltersCorrect());
+		source.DeleteItem(0);
+		TB_VERIFY(AreFiltersCorrect());
+		source.SetFilterCacheEnabled(false);
+		TB_VERIFY(AreFiltersCorrect());
+	}
+	TB_TEST(list_refilter)
+	{
+		TBSelectList list;
+		list.SetSource(&source);
+		list.SetFilter("1");
+		list.ValidateList();
+		TB_VERIFY(list.GetItemWidget(1) && list.GetItemWidget(991) && !list.GetItemWidget(2));
+
+		// Only the items matching "1" are checked for "12".
+		int num_matching_1 = 0;
+		for (int i = 0; i < source.GetNumItems(); i++)
+			if (stristr(source.GetItemString(i), "1"))
+				num_matching_1++;
+		source.num_filter_calls = 0;
+		list.SetFilter("12");
+		list.ValidateList();
+		TB_VERIFY(source.num_filter_calls == num_matching_1);
+		TB_VERIFY(list.GetItemWidget(12) && list.GetItemWidget(912) && !list.GetItemWidget(1));
+
+		// Other filters check all items.
+		source.num_filter_calls = 0;
+		list.SetFilter("2");
+		list.ValidateList();
+		TB_VERIFY(source.num_filter_calls == source.GetNumItems());
+		TB_VERIFY(list.GetItemWidget(2) && !list.GetItemWidget(1));
+		list.SetSource(nullptr);
+	}
+	TB_TEST(list_refilter_not_narrowing)
+	{
+		// A longer prefix may match items the shorter one didn't, so all items must be checked.
+		TBPrefixItemSource prefix_source;
+		prefix_source.AddItem(new TBGenericStringItem("abc"));
+		prefix_source.AddItem(new TBGenericStringItem("bcd"));
+		TBSelectList list;
+		list.SetSource(&prefix_source);
+		list.SetFilter("b");
+		list.ValidateList();
+		TB_VERIFY(!list.GetItemWidget(0) && list.GetItemWidget(1));
+		list.SetFilter("ab");
+		list.ValidateList();
+		TB_VERIFY(list.GetItemWidget(0) && !list.GetItemWidget(1));
+		list.SetSource(nullptr);
+	}
+	TB_TEST(list_refilter_sorted)
+	{
+		TBSelectList list;
+		source.SetSort(TB_SORT_DESCENDING);
+		list.SetSource(&source);
+		list.SetFilter("9");
+		list.ValidateList();
+		list.SetFilter("99");
+		list.ValidateList();
+		TB_VERIFY(list.GetItemWidget(999) && list.GetItemWidget(999)->GetNext() == list.GetItemWidget(998));
+
+		// Items added while the filter change is pending are found.
+		list.SetFilter("999");
+		source.AddItem(new TBGenericStringItem("new 999"));
+		list.ValidateList();
+		TB_VERIFY(list.GetItemWidget(1000));
+		list.SetSource(nullptr);
+		source.SetSort(TB_SORT_NONE);
+	}
+}
+
+#endif // TB_UNIT_TESTING
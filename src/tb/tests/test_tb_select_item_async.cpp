@@ -0,0 +1,156 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#include "tb_test.h"
+#include "tb_select_item_async.h"
+#include "tb_select.h"
+#include "tb_system.h"
+
+#if defined(TB_UNIT_TESTING) && defined(TB_ASYNC_ITEM_SOURCE)
+
+using namespace tb;
+
+TB_TEST_GROUP(tb_select_item_async)
+{
+	/** Loads items named after their index. Pages starting at fail_index fail to load. */
+	class TBTestPageLoader : public TBAsyncPageLoader
+	{
+	public:
+		TBTestPageLoader() : fail_index(-1) {}
+		virtual bool LoadPage(int first_index, int count, TBAsyncPagedItem *items)
+		{
+			if (first_index == fail_index)
+				return false;
+			for (int i = 0; i < count; i++)
+			{
+				items[i].str.SetFormatted("row %d", first_index + i);
+				items[i].id = first_index + i + 1;
+			}
+			return true;
+		}
+		int fail_index;
+	};
+
+	/** A source loading pages with TBTestPageLoader. */
+	class TBTestPagedItemSource : public TBAsyncPagedItemSource
+	{
+	public:
+		TBTestPagedItemSource(int page_size, int max_cached_pages)
+			: TBAsyncPagedItemSource(new TBTestPageLoader, page_size, max_cached_pages) {}
+		TBTestPageLoader *GetTestLoader() const { return (TBTestPageLoader *) GetLoader(); }
+	};
+
+	/** Process messages until all requested pages are received, or timeout. */
+	bool WaitForPages(TBAsyncPagedItemSource *source)
+	{
+		double timeout = TBSystem::GetTimeMS() + 5000;
+		while (source->GetNumRequestedPages() && TBSystem::GetTimeMS() < timeout)
+			TBMessageHandler::ProcessMessages();
+		return !source->GetNumRequestedPages();
+	}
+
+	TB_TEST(load_page)
+	{
+		TBTestPagedItemSource source(16, 4);
+		source.SetPlaceholderString("...");
+		source.SetNumItems(1000);
+		TB_VERIFY(source.GetNumItems() == 1000);
+		TB_VERIFY_STR(source.GetItemString(100), "...");
+		TB_VERIFY(!source.IsItemLoaded(100));
+		TB_VERIFY(source.GetNumRequestedPages() == 1);
+
+		// Requesting another item in the same page doesn't request it again.
+		source.RequestItem(111);
+		TB_VERIFY(source.GetNumRequestedPages() == 1);
+
+		TB_VERIFY(WaitForPages(&source));
+		TB_VERIFY(source.IsItemLoaded(96) && source.IsItemLoaded(111) && !source.IsItemLoaded(112));
+		TB_VERIFY_STR(source.GetItemString(100), "row 100");
+		TB_VERIFY(source.GetItemID(100) == TBID(101));
+		TB_VERIFY(source.GetNumCachedPages() == 1);
+
+		// The last page is partial.
+		source.RequestItem(999);
+		TB_VERIFY(WaitForPages(&source));
+		TB_VERIFY_STR(source.GetItemString(999), "row 999");
+	}
+	TB_TEST(lru_eviction)
+	{
+		TBTestPagedItemSource source(16, 2);
+		source.SetNumItems(1000);
+		source.RequestItem(0);
+		source.RequestItem(16);
+		TB_VERIFY(WaitForPages(&source));
+		TB_VERIFY(source.GetNumCachedPages() == 2);
+
+		// Use the first page, so the second is the least recently used one.
+		source.GetItemString(0);
+		source.RequestItem(32);
+		TB_VERIFY(WaitForPages(&source));
+		TB_VERIFY(source.GetNumCachedPages() == 2);
+		TB_VERIFY(source.IsItemLoaded(0) && !source.IsItemLoaded(16) && source.IsItemLoaded(32));
+	}
+	TB_TEST(failed_and_invalidated_pages)
+	{
+		TBTestPagedItemSource source(16, 4);
+		source.SetNumItems(1000);
+		source.GetTestLoader()->fail_index = 16;
+		source.RequestItem(16);
+		TB_VERIFY(WaitForPages(&source));
+		TB_VERIFY(!source.IsItemLoaded(16));
+
+		// A failed page is loaded again when requested.
+		source.GetTestLoader()->fail_index = -1;
+		source.RequestItem(16);
+		TB_VERIFY(WaitForPages(&source));
+		TB_VERIFY(source.IsItemLoaded(16));
+
+		source.SetNumItems(10);
+		TB_VERIFY(source.GetNumCachedPages() == 0 && !source.IsItemLoaded(16));
+		source.RequestItem(16);
+		TB_VERIFY(source.GetNumRequestedPages() == 0);
+	}
+	TB_TEST(delete_while_loading)
+	{
+		// The source stops the worker thread before deleting the loader.
+		TBTestPagedItemSource *source = new TBTestPagedItemSource(16, 64);
+		source->SetNumItems(1000);
+		for (int i = 0; i < 1000; i += 16)
+			source->RequestItem(i);
+		TB_VERIFY(source->GetNumRequestedPages() > 0);
+		delete source;
+	}
+	TB_TEST(select_list)
+	{
+		const int num_items = 1000000;
+		const int row_h = 20;
+		TBTestPagedItemSource source(64, 16);
+		source.SetNumItems(num_items);
+		TBSelectList *list = new TBSelectList;
+		list->SetSource(&source);
+		list->SetVirtualized(true, row_h);
+		list->SetRect(TBRect(0, 0, 200, 200));
+		list->InvokeProcess();
+
+		// Only the page of the visible rows is requested, and they show placeholders until it's loaded.
+		TB_VERIFY(source.GetNumRequestedPages() == 1);
+		TBWidget *widget = list->GetItemWidget(0);
+		TB_VERIFY(widget && widget->GetText().IsEmpty());
+		TB_VERIFY(WaitForPages(&source));
+		TB_VERIFY_STR(list->GetItemWidget(0)->GetText(), "row 0");
+
+		list->GetScrollContainer()->ScrollTo(0, 500000 * row_h);
+		list->InvokeProcess();
+		TB_VERIFY(source.GetNumRequestedPages() == 1);
+		TB_VERIFY(WaitForPages(&source));
+		TB_VERIFY((widget = list->GetItemWidget(500000)));
+		TB_VERIFY_STR(widget->GetText(), "row 500000");
+		TB_VERIFY(source.GetNumCachedPages() == 2);
+
+		delete list;
+	}
+}
+
+#endif // TB_UNIT_TESTING && TB_ASYNC_ITEM_SOURCE
@@ -0,0 +1,106 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#include "tb_test.h"
+#include "tb_sort.h"
+
+#ifdef TB_UNIT_TESTING
+
+using namespace tb;
+
+TB_TEST_GROUP(tb_sort)
+{
+	/** Elements to sort. Only key is compared, so order can verify stability. */
+	struct ELEMENT
+	{
+		int key;
+		int order;
+	};
+
+	ELEMENT elements[5000];
+	int num_get_key;
+
+	static int cmp(void *context, const ELEMENT *a, const ELEMENT *b) { return a->key - b->key; }
+	static int get_key(int *num_calls, const ELEMENT *element) { (*num_calls)++; return element->key; }
+	static int cmp_key(int *num_calls, const int *a, const int *b) { return *a - *b; }
+
+	/** Set the keys with a pseudo random sequence in the range [0, range). */
+	void SetRandomKeys(int count, int range)
+	{
+		unsigned int seed = 1;
+		for (int i = 0; i < count; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			elements[i].key = (seed >> 16) % range;
+			elements[i].order = i;
+		}
+	}
+
+	/** Set the order of elements to their current position. */
+	void SetOrder(int count)
+	{
+		for (int i = 0; i < count; i++)
+			elements[i].order = i;
+	}
+
+	/** Return true if elements are sorted by key, and by order for equal keys. */
+	bool IsSortedStable(int count)
+	{
+		for (int i = 1; i < count; i++)
+			if (elements[i].key < elements[i - 1].key ||
+				(elements[i].key == elements[i - 1].key && elements[i].order < elements[i - 1].order))
+				return false;
+		return true;
+	}
+
+	TB_TEST(random)
+	{
+		SetRandomKeys(5000, 100000);
+		merge_sort<void *, ELEMENT>(elements, 5000, nullptr, cmp);
+		TB_VERIFY(IsSortedStable(5000));
+	}
+	TB_TEST(stable)
+	{
+		// Many equal keys.
+		SetRandomKeys(5000, 10);
+		merge_sort<void *, ELEMENT>(elements, 5000, nullptr, cmp);
+		TB_VERIFY(IsSortedStable(5000));
+	}
+	TB_TEST(few_elements)
+	{
+		for (int count = 0; count < 70; count++)
+		{
+			SetRandomKeys(count, 5);
+			merge_sort<void *, ELEMENT>(elements, count, nullptr, cmp);
+			TB_VERIFY(IsSortedStable(count));
+		}
+	}
+	TB_TEST(runs)
+	{
+		// Ascending and descending runs, with equal keys in the descending ones.
+		for (int i = 0; i < 5000; i++)
+			elements[i].key = (i / 1000) % 2 ? 1000 - (i % 1000) / 2 : i % 1000;
+		SetOrder(5000);
+		merge_sort<void *, ELEMENT>(elements, 5000, nullptr, cmp);
+		TB_VERIFY(IsSortedStable(5000));
+
+		// Reverse order
+		for (int i = 0; i < 5000; i++)
+			elements[i].key = 5000 - i;
+		SetOrder(5000);
+		merge_sort<void *, ELEMENT>(elements, 5000, nullptr, cmp);
+		TB_VERIFY(IsSortedStable(5000));
+	}
+	TB_TEST(by_key)
+	{
+		SetRandomKeys(5000, 50);
+		num_get_key = 0;
+		TB_VERIFY((merge_sort_by_key<int *, ELEMENT, int>(elements, 5000, &num_get_key, get_key, cmp_key)));
+		TB_VERIFY(IsSortedStable(5000));
+		TB_VERIFY(num_get_key == 5000);
+	}
+}
+
+#endif // TB_UNIT_TESTING
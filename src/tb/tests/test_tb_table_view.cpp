@@ -0,0 +1,213 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#include "tb_test.h"
+#include "tb_table_view.h"
+#include "tb_renderer.h"
+
+#ifdef TB_UNIT_TESTING
+
+using namespace tb;
+
+TB_TEST_GROUP(tb_table_view)
+{
+	/** A table with a name column and a number column, where the number of each row
+		is the reverse of its index. Counts the cell strings asked for, and the ones
+		asked for without being prepared by PrepareColumn. */
+	class TBTestTableSource : public TBTableSource
+	{
+	public:
+		TBTestTableSource(int num_rows) : num_rows(num_rows), num_cells_read(0), num_unprepared_cells_read(0)
+			, num_prepare_calls(0), prepared_column(-1), prepared_rows(nullptr), num_prepared_rows(0) {}
+		virtual int GetNumRows() { return num_rows; }
+		virtual int GetNumColumns() { return 2; }
+		virtual const char *GetColumnTitle(int column) { return column ? "Number" : "Name"; }
+		virtual const char *GetCellString(int column, int row)
+		{
+			num_cells_read++;
+			bool prepared = false;
+			for (int i = 0; i < num_prepared_rows && column == prepared_column; i++)
+				prepared |= prepared_rows[i] == row;
+			if (!prepared)
+				num_unprepared_cells_read++;
+			str.SetFormatted(column ? "%d" : "row %d", column ? GetNumber(row) : row);
+			return str;
+		}
+		virtual int CompareCells(int column, int row_a, int row_b)
+		{
+			return column ? GetNumber(row_a) - GetNumber(row_b) : row_a - row_b;
+		}
+		virtual void PrepareColumn(int column, const int *rows, int num_rows)
+		{
+			num_prepare_calls++;
+			prepared_column = column;
+			prepared_rows = rows;
+			num_prepared_rows = num_rows;
+		}
+		int GetNumber(int row) const { return num_rows - row; }
+		int num_rows;
+		int num_cells_read;
+		int num_unprepared_cells_read;
+		int num_prepare_calls;
+		int prepared_column;
+		const int *prepared_rows;
+		int num_prepared_rows;
+		TBStr str;
+	};
+
+	const int row_h = 20;
+	const int column_w = 100;
+	TBTestTableSource *source;
+	TBTableView *table;
+
+	TB_TEST(Setup)
+	{
+		source = new TBTestTableSource(1000000);
+		table = new TBTableView;
+		table->SetSource(source);
+		table->SetRowHeight(row_h);
+		table->SetDefaultColumnWidth(column_w);
+		table->SetRect(TBRect(0, 0, 300, 200));
+	}
+	TB_TEST(Cleanup)
+	{
+		delete table;
+		delete source;
+	}
+
+	TB_TEST(scroll_range)
+	{
+		TBRect padding_rect = table->GetPaddingRect();
+		TBWidget::ScrollInfo info = table->GetScrollInfo();
+		TB_VERIFY(info.max_x == 0);
+		TB_VERIFY(info.max_y > 0);
+		TB_VERIFY(info.max_y + padding_rect.h - row_h == 1000000 * row_h);
+
+		table->ScrollTo(0, 500000 * row_h);
+		TB_VERIFY(table->GetScrollInfo().y == 500000 * row_h);
+		TB_VERIFY(table->GetRowAtPoint(padding_rect.x + 10, padding_rect.y + row_h + 5) == 500000);
+		TB_VERIFY(table->GetRowAtPoint(padding_rect.x + 10, padding_rect.y + 5) == -1); // Header
+		table->ScrollTo(0, 0);
+	}
+	TB_TEST(sort)
+	{
+		TB_VERIFY(table->GetRowAtPosition(0) == 0);
+		table->SetSort(1, TB_SORT_ASCENDING);
+		TB_VERIFY(table->GetRowAtPosition(0) == 999999);
+		TB_VERIFY(table->GetRowAtPosition(999999) == 0);
+		TB_VERIFY(table->GetPositionOfRow(10) == 999989);
+
+		table->SetSort(1, TB_SORT_DESCENDING);
+		TB_VERIFY(table->GetRowAtPosition(0) == 0);
+
+		// The position of a row is looked up without searching, so check all of them.
+		table->SetSort(0, TB_SORT_DESCENDING);
+		for (int position = 0; position < 1000000; position++)
+			TB_VERIFY(table->GetPositionOfRow(table->GetRowAtPosition(position)) == position);
+		TB_VERIFY(table->GetPositionOfRow(1000000) == -1);
+
+		table->SetSort(-1, TB_SORT_ASCENDING);
+		TB_VERIFY(table->GetSort() == TB_SORT_NONE);
+		TB_VERIFY(table->GetRowAtPosition(999999) == 999999);
+	}
+	TB_TEST(selection)
+	{
+		table->SetValue(20);
+		TB_VERIFY(table->GetValue() == 20);
+
+		// Moving down selects the next row in sort order.
+		table->SetSort(1, TB_SORT_ASCENDING);
+		TBWidgetEvent ev(EVENT_TYPE_KEY_DOWN);
+		ev.special_key = TB_KEY_DOWN;
+		TB_VERIFY(table->InvokeEvent(ev));
+		TB_VERIFY(table->GetValue() == 19);
+
+		// The selected row is scrolled into view.
+		ev.special_key = TB_KEY_HOME;
+		table->InvokeEvent(ev);
+		TB_VERIFY(table->GetValue() == 999999);
+		TB_VERIFY(table->GetScrollInfo().y == 0);
+		ev.special_key = TB_KEY_END;
+		table->InvokeEvent(ev);
+		TB_VERIFY(table->GetValue() == 0);
+		TB_VERIFY(table->GetScrollInfo().y == table->GetScrollInfo().max_y);
+
+		table->SetSort(-1, TB_SORT_NONE);
+		table->SetValue(-1);
+		table->ScrollTo(0, 0);
+	}
+	TB_TEST(sort_and_resize_with_pointer)
+	{
+		// Pointer events go to the widget at the pointer in a root, which deletes the view.
+		TBWidget root;
+		root.SetRect(TBRect(0, 0, 300, 200));
+		TBTableView *view = new TBTableView;
+		root.AddChild(view);
+		view->SetSource(source);
+		view->SetRowHeight(row_h);
+		view->SetDefaultColumnWidth(column_w);
+		view->SetRect(root.GetRect());
+		TBRect padding_rect = view->GetPaddingRect();
+		const int header_y = padding_rect.y + row_h / 2;
+
+		// Clicking a header sorts by the column, ascending first.
+		root.InvokePointerDown(padding_rect.x + column_w + 50, header_y, 1, TB_MODIFIER_NONE, false);
+		root.InvokePointerUp(padding_rect.x + column_w + 50, header_y, TB_MODIFIER_NONE, false);
+		TB_VERIFY(view->GetSortColumn() == 1 && view->GetSort() == TB_SORT_ASCENDING);
+		root.InvokePointerDown(padding_rect.x + column_w + 50, header_y, 1, TB_MODIFIER_NONE, false);
+		root.InvokePointerUp(padding_rect.x + column_w + 50, header_y, TB_MODIFIER_NONE, false);
+		TB_VERIFY(view->GetSortColumn() == 1 && view->GetSort() == TB_SORT_DESCENDING);
+
+		// Dragging the edge of a header resizes the column, which makes the columns too wide to fit.
+		const int edge_x = padding_rect.x + column_w;
+		root.InvokePointerDown(edge_x, header_y, 1, TB_MODIFIER_NONE, false);
+		root.InvokePointerMove(edge_x + 150, header_y, TB_MODIFIER_NONE, false);
+		root.InvokePointerUp(edge_x + 150, header_y, TB_MODIFIER_NONE, false);
+		TB_VERIFY(view->GetColumnWidth(0) == column_w + 150);
+		TB_VERIFY(view->GetColumnWidth(1) == column_w);
+		TB_VERIFY(view->GetScrollInfo().max_x > 0);
+		TB_VERIFY(view->GetSortColumn() == 1 && view->GetSort() == TB_SORT_DESCENDING);
+
+		view->SetColumnWidth(0, 0);
+		TB_VERIFY(view->GetColumnWidth(0) == column_w);
+		TB_VERIFY(view->GetScrollInfo().max_x == 0);
+
+		// Clicking a row selects it.
+		root.InvokePointerDown(padding_rect.x + 10, padding_rect.y + row_h * 3 + 5, 1, TB_MODIFIER_NONE, false);
+		root.InvokePointerUp(padding_rect.x + 10, padding_rect.y + row_h * 3 + 5, TB_MODIFIER_NONE, false);
+		TB_VERIFY(view->GetValue() == view->GetRowAtPosition(2));
+	}
+	TB_TEST(paint)
+	{
+		table->SetSort(1, TB_SORT_ASCENDING);
+		source->num_cells_read = 0;
+		g_renderer->BeginPaint(300, 200);
+		table->InvokePaint(TBWidget::PaintProps());
+		g_renderer->EndPaint();
+
+		// Each column is prepared once, with the rows in view in sort order.
+		TB_VERIFY(source->num_prepare_calls == 2);
+		TB_VERIFY(source->num_cells_read == source->num_prepared_rows * 2);
+		TB_VERIFY(source->num_prepared_rows > 0 && source->num_unprepared_cells_read == 0);
+
+		// The rows were on the stack of the paint.
+		source->prepared_rows = nullptr;
+		source->num_prepared_rows = 0;
+		table->SetSort(-1, TB_SORT_NONE);
+	}
+	TB_TEST(rows_changed)
+	{
+		table->SetValue(999999);
+		source->num_rows = 5;
+		source->InvokeRowsChanged();
+		TB_VERIFY(table->GetValue() == -1);
+		TB_VERIFY(table->GetScrollInfo().max_y == 0);
+		TB_VERIFY(table->GetRowAtPosition(5) == -1);
+		source->num_rows = 1000000;
+		source->InvokeRowsChanged();
+	}
+}
+
+#endif // TB_UNIT_TESTING
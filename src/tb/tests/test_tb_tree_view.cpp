@@ -0,0 +1,207 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#include "tb_test.h"
+#include "tb_tree_view.h"
+#include "tb_widgets_listener.h"
+
+#ifdef TB_UNIT_TESTING
+
+using namespace tb;
+
+TB_TEST_GROUP(tb_tree_view)
+{
+	/** A tree with 3 nodes in the root. The second has 50000 children, and all other nodes
+		down to depth 1 have 2 children. The handle of a node is a number with 16 bits for
+		the index + 1 on each level. Counts the nodes asked for. */
+	class TBTestTreeSource : public TBTreeSource
+	{
+	public:
+		TBTestTreeSource() : num_nodes_read(0) {}
+		static void *Node(void *parent, int index) { return (void *) ((((size_t) parent) << 16) + index + 1); }
+		static int Depth(void *node) { size_t id = (size_t) node; int depth = -1; for (; id; id >>= 16) depth++; return depth; }
+		virtual int GetNumChildren(void *node)
+		{
+			if (!node)
+				return 3;
+			if (node == Node(nullptr, 1))
+				return 50000;
+			return Depth(node) < 2 ? 2 : 0;
+		}
+		virtual void *GetChild(void *node, int index) { num_nodes_read++; return Node(node, index); }
+		virtual const char *GetNodeString(void *node) { return "node"; }
+		int num_nodes_read;
+	};
+
+	const int row_h = 20;
+	TBTestTreeSource *source;
+	TBTreeView *tree;
+
+	TB_TEST(Setup)
+	{
+		source = new TBTestTreeSource;
+		tree = new TBTreeView;
+		tree->SetSource(source);
+		tree->SetRowHeight(row_h);
+		tree->SetRect(TBRect(0, 0, 200, 200));
+	}
+	TB_TEST(Cleanup)
+	{
+		delete tree;
+		delete source;
+	}
+
+	TB_TEST(expand_and_collapse)
+	{
+		void *first = TBTestTreeSource::Node(nullptr, 0);
+		TB_VERIFY(tree->GetNumRows() == 3);
+		TB_VERIFY(!tree->GetExpanded(0));
+		TB_VERIFY(tree->SetExpanded(0, true));
+		TB_VERIFY(tree->GetExpanded(0));
+		TB_VERIFY(tree->GetNumRows() == 5);
+		TB_VERIFY(tree->GetNodeAtRow(1) == TBTestTreeSource::Node(first, 0));
+		TB_VERIFY(tree->GetNodeAtRow(3) == TBTestTreeSource::Node(nullptr, 1));
+		TB_VERIFY(tree->GetRowDepth(2) == 1 && tree->GetRowDepth(3) == 0);
+		TB_VERIFY(tree->GetParentRow(2) == 0 && tree->GetParentRow(3) == -1);
+		TB_VERIFY(!tree->GetExpanded(1) && !tree->GetExpanded(3));
+
+		// Expand a child, and a leaf which can't be expanded.
+		TB_VERIFY(tree->SetExpanded(2, true));
+		TB_VERIFY(tree->GetNumRows() == 7);
+		TB_VERIFY(tree->GetParentRow(4) == 2);
+		TB_VERIFY(!tree->SetExpanded(4, true));
+		TB_VERIFY(tree->GetNodeAtRow(5) == TBTestTreeSource::Node(nullptr, 1));
+
+		// Collapsing forgets the expanded nodes below.
+		TB_VERIFY(tree->SetExpanded(0, false));
+		TB_VERIFY(tree->GetNumRows() == 3 && !tree->GetExpanded(0));
+		TB_VERIFY(tree->GetNodeAtRow(1) == TBTestTreeSource::Node(nullptr, 1));
+		TB_VERIFY(tree->SetExpanded(0, true));
+		TB_VERIFY(tree->GetNumRows() == 5 && !tree->GetExpanded(2));
+		tree->SetExpanded(0, false);
+	}
+	TB_TEST(large_folder)
+	{
+		void *folder = TBTestTreeSource::Node(nullptr, 1);
+
+		// Expanding only asks for the nodes of the rows in view.
+		source->num_nodes_read = 0;
+		TB_VERIFY(tree->SetExpanded(1, true));
+		TB_VERIFY(source->num_nodes_read < 50);
+		TB_VERIFY(tree->GetNumRows() == 50003);
+		TB_VERIFY(tree->GetNodeAtRow(50001) == TBTestTreeSource::Node(folder, 49999));
+		TB_VERIFY(tree->GetNodeAtRow(50002) == TBTestTreeSource::Node(nullptr, 2));
+		tree->InvokeProcess();
+		TB_VERIFY(tree->GetScrollContainer()->GetScrollInfo().max_y == 50003 * row_h - tree->GetScrollContainer()->GetPaddingRect().h);
+
+		// Expand a node in the middle of the folder.
+		TB_VERIFY(tree->SetExpanded(102, true));
+		TB_VERIFY(tree->GetNumRows() == 50005);
+		TB_VERIFY(tree->GetNodeAtRow(103) == TBTestTreeSource::Node(TBTestTreeSource::Node(folder, 100), 0));
+		TB_VERIFY(tree->GetNodeAtRow(105) == TBTestTreeSource::Node(folder, 101));
+		TB_VERIFY(tree->GetParentRow(105) == 1);
+		TB_VERIFY(tree->GetParentRow(104) == 102);
+
+		// Only the rows in view have widgets.
+		tree->InvokeProcess();
+		tree->ScrollToRow(40000);
+		TB_VERIFY(tree->GetRowWidget(40000));
+		TB_VERIFY(!tree->GetRowWidget(0));
+		source->num_nodes_read = 0;
+		tree->SetExpanded(102, false);
+		TB_VERIFY(source->num_nodes_read < 50);
+		TB_VERIFY(tree->GetNodeAtRow(103) == TBTestTreeSource::Node(folder, 101));
+
+		tree->SetExpanded(1, false);
+		tree->InvokeProcess();
+		TB_VERIFY(tree->GetNumRows() == 3);
+		TB_VERIFY(tree->GetScrollContainer()->GetScrollInfo().y == 0);
+	}
+	TB_TEST(selection)
+	{
+		// The selected node stays selected when rows above it are expanded and collapsed.
+		tree->SetValue(2);
+		TB_VERIFY(tree->SetExpanded(1, true));
+		TB_VERIFY(tree->GetValue() == 50002);
+		TB_VERIFY(tree->GetSelectedNode() == TBTestTreeSource::Node(nullptr, 2));
+		TB_VERIFY(tree->SetExpanded(1, false));
+		TB_VERIFY(tree->GetValue() == 2);
+
+		// Collapsing the parent of the selected node selects the parent.
+		tree->SetExpanded(0, true);
+		tree->SetValue(2);
+		tree->SetExpanded(0, false);
+		TB_VERIFY(tree->GetValue() == 0);
+
+		// The arrow keys move the selection, and expand and collapse nodes.
+		TBWidgetEvent ev(EVENT_TYPE_KEY_DOWN);
+		ev.special_key = TB_KEY_RIGHT;
+		TB_VERIFY(tree->InvokeEvent(ev));
+		TB_VERIFY(tree->GetExpanded(0) && tree->GetValue() == 0);
+		TB_VERIFY(tree->InvokeEvent(ev));
+		TB_VERIFY(tree->GetValue() == 1);
+		ev.special_key = TB_KEY_DOWN;
+		TB_VERIFY(tree->InvokeEvent(ev));
+		TB_VERIFY(tree->GetValue() == 2);
+		ev.special_key = TB_KEY_LEFT;
+		TB_VERIFY(tree->InvokeEvent(ev));
+		TB_VERIFY(tree->GetValue() == 0);
+		TB_VERIFY(tree->InvokeEvent(ev));
+		TB_VERIFY(!tree->GetExpanded(0));
+		ev.special_key = TB_KEY_END;
+		TB_VERIFY(tree->InvokeEvent(ev));
+		TB_VERIFY(tree->GetValue() == 2);
+		tree->SetValue(-1);
+	}
+	TB_TEST(tree_changed)
+	{
+		tree->SetExpanded(0, true);
+		tree->SetValue(1);
+		source->InvokeTreeChanged();
+		TB_VERIFY(tree->GetNumRows() == 3);
+		TB_VERIFY(tree->GetValue() == -1 && !tree->GetExpanded(0));
+	}
+	TB_TEST(measured_row_height)
+	{
+		/** Counts the widgets added to the given tree. */
+		class TBAddedWidgetsListener : public TBWidgetListener
+		{
+		public:
+			TBAddedWidgetsListener(TBWidget *tree) : tree(tree), num_added(0) {}
+			virtual void OnWidgetAdded(TBWidget *parent, TBWidget *child)
+			{
+				if (tree->IsAncestorOf(parent))
+					num_added++;
+			}
+			TBWidget *tree;
+			int num_added;
+		};
+		TBTreeView *measured_tree = new TBTreeView;
+		TBAddedWidgetsListener listener(measured_tree);
+		TBWidgetListener::AddGlobalListener(&listener);
+
+		// The row is measured without adding it to the tree.
+		const int height = measured_tree->GetRowHeight();
+		const int num_added_measuring = listener.num_added;
+
+		TBFontDescription fd = measured_tree->GetCalculatedFontDescription();
+		fd.SetSize(fd.GetSize() * 2);
+		measured_tree->SetFontDescription(fd);
+		const int large_height = measured_tree->GetRowHeight();
+
+		// Deleting the tree doesn't create rows for it.
+		measured_tree->SetSource(source);
+		measured_tree->SetFontDescription(TBFontDescription());
+		listener.num_added = 0;
+		delete measured_tree;
+		TBWidgetListener::RemoveGlobalListener(&listener);
+
+		TB_VERIFY(height > 1 && num_added_measuring == 0);
+		TB_VERIFY(large_height > height);
+		TB_VERIFY(listener.num_added == 0);
+	}
+}
+
+#endif // TB_UNIT_TESTING
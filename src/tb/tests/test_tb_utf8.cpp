@@ -0,0 +1,88 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#include "tb_test.h"
+#include "utf8/utf8.h"
+
+#ifdef TB_UNIT_TESTING
+
+using namespace tb;
+
+TB_TEST_GROUP(tb_utf8)
+{
+	/** Return true if decode_span produce the same characters as decode_next
+		when decoding str in spans of at most span_size characters. */
+	bool DecodeSpanEqualsDecodeNext(const char *str, int len, int span_size)
+	{
+		UCS4 span[64];
+		int span_i = 0;
+		int next_i = 0;
+		while (int num = utf8::decode_span(str, &span_i, len, span, span_size))
+		{
+			for (int c = 0; c < num; c++)
+			{
+				if (!str[next_i] || next_i >= len)
+					return false;
+				if (utf8::decode_next(str, &next_i, len) != span[c])
+					return false;
+			}
+			if (span_i != next_i)
+				return false;
+		}
+		return !str[next_i] || next_i >= len;
+	}
+
+	TB_TEST(decode_span_ascii)
+	{
+		const char *str = "The quick brown fox jumps over the lazy dog. The quick brown fox jumps over the lazy dog.";
+		TB_VERIFY(DecodeSpanEqualsDecodeNext(str, TB_ALL_TO_TERMINATION, 64));
+		TB_VERIFY(DecodeSpanEqualsDecodeNext(str, TB_ALL_TO_TERMINATION, 5));
+		TB_VERIFY(DecodeSpanEqualsDecodeNext(str, 40, 64));
+		TB_VERIFY(DecodeSpanEqualsDecodeNext(str + 3, 33, 16));
+
+		UCS4 span[64];
+		int i = 0;
+		TB_VERIFY(utf8::decode_span(str, &i, 10, span, 64) == 10);
+		TB_VERIFY(span[0] == 'T' && span[8] == 'k');
+		TB_VERIFY(i == 10);
+	}
+	TB_TEST(decode_span_mixed)
+	{
+		const char *str = "Some ASCII before åäö and after. \xe2\x80\xa2 bullet, \xf0\x9f\x98\x80 and more ASCII to make a long run.";
+		TB_VERIFY(DecodeSpanEqualsDecodeNext(str, TB_ALL_TO_TERMINATION, 64));
+		TB_VERIFY(DecodeSpanEqualsDecodeNext(str, TB_ALL_TO_TERMINATION, 1));
+		TB_VERIFY(DecodeSpanEqualsDecodeNext(str, TB_ALL_TO_TERMINATION, 7));
+		// Cut in the middle of a multibyte character
+		TB_VERIFY(DecodeSpanEqualsDecodeNext(str, 20, 64));
+	}
+	TB_TEST(decode_span_invalid)
+	{
+		// Stray continuation bytes and truncated sequences should decode to 0xFFFF and skip one byte.
+		const char *str = "abc\x80\x80 def \xc3 ghi \xe2\x80 jkl";
+		TB_VERIFY(DecodeSpanEqualsDecodeNext(str, TB_ALL_TO_TERMINATION, 64));
+
+		UCS4 span[64];
+		int i = 0;
+		TB_VERIFY(utf8::decode_span(str, &i, TB_ALL_TO_TERMINATION, span, 64) == 22);
+		TB_VERIFY(span[3] == 0xFFFF && span[4] == 0xFFFF && span[5] == ' ');
+	}
+	TB_TEST(decode_span_null_termination)
+	{
+		const char str[] = "abc\0def";
+		UCS4 span[64];
+		int i = 0;
+		TB_VERIFY(utf8::decode_span(str, &i, sizeof(str), span, 64) == 3);
+		TB_VERIFY(utf8::decode_span(str, &i, sizeof(str), span, 64) == 0);
+	}
+	TB_TEST(count_characters)
+	{
+		TB_VERIFY(utf8::count_characters("The quick brown fox jumps over the lazy dog.", TB_ALL_TO_TERMINATION) == 44);
+		TB_VERIFY(utf8::count_characters("åäö and some ASCII", TB_ALL_TO_TERMINATION) == 18);
+		TB_VERIFY(utf8::count_characters("åäö and some ASCII", 6) == 3);
+		TB_VERIFY(utf8::count_characters("abc\x80 def", TB_ALL_TO_TERMINATION) == 8);
+	}
+}
+
+#endif // TB_UNIT_TESTING
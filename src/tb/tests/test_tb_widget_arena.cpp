@@ -0,0 +1,85 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#include "tb_test.h"
+#include "tb_widget_arena.h"
+#include "tb_widgets_reader.h"
+#include "tb_window.h"
+#include "tb_core.h"
+
+#ifdef TB_UNIT_TESTING
+
+using namespace tb;
+
+TB_TEST_GROUP(tb_widget_arena)
+{
+	TB_TEST(scope)
+	{
+		TBWidgetArena *arena = new TBWidgetArena;
+		TBWidget *heap_widget = new TBWidget;
+		TBWidget *arena_widget;
+		{
+			TBWidgetArenaScope arena_scope(arena);
+			TB_VERIFY(TBWidgetArena::GetCurrent() == arena);
+			arena_widget = new TBButton;
+			arena_widget->SetGroupID(TBIDC("group")); // Allocates the extension too.
+			{
+				TBWidgetArenaScope heap_scope(nullptr);
+				TBWidget *widget = new TBWidget;
+				TB_VERIFY(TBWidgetArena::Find(widget) == nullptr);
+				delete widget;
+			}
+		}
+		TB_VERIFY(TBWidgetArena::GetCurrent() == nullptr);
+		TB_VERIFY(TBWidgetArena::Find(heap_widget) == nullptr);
+		TB_VERIFY(TBWidgetArena::Find(arena_widget) == arena);
+		TB_VERIFY(arena->GetNumAllocations() == 2);
+
+		heap_widget->AddChild(arena_widget);
+		delete heap_widget;
+		TB_VERIFY(arena->GetNumAllocations() == 0);
+		arena->Release();
+	}
+	TB_TEST(released_while_used)
+	{
+		TBWidgetArena *arena = new TBWidgetArena;
+		TBWidget *widget;
+		{
+			TBWidgetArenaScope arena_scope(arena);
+			widget = new TBWidget;
+		}
+		// The arena must stay alive until the widget is deleted.
+		arena->Release();
+		TB_VERIFY(TBWidgetArena::Find(widget) == arena);
+		widget->SetText("still usable");
+		delete widget;
+	}
+	TB_TEST(window)
+	{
+		TBWindow *window = new TBWindow;
+		TB_VERIFY(window->SetArenaEnabled(true));
+		TB_VERIFY(window->GetArena());
+		g_widgets_reader->LoadData(window,
+			"TBLayout: axis: y\n"
+			"	TBButton: text: \"Button\", id: \"button\"\n"
+			"		lp: width: 100\n"
+			"	TBEditField: id: \"edit\"\n");
+		TBWidget *button = window->GetWidgetByID(TBIDC("button"));
+		TBWidget *edit = window->GetWidgetByID(TBIDC("edit"));
+		TB_VERIFY(button && edit);
+		TB_VERIFY(TBWidgetArena::Find(button) == window->GetArena());
+		TB_VERIFY(TBWidgetArena::Find(edit) == window->GetArena());
+		TB_VERIFY(button->GetLayoutParams() && button->GetLayoutParams()->pref_w == 100);
+
+		// Widgets created outside of inflation are allocated from the heap.
+		TBWidget *widget = new TBWidget;
+		TB_VERIFY(TBWidgetArena::Find(widget) == nullptr);
+		window->AddChild(widget);
+
+		delete window;
+	}
+}
+
+#endif // TB_UNIT_TESTING
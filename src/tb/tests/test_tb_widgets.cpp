@@ -0,0 +1,817 @@
+// ================================================================================
+// ==      This file is a part of Turbo Badger. (C) 2011-2014, Emil Segerås      ==
+// ==                     See tb_core.h for more information.                    ==
+// ================================================================================
+
+#include "tb_test.h"
+#include "tb_widgets.h"
+#include "tb_widgets_common.h"
+#include "tb_widgets_listener.h"
+#include "tb_layout.h"
+#include "tb_editfield.h"
+#include "tb_tab_container.h"
+#include "tb_skin.h"
+#include "tb_font_renderer.h"
+#include "tb_node_tree.h"
+
+#ifdef TB_UNIT_TESTING
+
+using namespace tb;
+
+TB_TEST_GROUP(tb_widgets_id_index)
+{
+	TBWidget *root;
+	TBWidget *a, *a1, *a2, *b, *b1;
+
+	TB_TEST(Setup)
+	{
+		// root
+		//   a     (id "a")
+		//     a1  (id "x")
+		//     a2  (id "y")
+		//   b     (id "b")
+		//     b1  (id "x", TBButton)
+		TB_VERIFY(root = new TBWidget);
+		a = new TBWidget;
+		a1 = new TBWidget;
+		a2 = new TBWidget;
+		b = new TBWidget;
+		b1 = new TBButton;
+		a->SetID(TBIDC("a"));
+		a1->SetID(TBIDC("x"));
+		a2->SetID(TBIDC("y"));
+		b->SetID(TBIDC("b"));
+		b1->SetID(TBIDC("x"));
+		root->AddChild(a);
+		a->AddChild(a1);
+		a->AddChild(a2);
+		root->AddChild(b);
+		TB_VERIFY(root->SetIDIndexEnabled(true));
+		// Add after enabling the index, so both paths are covered.
+		b->AddChild(b1);
+	}
+	TB_TEST(Cleanup)
+	{
+		delete root;
+	}
+
+	TB_TEST(lookup)
+	{
+		TB_VERIFY(root->GetWidgetByID(TBIDC("a")) == a);
+		TB_VERIFY(root->GetWidgetByID(TBIDC("y")) == a2);
+		TB_VERIFY(root->GetWidgetByID(TBIDC("b")) == b);
+		TB_VERIFY(!root->GetWidgetByID(TBIDC("nothing")));
+	}
+	TB_TEST(first_match_in_tree_order)
+	{
+		TB_VERIFY(root->GetWidgetByID(TBIDC("x")) == a1);
+		TB_VERIFY(root->GetWidgetByIDAndType<TBButton>(TBIDC("x")) == b1);
+
+		// Changing z order changes the tree order.
+		b->SetZ(WIDGET_Z_BOTTOM);
+		TB_VERIFY(root->GetWidgetByID(TBIDC("x")) == b1);
+		b->SetZ(WIDGET_Z_TOP);
+		TB_VERIFY(root->GetWidgetByID(TBIDC("x")) == a1);
+	}
+	TB_TEST(lookup_in_subtree)
+	{
+		TB_VERIFY(b->GetWidgetByID(TBIDC("x")) == b1);
+		TB_VERIFY(!b->GetWidgetByID(TBIDC("y")));
+		TB_VERIFY(a->GetWidgetByID(TBIDC("a")) == a);
+	}
+	TB_TEST(set_id)
+	{
+		a2->SetID(TBIDC("z"));
+		TB_VERIFY(!root->GetWidgetByID(TBIDC("y")));
+		TB_VERIFY(root->GetWidgetByID(TBIDC("z")) == a2);
+		a2->SetID(TBIDC("y"));
+		TB_VERIFY(root->GetWidgetByID(TBIDC("y")) == a2);
+	}
+	TB_TEST(remove_and_add)
+	{
+		root->RemoveChild(a);
+		TB_VERIFY(root->GetWidgetByID(TBIDC("x")) == b1);
+		TB_VERIFY(!root->GetWidgetByID(TBIDC("y")));
+		// The detached subtree is searched without index.
+		TB_VERIFY(a->GetWidgetByID(TBIDC("y")) == a2);
+		root->AddChild(a, WIDGET_Z_BOTTOM);
+		TB_VERIFY(root->GetWidgetByID(TBIDC("x")) == a1);
+		TB_VERIFY(root->GetWidgetByID(TBIDC("y")) == a2);
+	}
+}
+
+TB_TEST_GROUP(tb_widgets_spatial_index)
+{
+	TBWidget *root;
+
+	/** Return the child at x, y with a linear search over all children. */
+	TBWidget *GetChildAtLinear(int x, int y)
+	{
+		TBWidget *match = nullptr;
+		for (TBWidget *child = root->GetFirstChild(); child; child = child->GetNext())
+			if (child->GetHitStatus(x - child->GetRect().x, y - child->GetRect().y))
+				match = child;
+		return match;
+	}
+
+	/** Return true if GetWidgetAt gives the same result as a linear search everywhere. */
+	bool HitTestMatchesLinear()
+	{
+		for (int y = -5; y < 420; y += 3)
+			for (int x = -5; x < 420; x += 3)
+				if (root->GetWidgetAt(x, y, false) != GetChildAtLinear(x, y))
+					return false;
+		return true;
+	}
+
+	TB_TEST(Setup)
+	{
+		TB_VERIFY(root = new TBWidget);
+		root->SetRect(TBRect(0, 0, 400, 400));
+		// A grid of children, and some larger ones overlapping them.
+		for (int i = 0; i < 400; i++)
+		{
+			TBWidget *child = new TBWidget;
+			child->SetRect(TBRect((i % 20) * 20, (i / 20) * 20, 18, 18));
+			root->AddChild(child);
+			if (i % 37 == 0)
+			{
+				TBWidget *large = new TBWidget;
+				large->SetRect(TBRect((i % 20) * 20 + 5, (i / 20) * 20 + 5, 70, 50));
+				root->AddChild(large);
+			}
+		}
+		TB_VERIFY(root->SetSpatialIndexEnabled(true));
+	}
+	TB_TEST(Cleanup)
+	{
+		delete root;
+	}
+
+	TB_TEST(hit_test)
+	{
+		TB_VERIFY(HitTestMatchesLinear());
+	}
+	TB_TEST(hit_test_after_changes)
+	{
+		TBWidget *first = root->GetFirstChild();
+		first->SetRect(TBRect(300, 300, 40, 40));
+		root->GetLastChild()->SetZ(WIDGET_Z_BOTTOM);
+		TB_VERIFY(HitTestMatchesLinear());
+
+		root->RemoveChild(first);
+		delete first;
+		TBWidget *added = new TBWidget;
+		added->SetRect(TBRect(-10, -10, 500, 30));
+		root->AddChild(added);
+		TB_VERIFY(HitTestMatchesLinear());
+	}
+	TB_TEST(children_in_rect)
+	{
+		TBWidget **children;
+		int num = root->GetChildrenInRect(TBRect(100, 100, 30, 30), children);
+		TB_VERIFY(num > 0 && num < 20);
+		// All children intersecting the rect must be included, in z order.
+		int found = 0, index = 0;
+		for (TBWidget *child = root->GetFirstChild(); child; child = child->GetNext())
+			if (child->GetRect().Intersects(TBRect(100, 100, 30, 30)))
+			{
+				while (index < num && children[index] != child)
+					index++;
+				TB_VERIFY(index < num);
+				found++;
+			}
+		TB_VERIFY(found > 0);
+	}
+}
+
+TB_TEST_GROUP(tb_widgets_layout_culling)
+{
+	TBLayout *layout;
+
+	/** Return true if GetChildrenInRect includes all children intersecting rect, in z order. */
+	bool ChildrenInRectIsCorrect(const TBRect &rect)
+	{
+		TBWidget **children;
+		int num = layout->GetChildrenInRect(rect, children);
+		if (num == -1)
+			return false;
+		int index = 0;
+		for (TBWidget *child = layout->GetFirstChild(); child; child = child->GetNext())
+		{
+			// Gone children are not laid out, so their rect may be anywhere.
+			if (!child->GetRect().Intersects(rect) || child->GetVisibility() == WIDGET_VISIBILITY_GONE)
+				continue;
+			while (index < num && children[index] != child)
+				index++;
+			if (index == num)
+				return false;
+		}
+		return true;
+	}
+
+	/** Return true if GetChildrenInRect and GetWidgetAt works along the whole layout. */
+	bool CullingIsCorrect()
+	{
+		int num_hits = 0;
+		for (int y = -30; y < 30 * 20 + 30; y += 7)
+		{
+			if (!ChildrenInRectIsCorrect(TBRect(0, y, 50, 45)))
+				return false;
+			// Hit test at y in the children coordinates, with x in the middle of the children.
+			TBWidget *match = nullptr;
+			for (TBWidget *child = layout->GetFirstChild(); child; child = child->GetNext())
+				if (child->GetRect().Contains(TBPoint(50, y)) && child->GetVisibility() != WIDGET_VISIBILITY_GONE)
+					match = child;
+			if (layout->GetWidgetAt(50, y - layout->GetOverflowScroll(), false) != match)
+				return false;
+			if (match)
+				num_hits++;
+		}
+		return num_hits > 0;
+	}
+
+	TB_TEST(Setup)
+	{
+		TB_VERIFY(layout = new TBLayout(AXIS_Y));
+		layout->SetSpacing(2);
+		for (int i = 0; i < 30; i++)
+		{
+			TBWidget *child = new TBWidget;
+			LayoutParams lp(50, 10 + (i % 3) * 5);
+			child->SetLayoutParams(lp);
+			layout->AddChild(child);
+		}
+		layout->SetRect(TBRect(0, 0, 100, 120));
+	}
+	TB_TEST(Cleanup)
+	{
+		delete layout;
+	}
+
+	TB_TEST(culling)
+	{
+		TB_VERIFY(CullingIsCorrect());
+		TBWidget **children;
+		TB_VERIFY(layout->GetChildrenInRect(TBRect(0, 0, 100, 30), children) < 5);
+	}
+	TB_TEST(culling_reverse_order)
+	{
+		layout->SetLayoutOrder(LAYOUT_ORDER_TOP_TO_BOTTOM);
+		layout->InvokeProcess();
+		TB_VERIFY(CullingIsCorrect());
+	}
+	TB_TEST(culling_scrolled)
+	{
+		layout->SetOverflowScroll(100);
+		TB_VERIFY(CullingIsCorrect());
+	}
+	TB_TEST(culling_after_changes)
+	{
+		layout->GetChildFromIndex(3)->SetVisibility(WIDGET_VISIBILITY_GONE);
+		TBWidget *removed = layout->GetChildFromIndex(5);
+		layout->RemoveChild(removed);
+		delete removed;
+		// Not laid out yet, so all children should be checked.
+		TBWidget **children;
+		TB_VERIFY(layout->GetChildrenInRect(TBRect(0, 0, 100, 30), children) == -1);
+		layout->InvokeProcess();
+		TB_VERIFY(CullingIsCorrect());
+	}
+}
+
+TB_TEST_GROUP(tb_widgets_skin_states)
+{
+	/** A button that counts calls to OnSkinChanged. */
+	class TBSkinCountingButton : public TBButton
+	{
+	public:
+		TBSkinCountingButton() : num_skin_changed(0) {}
+		virtual void OnSkinChanged() { num_skin_changed++; }
+		int num_skin_changed;
+	};
+
+	TBWidget *root;
+	TBTabContainer *tc;
+	TBSkinCountingButton *tab;
+	TBEditField *edit;
+
+	TB_TEST(Setup)
+	{
+		TB_VERIFY(root = new TBWidget);
+		tc = new TBTabContainer;
+		tab = new TBSkinCountingButton;
+		tab->SetSkinBg(TBIDC("TBTabContainer.tab"));
+		tc->GetTabLayout()->AddChild(tab);
+		root->AddChild(tc);
+		edit = new TBEditField;
+		root->AddChild(edit);
+		root->InvokeProcess();
+	}
+	TB_TEST(Cleanup)
+	{
+		delete root;
+	}
+
+	TB_TEST(local_condition)
+	{
+		TB_VERIFY(edit->GetSkinBgElement()->id == TBIDC("TBEditField"));
+		edit->SetEditType(EDIT_TYPE_SEARCH);
+		root->InvokeProcess();
+		TB_VERIFY(edit->GetSkinBgElement()->id == TBIDC("TBEditField.search"));
+	}
+	TB_TEST(ancestor_condition)
+	{
+		TB_VERIFY(tab->GetSkinBgElement()->id == TBIDC("TBTabContainer.tab_top"));
+		int num_skin_changed = tab->num_skin_changed;
+		tc->SetAlignment(TB_ALIGN_BOTTOM);
+		root->InvokeProcess();
+		TB_VERIFY(tab->GetSkinBgElement()->id == TBIDC("TBTabContainer.tab_bottom"));
+		TB_VERIFY(tab->num_skin_changed == num_skin_changed + 1);
+
+		// Nothing changed, so processing again should not change anything.
+		root->InvokeProcess();
+		TB_VERIFY(tab->num_skin_changed == num_skin_changed + 1);
+	}
+	TB_TEST(condition_changed_by_unrelated_widget)
+	{
+		// Changes anywhere should update widgets depending on other widgets.
+		tc->SetAlignment(TB_ALIGN_LEFT);
+		edit->InvalidateSkinStates();
+		root->InvokeProcess();
+		TB_VERIFY(tab->GetSkinBgElement()->id == TBIDC("TBTabContainer.tab_left"));
+	}
+	TB_TEST(cached_element)
+	{
+		// The cached element should be updated without processing.
+		TBSkinElement *element = edit->GetSkinBgElement();
+		TB_VERIFY(edit->GetSkinBgElement() == element);
+		edit->SetEditType(EDIT_TYPE_SEARCH);
+		TB_VERIFY(edit->GetSkinBgElement()->id == TBIDC("TBEditField.search"));
+		tc->SetAlignment(TB_ALIGN_RIGHT);
+		TB_VERIFY(tab->GetSkinBgElement()->id == TBIDC("TBTabContainer.tab_right"));
+		// Changing the skin state generation should give the same result.
+		g_tb_skin->InvalidateStateGeneration();
+		TB_VERIFY(tab->GetSkinBgElement()->id == TBIDC("TBTabContainer.tab_right"));
+	}
+	TB_TEST(moved_subtree)
+	{
+		// Create a subtree outside the root, and add it when changes are pending.
+		TBTabContainer *tc2 = new TBTabContainer;
+		TBSkinCountingButton *tab2 = new TBSkinCountingButton;
+		tc2->GetTabLayout()->AddChild(tab2);
+		tab2->SetSkinBg(TBIDC("TBTabContainer.tab"));
+		tc2->SetAlignment(TB_ALIGN_RIGHT);
+		root->AddChild(tc2);
+		root->InvokeProcess();
+		TB_VERIFY(tab2->num_skin_changed == 2);
+		TB_VERIFY(tab2->GetSkinBgElement()->id == TBIDC("TBTabContainer.tab_right"));
+	}
+	TB_TEST(cacheable_conditions)
+	{
+		// Conditions on the value change without invalidating skin states,
+		// so they must not be cached.
+		TBNode node;
+		TB_VERIFY(node.ReadData(
+			"local\n"
+			"	element a\n"
+			"		condition: target: this, property: axis, value: y\n"
+			"	element b\n"
+			"		condition: target: parent, property: align, value: top\n"
+			"value\n"
+			"	element a\n"
+			"		condition: target: this, property: value, value: 1\n"));
+		TBSkinElementStateList local, value;
+		local.Load(node.GetNode("local"));
+		value.Load(node.GetNode("value"));
+		TB_VERIFY(local.HasOnlyCacheableConditions());
+		TB_VERIFY(!value.HasOnlyCacheableConditions());
+	}
+}
+
+TB_TEST_GROUP(tb_widgets_font_cache)
+{
+	TBWidget *root, *child, *grandchild;
+	TBFontDescription large_font;
+
+	TB_TEST(Setup)
+	{
+		TB_VERIFY(root = new TBWidget);
+		child = new TBWidget;
+		grandchild = new TBWidget;
+		root->AddChild(child);
+		child->AddChild(grandchild);
+		large_font = g_font_manager->GetDefaultFontDescription();
+		large_font.SetSize(large_font.GetSize() + 7);
+	}
+	TB_TEST(Cleanup)
+	{
+		delete root;
+	}
+
+	TB_TEST(inherit)
+	{
+		TBFontFace *default_font = g_font_manager->GetFontFace(g_font_manager->GetDefaultFontDescription());
+		TB_VERIFY(grandchild->GetFont() == default_font);
+		TB_VERIFY(root->SetFontDescription(large_font));
+		TB_VERIFY(grandchild->GetFont() == g_font_manager->GetFontFace(large_font));
+		TB_VERIFY(grandchild->GetFont() != default_font);
+		root->SetFontDescription(TBFontDescription());
+		TB_VERIFY(grandchild->GetFont() == default_font);
+	}
+	TB_TEST(reparent)
+	{
+		TB_VERIFY(child->SetFontDescription(large_font));
+		TB_VERIFY(grandchild->GetFont() == g_font_manager->GetFontFace(large_font));
+		child->RemoveChild(grandchild);
+		TB_VERIFY(grandchild->GetFont() == g_font_manager->GetFontFace(g_font_manager->GetDefaultFontDescription()));
+		child->AddChild(grandchild);
+		TB_VERIFY(grandchild->GetFont() == g_font_manager->GetFontFace(large_font));
+	}
+	TB_TEST(default_font_changed)
+	{
+		TBFontDescription default_font = g_font_manager->GetDefaultFontDescription();
+		TB_VERIFY(grandchild->GetFont() == g_font_manager->GetFontFace(default_font));
+		TB_VERIFY(root->SetFontDescription(large_font)); // Make sure it exists.
+		root->SetFontDescription(TBFontDescription());
+		g_font_manager->SetDefaultFontDescription(large_font);
+		TB_VERIFY(grandchild->GetFont() == g_font_manager->GetFontFace(large_font));
+		g_font_manager->SetDefaultFontDescription(default_font);
+		TB_VERIFY(grandchild->GetFont() == g_font_manager->GetFontFace(default_font));
+	}
+}
+
+TB_TEST_GROUP(tb_widgets_process)
+{
+	/** A widget that records the order of OnProcess and OnProcessAfterChildren calls. */
+	class TBProcessWidget : public TBWidget
+	{
+	public:
+		TBProcessWidget(TBStr *log, char name) : log(log), name(name) {}
+		virtual void OnProcess() { char s[2] = { name, 0 }; log->Append(s); }
+		virtual void OnProcessAfterChildren() { char s[3] = { name, '\'', 0 }; log->Append(s); }
+		TBStr *log;
+		char name;
+	};
+
+	TBStr log;
+	TBProcessWidget *root, *a, *a1, *b;
+
+	TB_TEST(Setup)
+	{
+		TB_VERIFY(root = new TBProcessWidget(&log, 'r'));
+		a = new TBProcessWidget(&log, 'a');
+		a1 = new TBProcessWidget(&log, '1');
+		b = new TBProcessWidget(&log, 'b');
+		root->AddChild(a);
+		a->AddChild(a1);
+		root->AddChild(b);
+		root->InvokeProcess();
+		log.Clear();
+	}
+	TB_TEST(Cleanup)
+	{
+		delete root;
+	}
+
+	TB_TEST(idle)
+	{
+		root->InvokeProcess();
+		TB_VERIFY_STR(log, "");
+	}
+	TB_TEST(requested)
+	{
+		a1->RequestProcess();
+		b->RequestProcess();
+		root->InvokeProcess();
+		TB_VERIFY_STR(log, "11'bb'");
+		log.Clear();
+		root->InvokeProcess();
+		TB_VERIFY_STR(log, "");
+	}
+	TB_TEST(parent_before_children)
+	{
+		a1->RequestProcess();
+		a->RequestProcess();
+		root->InvokeProcess();
+		TB_VERIFY_STR(log, "a11'a'");
+	}
+	TB_TEST(invalid_layout)
+	{
+		a1->InvalidateLayout(TBWidget::INVALIDATE_LAYOUT_RECURSIVE);
+		root->InvokeProcess();
+		TB_VERIFY_STR(log, "ra11'a'r'");
+	}
+	TB_TEST(process_always)
+	{
+		b->SetWantProcessAlways(true);
+		root->InvokeProcess();
+		root->InvokeProcess();
+		TB_VERIFY_STR(log, "bb'bb'");
+		b->SetWantProcessAlways(false);
+		root->InvokeProcess();
+		log.Clear();
+		root->InvokeProcess();
+		TB_VERIFY_STR(log, "");
+	}
+	TB_TEST(added_subtree)
+	{
+		// Requests made in a subtree before it's added should be found.
+		TBProcessWidget *c = new TBProcessWidget(&log, 'c');
+		TBProcessWidget *c1 = new TBProcessWidget(&log, '2');
+		c->AddChild(c1);
+		c1->RequestProcess();
+		root->InvokeProcess();
+		TB_VERIFY_STR(log, "");
+		b->AddChild(c);
+		log.Clear();
+		root->InvokeProcess();
+		TB_VERIFY_STR(log, "rbc22'c'b'r'");
+	}
+}
+
+TB_TEST_GROUP(tb_widgets_child_index)
+{
+	TBWidget *root;
+
+	/** Return true if GetChildFromIndex and GetIndexFromChild agree with the child list. */
+	bool IsIndexCorrect()
+	{
+		int i = 0;
+		for (TBWidget *child = root->GetFirstChild(); child; child = child->GetNext(), i++)
+			if (root->GetChildFromIndex(i) != child || root->GetIndexFromChild(child) != i)
+				return false;
+		return root->GetChildFromIndex(i) == nullptr && root->GetChildFromIndex(-1) == nullptr;
+	}
+
+	TB_TEST(Setup)
+	{
+		TB_VERIFY(root = new TBWidget);
+	}
+	TB_TEST(Cleanup)
+	{
+		delete root;
+	}
+
+	TB_TEST(few_children)
+	{
+		for (int i = 0; i < 5; i++)
+			root->AddChild(new TBWidget);
+		TB_VERIFY(IsIndexCorrect());
+	}
+	TB_TEST(many_children)
+	{
+		for (int i = 0; i < 500; i++)
+			root->AddChild(new TBWidget);
+		TB_VERIFY(IsIndexCorrect());
+	}
+	TB_TEST(changed_children)
+	{
+		for (int i = 0; i < 100; i++)
+			root->AddChild(new TBWidget);
+		TB_VERIFY(IsIndexCorrect());
+
+		// Add, remove and reorder, checking the index after each change.
+		TBWidget *child = new TBWidget;
+		root->AddChildRelative(child, WIDGET_Z_REL_AFTER, root->GetChildFromIndex(50));
+		TB_VERIFY(root->GetIndexFromChild(child) == 51);
+		TB_VERIFY(IsIndexCorrect());
+
+		child = root->GetChildFromIndex(10);
+		child->RemoveFromParent();
+		delete child;
+		TB_VERIFY(IsIndexCorrect());
+
+		child = root->GetChildFromIndex(20);
+		child->SetZ(WIDGET_Z_TOP);
+		TB_VERIFY(root->GetIndexFromChild(child) == 99);
+		TB_VERIFY(IsIndexCorrect());
+	}
+}
+
+TB_TEST_GROUP(tb_widgets_update)
+{
+	/** A widget that counts OnInvalid calls. */
+	class TBInvalidCountingWidget : public TBWidget
+	{
+	public:
+		TBInvalidCountingWidget() : num_invalid(0) {}
+		virtual void OnInvalid() { num_invalid++; }
+		int num_invalid;
+	};
+
+	/** A listener that counts added and removed widgets. */
+	class TBAddedCountingListener : public TBWidgetListener
+	{
+	public:
+		TBAddedCountingListener() : num_added(0), num_removed(0), last_added(nullptr) {}
+		virtual void OnWidgetAdded(TBWidget *parent, TBWidget *child) { num_added++; last_added = child; }
+		virtual void OnWidgetRemove(TBWidget *parent, TBWidget *child) { num_removed++; }
+		int num_added, num_removed;
+		TBWidget *last_added;
+	};
+
+	TBInvalidCountingWidget *root;
+	TBWidget *container;
+	TBAddedCountingListener listener;
+
+	TB_TEST(Init)
+	{
+		TBWidgetListener::AddGlobalListener(&listener);
+	}
+	TB_TEST(Shutdown)
+	{
+		TBWidgetListener::RemoveGlobalListener(&listener);
+	}
+	TB_TEST(Setup)
+	{
+		TB_VERIFY(root = new TBInvalidCountingWidget);
+		container = new TBWidget;
+		root->AddChild(container);
+		root->SetRect(TBRect(0, 0, 100, 100));
+		root->InvokeProcess();
+		root->num_invalid = 0;
+		listener.num_added = listener.num_removed = 0;
+	}
+	TB_TEST(Cleanup)
+	{
+		delete root;
+	}
+
+	TB_TEST(batched)
+	{
+		// Adding many widgets in a batch should cost no more invalidations than adding one without.
+		container->AddChild(new TBWidget);
+		const int num_invalid_for_one = root->num_invalid;
+		TB_VERIFY(num_invalid_for_one > 0);
+		root->num_invalid = 0;
+		listener.num_added = 0;
+
+		container->BeginUpdate();
+		TB_VERIFY(container->GetIsUpdating());
+		for (int i = 0; i < 10; i++)
+			container->AddChild(new TBWidget);
+		TB_VERIFY(listener.num_added == 0);
+		TB_VERIFY(root->num_invalid == 0);
+		container->EndUpdate();
+		TB_VERIFY(!container->GetIsUpdating());
+		TB_VERIFY(listener.num_added == 10);
+		TB_VERIFY(listener.last_added == container->GetLastChild());
+		TB_VERIFY(root->num_invalid > 0 && root->num_invalid <= num_invalid_for_one);
+	}
+	TB_TEST(nested)
+	{
+		TBWidget *child = new TBWidget;
+		root->BeginUpdate();
+		container->BeginUpdate();
+		container->AddChild(new TBWidget);
+		container->AddChild(child);
+		child->AddChild(new TBWidget);
+		container->EndUpdate();
+		TB_VERIFY(listener.num_added == 0);
+		TB_VERIFY(root->num_invalid == 0);
+		root->EndUpdate();
+		TB_VERIFY(listener.num_added == 3);
+		TB_VERIFY(root->num_invalid > 0);
+	}
+	TB_TEST(blocker)
+	{
+		{
+			TBWidgetUpdateBlocker update_blocker(container);
+			container->Invalidate();
+			container->Invalidate();
+			TB_VERIFY(root->num_invalid == 0);
+		}
+		TB_VERIFY(root->num_invalid == 1);
+	}
+	TB_TEST(removed_before_notified)
+	{
+		TBWidget *child = new TBWidget;
+		TBWidget *other = new TBWidget;
+		container->BeginUpdate();
+		container->AddChild(child);
+		container->AddChild(other);
+		child->RemoveFromParent();
+		delete child;
+		container->EndUpdate();
+		TB_VERIFY(listener.num_added == 1);
+		TB_VERIFY(listener.num_removed == 0);
+		TB_VERIFY(listener.last_added == other);
+	}
+	TB_TEST(moved_before_notified)
+	{
+		TBWidget *child = new TBWidget;
+		container->BeginUpdate();
+		container->AddChild(child);
+		child->RemoveFromParent();
+		root->AddChild(child);
+		TB_VERIFY(listener.num_added == 1);
+		container->EndUpdate();
+		TB_VERIFY(listener.num_added == 1);
+	}
+}
+
+
+TB_TEST_GROUP(tb_widgets_preferred_size_cache)
+{
+	/** A widget with a size that depends on the constraints as given by size_dependency.
+		Counts the times its size is calculated. */
+	class TBTestSizeWidget : public TBWidget
+	{
+	public:
+		TBTestSizeWidget() : size_dependency(SIZE_DEP_NONE), num_calculated(0) {}
+		virtual PreferredSize OnCalculatePreferredContentSize(const SizeConstraints &constraints)
+		{
+			num_calculated++;
+			PreferredSize ps;
+			ps.pref_w = constraints.available_h / 10;
+			ps.pref_h = constraints.available_w / 10;
+			ps.size_dependency = size_dependency;
+			return ps;
+		}
+		SIZE_DEP size_dependency;
+		int num_calculated;
+	};
+
+	TBTestSizeWidget *widget;
+
+	TB_TEST(Setup)
+	{
+		TB_VERIFY(widget = new TBTestSizeWidget);
+	}
+	TB_TEST(Cleanup)
+	{
+		delete widget;
+	}
+
+	TB_TEST(no_dependency)
+	{
+		widget->GetPreferredSize(SizeConstraints(100, 100));
+		widget->GetPreferredSize(SizeConstraints(200, 50));
+		TB_VERIFY(widget->num_calculated == 1);
+	}
+	TB_TEST(height_depend_on_width)
+	{
+		widget->size_dependency = SIZE_DEP_HEIGHT_DEPEND_ON_WIDTH;
+		TB_VERIFY(widget->GetPreferredSize(SizeConstraints(100, 100)).pref_h == 10);
+		TB_VERIFY(widget->GetPreferredSize(SizeConstraints(100, 50)).pref_h == 10);
+		TB_VERIFY(widget->num_calculated == 1);
+
+		// Alternating between widths reuses the earlier results.
+		TB_VERIFY(widget->GetPreferredSize(SizeConstraints(200, 100)).pref_h == 20);
+		TB_VERIFY(widget->GetPreferredSize(SizeConstraints(100, 100)).pref_h == 10);
+		TB_VERIFY(widget->GetPreferredSize(SizeConstraints(200, 100)).pref_h == 20);
+		TB_VERIFY(widget->num_calculated == 2);
+	}
+	TB_TEST(width_depend_on_height)
+	{
+		widget->size_dependency = SIZE_DEP_WIDTH_DEPEND_ON_HEIGHT;
+		TB_VERIFY(widget->GetPreferredSize(SizeConstraints(100, 100)).pref_w == 10);
+		TB_VERIFY(widget->GetPreferredSize(SizeConstraints(50, 100)).pref_w == 10);
+		TB_VERIFY(widget->GetPreferredSize(SizeConstraints(100, 300)).pref_w == 30);
+		TB_VERIFY(widget->num_calculated == 2);
+	}
+	TB_TEST(least_recently_used_dropped)
+	{
+		// The most recent result and 3 more are kept.
+		widget->size_dependency = SIZE_DEP_BOTH;
+		for (int i = 1; i <= 4; i++)
+			widget->GetPreferredSize(SizeConstraints(i * 100, i * 100));
+		for (int i = 4; i >= 1; i--)
+			TB_VERIFY(widget->GetPreferredSize(SizeConstraints(i * 100, i * 100)).pref_w == i * 10);
+		TB_VERIFY(widget->num_calculated == 4);
+
+		// 400 is now the least recently used, so it's dropped by a new one.
+		widget->GetPreferredSize(SizeConstraints(500, 500));
+		widget->GetPreferredSize(SizeConstraints(100, 100));
+		TB_VERIFY(widget->num_calculated == 5);
+		widget->GetPreferredSize(SizeConstraints(400, 400));
+		TB_VERIFY(widget->num_calculated == 6);
+	}
+	TB_TEST(invalidated)
+	{
+		widget->size_dependency = SIZE_DEP_BOTH;
+		widget->GetPreferredSize(SizeConstraints(100, 100));
+		widget->GetPreferredSize(SizeConstraints(200, 200));
+		widget->InvalidateLayout(TBWidget::INVALIDATE_LAYOUT_TARGET_ONLY);
+		widget->GetPreferredSize(SizeConstraints(200, 200));
+		widget->GetPreferredSize(SizeConstraints(100, 100));
+		TB_VERIFY(widget->num_calculated == 4);
+	}
+#ifdef TB_RUNTIME_DEBUG_INFO
+	TB_TEST(debug_counters)
+	{
+		const int old_setting = TB_DEBUG_SETTING(LAYOUT_PS_DEBUGGING);
+		const int old_hits = g_tb_debug.num_ps_cache_hits;
+		const int old_misses = g_tb_debug.num_ps_cache_misses;
+		TB_DEBUG_SETTING(LAYOUT_PS_DEBUGGING) = 1;
+		widget->GetPreferredSize(SizeConstraints(100, 100));
+		widget->GetPreferredSize(SizeConstraints(100, 100));
+		TB_DEBUG_SETTING(LAYOUT_PS_DEBUGGING) = old_setting;
+		TB_VERIFY(g_tb_debug.num_ps_cache_misses == old_misses + 1);
+		TB_VERIFY(g_tb_debug.num_ps_cache_hits == old_hits + 1);
+	}
+#endif // TB_RUNTIME_DEBUG_INFO
+}
+
+#endif // TB_UNIT_TESTING
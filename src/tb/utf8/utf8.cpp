@@ -1,10 +1,66 @@
 #include "utf8/utf8.h"
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UTF8_SSE2
+#include <emmintrin.h>
+#endif
 
 namespace utf8 {
 
 /** is c the start of a UTF-8 sequence? */
 #define isutf(c) (((c)&0xC0)!=0x80)
 
+/** is c a ASCII character that is not the null termination? */
+#define isascii_nonzero(c) ((unsigned char)((c) - 1) < 0x7F)
+
+/** Decode the run of ASCII characters at the start of src (stopping at null termination,
+	the first non ASCII byte or len) by widening them to dst.
+	If dst is nullptr, the run is only measured.
+	len bytes must be readable, since they are read in blocks of 16 bytes.
+	@return the length of the run. */
+static int decode_ascii_run(const char *src, int len, UCS4 *dst)
+{
+	int n = 0;
+#ifdef UTF8_SSE2
+	// Go one by one until aligned to 16 bytes.
+	while (n < len && (((size_t) (src + n)) & 15))
+	{
+		if (!isascii_nonzero(src[n]))
+			return n;
+		if (dst)
+			dst[n] = (unsigned char) src[n];
+		n++;
+	}
+	const __m128i zero = _mm_setzero_si128();
+	while (n + 16 <= len)
+	{
+		const __m128i bytes = _mm_load_si128((const __m128i *) (src + n));
+		// The high bit is set for non ASCII bytes, and null termination compares equal to zero.
+		if (_mm_movemask_epi8(bytes) | _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero)))
+			break;
+		if (dst)
+		{
+			const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+			const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+			_mm_storeu_si128((__m128i *) (dst + n), _mm_unpacklo_epi16(lo, zero));
+			_mm_storeu_si128((__m128i *) (dst + n + 4), _mm_unpackhi_epi16(lo, zero));
+			_mm_storeu_si128((__m128i *) (dst + n + 8), _mm_unpacklo_epi16(hi, zero));
+			_mm_storeu_si128((__m128i *) (dst + n + 12), _mm_unpackhi_epi16(hi, zero));
+		}
+		n += 16;
+	}
+#endif // UTF8_SSE2
+	while (n < len && isascii_nonzero(src[n]))
+	{
+		if (dst)
+			dst[n] = (unsigned char) src[n];
+		n++;
+	}
+	return n;
+}
+
 UCS4 decode(const char *&src, const char *src_end)
 {
 	const char* start = src;
@@ -117,6 +173,31 @@ UCS4 decode_next(const char *str, int *i, int i_max)
 	return ch;
 }
 
+int decode_span(const char *str, int *i, int i_max, UCS4 *dst, int dst_max)
+{
+	int pos = *i;
+	int count = 0;
+	// i_max may be larger than str if it's null terminated, so measure the bytes that can
+	// be decoded (at most 4 per character) before reading them in blocks.
+	if (pos < i_max)
+		i_max = pos + (int) strnlen(str + pos, (i_max - pos) / 4 < dst_max ? i_max - pos : dst_max * 4);
+	while (count < dst_max && pos < i_max)
+	{
+		int run_max = dst_max - count;
+		if (run_max > i_max - pos)
+			run_max = i_max - pos;
+		const int run = decode_ascii_run(str + pos, run_max, dst + count);
+		pos += run;
+		count += run;
+		if (count == dst_max || pos >= i_max || !str[pos])
+			break;
+		// Not ASCII, so decode one character the slow way.
+		dst[count++] = decode_next(str, &pos, i_max);
+	}
+	*i = pos;
+	return count;
+}
+
 void move_inc(const char *str, int *i, int i_max)
 {
 	(void)	((*i < i_max && isutf(str[++(*i)])) ||
@@ -137,8 +218,19 @@ int count_characters(const char *str, int i_max)
 {
 	int count = 0;
 	int i = 0;
-	while (i < i_max && decode_next(str, &i, i_max))
+	// i_max may be larger than str if it's null terminated, so measure it before
+	// reading it in blocks.
+	if (i_max > 0)
+		i_max = (int) strnlen(str, i_max);
+	while (i < i_max)
+	{
+		const int run = decode_ascii_run(str + i, i_max - i, nullptr);
+		i += run;
+		count += run;
+		if (i >= i_max || !decode_next(str, &i, i_max))
+			break;
 		count++;
+	}
 	return count;
 }
 
@@ -27,6 +27,56 @@ int encode(UCS4 ch, char *dst);
 */
 UCS4 decode_next(const char *str, int *i, int i_max);
 
+/** Decode a span of UCS4 characters from a UTF-8 string, and update the index variable.
+	Decoding stops at null termination, at i_max, or when dst_max characters are written.
+	Invalid characters are decoded as 0xFFFF and skip one byte, just like decode_next.
+	Runs of ASCII are detected and widened in bulk, so this is much faster than calling
+	decode_next for each character.
+	@param str The UTF-8 string.
+	@param i The index of the current position. This will be increased to the next position.
+	@param i_max The last position (size of str). It may be larger if str is null terminated.
+	@param dst buffer to receive the decoded characters.
+	@param dst_max the maximum number of characters to write to dst.
+	@return the number of characters written to dst. 0 if the end was reached.
+*/
+int decode_span(const char *str, int *i, int i_max, UCS4 *dst, int dst_max);
+
+/** span_decoder decodes a UTF-8 string character by character, but using decode_span
+	to decode in batches behind the scenes.
+
+	Example:
+		utf8::span_decoder decoder(str, len);
+		UCS4 cp;
+		while (decoder.next(cp))
+			...
+*/
+class span_decoder
+{
+public:
+	span_decoder(const char *str, int i_max) : m_str(str), m_i(0), m_i_max(i_max), m_pos(0), m_count(0) {}
+
+	/** Get the next character. Returns false when null termination or i_max is reached. */
+	inline bool next(UCS4 &ch)
+	{
+		if (m_pos == m_count && !refill())
+			return false;
+		ch = m_buf[m_pos++];
+		return true;
+	}
+private:
+	bool refill()
+	{
+		m_pos = 0;
+		m_count = decode_span(m_str, &m_i, m_i_max, m_buf, BUFFER_SIZE);
+		return m_count > 0;
+	}
+	enum { BUFFER_SIZE = 64 };
+	const char *m_str;
+	int m_i, m_i_max;
+	int m_pos, m_count;
+	UCS4 m_buf[BUFFER_SIZE];
+};
+
 /** Move to the next character in a UTF-8 string.
 	@param str The UTF-8 string.
 	@param i The index of the current position. This will be increased to the next position.